@@ -0,0 +1,19 @@
+# Every thread counts itself into global register 3 with INC_RESET, which
+# goes back to 0 once all the threads have, waits at a BARRIER on it until
+# then, and counts itself again on global register 4 with ATOMIC_INC.
+# Run by scheduler_check.sh.
+	REG	$zero
+	REG	$2
+	REG	$3
+	REG	$5
+	REG	$6
+	.text
+main:
+.start:
+	andi	$zero, $TID, 0
+	addi	$5, $zero, 3
+	INC_RESET	$2, $5
+	BARRIER	$5
+	addi	$6, $zero, 4
+	ATOMIC_INC	$3, $6
+	HALT
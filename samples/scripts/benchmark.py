@@ -0,0 +1,206 @@
+#!/usr/bin/env python
+#
+# Simulator performance benchmark.
+#
+# Runs simtrax over a matrix of sample programs x hardware configs x
+# simulation thread counts and records, for each run: wall time, peak RSS,
+# simulation speed (KIPS) and the per-phase times simtrax prints (scene
+# load, BVH build, assembly, simulate, output).
+#
+# Results are written as tab separated text (and JSON with --json). A
+# previous JSON result can be given with --baseline, any run whose wall time
+# grew by more than --threshold percent is reported and the script exits
+# with status 1, so it can be used as a regression check.
+#
+# Programs are only run if their compiled assembly (samples/src/<name>/rt-llvm.s)
+# exists, build them with the llvm_trax toolchain first. A program named
+# <name>+<scene> runs <name> with samples/scenes/<scene> loaded.
+#
+# Examples, run from the simtrax root or anywhere with --root:
+#   samples/scripts/benchmark.py --quick
+#   samples/scripts/benchmark.py --json base.json
+#   samples/scripts/benchmark.py --baseline base.json --threshold 10
+
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import time
+
+PROGRAMS = ["helloworld", "gradient", "mandelbrot", "simd_mandelbrot", "gradient+cornell"]
+CONFIGS = ["tiny", "default", "bigcache"]
+THREADS = [1, 2, 4, 8]
+
+# there is no ray tracing sample program yet, so the scene runs are a
+# sample program with a scene loaded: <program>+<scene> runs <program>
+# with samples/scenes/<scene> (the scene load and BVH build are timed, but
+# the program doesn't trace it)
+SCENES = {"cornell": ("cornell.view", "CornellBox.obj", "cornell.light")}
+
+
+# sample program and scene (or None) of a run's name
+def split_program(program):
+  if "+" in program:
+    source, scene = program.split("+", 1)
+    return source, scene
+  return program, None
+
+# everything else matches samples/scripts/single_run.sh
+COMMON_ARGS = ["--num-regs", "36", "--num-thread-procs", "32", "--threads-per-proc", "1",
+               "--num-cores", "4", "--simd-width", "1", "--num-icaches", "4",
+               "--num-icache-banks", "16", "--num-l2s", "1", "--width", "64", "--height", "64"]
+
+PHASES = [("load", "Scene load time"),
+          ("bvh", "BVH build time"),
+          ("assemble", "Assembly time"),
+          ("simulate", "Frame time"),
+          ("output", "Output time")]
+
+TIME_LINE = re.compile(r"<== (.*?): ([0-9.]+) seconds")
+KIPS_LINE = re.compile(r"<== Simulation speed: ([0-9.]+) KIPS")
+CYCLES_LINE = re.compile(r"Total clock cycles:\s+([0-9]+)")
+
+
+def run_one(simtrax, root, program, config, threads, output_dir):
+  source, scene = split_program(program)
+  args = [simtrax] + COMMON_ARGS
+  args += ["--simulation-threads", str(threads),
+           "--config-file", os.path.join(root, "samples", "configs", config + ".config"),
+           "--load-assembly", os.path.join(root, "samples", "src", source, "rt-llvm.s"),
+           "--output-prefix", os.path.join(output_dir, "bench_out")]
+  if scene:
+    scene_dir = os.path.join(root, "samples", "scenes", scene)
+    view, model, light = SCENES[scene]
+    args += ["--view-file", os.path.join(scene_dir, view),
+             "--model", os.path.join(scene_dir, model),
+             "--light-file", os.path.join(scene_dir, light)]
+  else:
+    args += ["--no-scene"]
+
+  log_name = os.path.join(output_dir, "bench_%s_%s_t%d.log" % (program, config, threads))
+  log = open(log_name, "w")
+  start = time.time()
+  # run in the sim directory so the relative paths in the configs resolve
+  process = subprocess.Popen(args, stdout=log, stderr=subprocess.STDOUT,
+                             cwd=os.path.join(root, "sim"))
+  # wait4 reports the child's own peak RSS (in KB on Linux)
+  pid, status, usage = os.wait4(process.pid, 0)
+  wall = time.time() - start
+  log.close()
+
+  result = {"program": program, "config": config, "threads": threads,
+            "wall": wall, "peak_rss_mb": usage.ru_maxrss / 1024.0,
+            "kips": 0.0, "cycles": 0, "ok": status == 0, "log": log_name}
+  for name, heading in PHASES:
+    result[name] = 0.0
+  for line in open(log_name):
+    match = TIME_LINE.search(line)
+    if match:
+      for name, heading in PHASES:
+        if match.group(1) == heading:
+          result[name] = float(match.group(2))
+    match = KIPS_LINE.search(line)
+    if match:
+      result["kips"] = float(match.group(1))
+    match = CYCLES_LINE.search(line)
+    if match:
+      result["cycles"] = int(match.group(1))
+  return result
+
+
+def key(result):
+  program, scene = split_program(result["program"])
+  if scene:
+    program = "%s+%s scene" % (program, scene)
+  return "%s/%s/t%d" % (program, result["config"], result["threads"])
+
+
+def main():
+  default_root = os.path.abspath(os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", ".."))
+  parser = argparse.ArgumentParser(description="simtrax performance benchmark")
+  parser.add_argument("--root", default=default_root, help="simtrax root directory")
+  parser.add_argument("--simtrax", help="simulator binary (default <root>/sim/simtrax)")
+  parser.add_argument("--programs", default=",".join(PROGRAMS))
+  parser.add_argument("--configs", default=",".join(CONFIGS))
+  parser.add_argument("--threads", default=",".join(str(t) for t in THREADS))
+  parser.add_argument("--quick", action="store_true", help="default config, 1 and 4 threads only")
+  parser.add_argument("--output-dir", default="benchmark_results")
+  parser.add_argument("--json", help="also write the results as JSON (usable as a --baseline)")
+  parser.add_argument("--baseline", help="JSON results to compare against")
+  parser.add_argument("--threshold", type=float, default=5.0,
+                      help="percent wall time increase that counts as a regression (default 5)")
+  options = parser.parse_args()
+
+  root = os.path.abspath(options.root)
+  simtrax = os.path.abspath(options.simtrax or os.path.join(root, "sim", "simtrax"))
+  if not os.path.exists(simtrax):
+    print("ERROR: simulator %s not found, build it first" % simtrax)
+    return 2
+  programs = options.programs.split(",")
+  configs = options.configs.split(",")
+  threads = [int(t) for t in options.threads.split(",")]
+  if options.quick:
+    configs = ["default"]
+    threads = [1, 4]
+  output_dir = os.path.abspath(options.output_dir)
+  if not os.path.isdir(output_dir):
+    os.makedirs(output_dir)
+
+  results = []
+  for program in programs:
+    source, scene = split_program(program)
+    if scene and scene not in SCENES:
+      print("skipping %s: unknown scene %s" % (program, scene))
+      continue
+    assembly = os.path.join(root, "samples", "src", source, "rt-llvm.s")
+    if not os.path.exists(assembly):
+      print("skipping %s: %s not built" % (program, assembly))
+      continue
+    for config in configs:
+      for thread_count in threads:
+        result = run_one(simtrax, root, program, config, thread_count, output_dir)
+        print("%-40s %s wall %8.3fs  rss %7.1fMB  %9.1f KIPS" %
+              (key(result), "ok    " if result["ok"] else "FAILED",
+               result["wall"], result["peak_rss_mb"], result["kips"]))
+        sys.stdout.flush()
+        results.append(result)
+
+  columns = ["wall", "peak_rss_mb", "kips", "cycles"] + [name for name, heading in PHASES]
+  table = open(os.path.join(output_dir, "benchmark.txt"), "w")
+  table.write("run\t" + "\t".join(columns) + "\n")
+  for result in results:
+    table.write(key(result) + "\t" + "\t".join(str(result[c]) for c in columns) + "\n")
+  table.close()
+  if options.json:
+    json.dump(results, open(options.json, "w"), indent=1)
+
+  if not options.baseline:
+    return 0
+
+  baseline = dict((key(r), r) for r in json.load(open(options.baseline)))
+  regressions = 0
+  print("\nComparison with %s (threshold %.1f%%):" % (options.baseline, options.threshold))
+  for result in results:
+    base = baseline.get(key(result))
+    if base is None or base["wall"] <= 0:
+      continue
+    change = 100.0 * (result["wall"] - base["wall"]) / base["wall"]
+    flag = ""
+    if change > options.threshold:
+      flag = "  REGRESSION"
+      regressions += 1
+    if result["cycles"] != base["cycles"]:
+      flag += "  (cycles changed %d -> %d)" % (base["cycles"], result["cycles"])
+    print("%-40s %8.3fs -> %8.3fs  %+6.1f%%%s" % (key(result), base["wall"], result["wall"], change, flag))
+  if regressions:
+    print("%d regression(s)" % regressions)
+    return 1
+  return 0
+
+
+if __name__ == "__main__":
+  sys.exit(main())
@@ -0,0 +1,47 @@
+#!/bin/bash
+#
+# Runs samples/scripts/barrier.s with several threads per thread processor
+# under every thread scheduler, with and without SYNCWAKE, and checks that
+# all the threads get through the BARRIER. A scheduler that keeps picking a
+# thread that can't issue makes the watchdog stop the run.
+#
+# Run from anywhere, after building the simulator.
+
+SIMTRAXROOT=$(cd "$(dirname "$0")/../.." && pwd)
+SIMTRAX=$SIMTRAXROOT/sim/simtrax
+ASSEMBLY=$SIMTRAXROOT/samples/scripts/barrier.s
+CONFIG=$SIMTRAXROOT/samples/configs/default.config
+
+NUM_TMS=2
+NUM_PROCS=4
+THREADS_PER_PROC=4
+# every thread issues one ATOMIC_INC
+EXPECTED=$((NUM_TMS * NUM_PROCS * THREADS_PER_PROC))
+
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf $WORK_DIR' EXIT
+SYNCWAKE_CONFIG=$WORK_DIR/syncwake.config
+cat $CONFIG > $SYNCWAKE_CONFIG
+echo "SYNCWAKE 2" >> $SYNCWAKE_CONFIG
+
+FAILED=0
+for SCHEDULING in simple prestall poststall gto twolevel lrr; do
+  for RUN_CONFIG in $CONFIG $SYNCWAKE_CONFIG; do
+    NAME=$SCHEDULING
+    if [ $RUN_CONFIG = $SYNCWAKE_CONFIG ]; then
+      NAME="$SCHEDULING with SYNCWAKE"
+    fi
+    OUTPUT=$($SIMTRAX --no-scene --load-assembly $ASSEMBLY --config-file $RUN_CONFIG --disable-usimm \
+      --num-TMs $NUM_TMS --num-thread-procs $NUM_PROCS --threads-per-proc $THREADS_PER_PROC \
+      --scheduling $SCHEDULING --watchdog 10000 --output-prefix $WORK_DIR/out 2>&1)
+    # the dynamic instruction mix's count
+    COUNT=$(echo "$OUTPUT" | sed -n '/Dynamic Instruction Mix/,$p' | awk '$1 == "ATOMIC_INC" { print $2; exit }')
+    if echo "$OUTPUT" | grep -q WATCHDOG || [ "$COUNT" != "$EXPECTED" ]; then
+      echo "FAILED: $NAME ($COUNT of $EXPECTED threads through the barrier)"
+      FAILED=1
+    else
+      echo "ok: $NAME ($(echo "$OUTPUT" | grep "Total clock cycles" | awk '{ print $4 }') cycles)"
+    fi
+  done
+done
+exit $FAILED
@@ -10,8 +10,8 @@
 #include <math.h>
 #include <cstdlib>
 
-FPAddSub::FPAddSub(int _latency, int _width) :
-    FunctionalUnit(_latency), width(_width)
+FPAddSub::FPAddSub(int _latency, int _width, const RandParams* rand) :
+    FunctionalUnit(_latency), width(_width), rand_params(rand)
 {
   issued_this_cycle = 0;
 }
@@ -58,6 +58,7 @@ bool FPAddSub::AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadStat
 
   // Compute results
   reg_value result;
+  unsigned long long rand_state = 0;
   switch (ins.op)
   {
     case Instruction::add_s:
@@ -89,7 +90,14 @@ bool FPAddSub::AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadStat
       break;
 
     case Instruction::RAND:
-      result.fdata = drand48();
+      if (rand_params)
+      {
+        // the thread's own generator, kept once the write is queued
+        result.fdata = RandomGenerator::Next(*rand_params, thread, rand_state);
+        write_cycle = issuer->current_cycle + rand_params->latency;
+      }
+      else
+        result.fdata = drand48();
       break;
 
     case Instruction::COS:
@@ -112,6 +120,8 @@ bool FPAddSub::AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadStat
     return false;
   }
 
+  if (ins.op == Instruction::RAND && rand_params)
+    thread->rand_state = rand_state;
   issued_this_cycle++;
   return true;
 }
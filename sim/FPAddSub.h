@@ -2,12 +2,14 @@
 #define _SIMHWRT_FPADDSUB_H_
 
 #include "FunctionalUnit.h"
+#include "RandomGenerator.h"
 
 class SimpleRegisterFile;
 
 class FPAddSub : public FunctionalUnit {
  public:
-  FPAddSub(int latency, int width);
+  // rand, if given, sets up a generator per thread for RAND (RNG line)
+  FPAddSub(int latency, int width, const RandParams* rand = NULL);
 
   // From FunctionalUnit
   virtual bool SupportsOp(Instruction::Opcode op) const;
@@ -21,6 +23,8 @@ class FPAddSub : public FunctionalUnit {
 
   int width;
   int issued_this_cycle;
+  // NULL for the host's drand48()
+  const RandParams* rand_params;
 };
 
 #endif // _SIMHWRT_FPADDSUB_H_
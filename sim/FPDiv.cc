@@ -2,6 +2,7 @@
 #include "SimpleRegisterFile.h"
 #include "IssueUnit.h"
 #include "ThreadState.h"
+#include "UnitLanes.h"
 #include "WriteRequest.h"
 #include <float.h>
 #include <math.h>
@@ -10,8 +11,8 @@
 
 extern std::vector<std::string> source_names;
 
-FPDiv::FPDiv(int _latency, int _width) :
-    FunctionalUnit(_latency), width(_width)
+FPDiv::FPDiv(int _latency, int _width, UnitLanes* _lanes) :
+    FunctionalUnit(_latency), width(_width), lanes(_lanes)
 {
   issued_this_cycle = 0;
 }
@@ -35,7 +36,13 @@ bool FPDiv::SupportsOp(Instruction::Opcode op) const
 
 bool FPDiv::AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState* thread)
 {
-  if (issued_this_cycle >= width) return false;
+  // with an INTERVAL line a free lane is needed, see UnitLanes.h
+  int lane = -1;
+  if (lanes) {
+    lane = lanes->Reserve(issuer->current_cycle, (int)thread->core_id);
+    if (lane < 0) return false;
+  }
+  else if (issued_this_cycle >= width) return false;
 
   reg_value arg1, arg2;
   int write_reg = ins.args[0];
@@ -203,16 +210,20 @@ bool FPDiv::AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState*
         !thread->QueueWrite(LO_REG, resultLO, write_cycle, ins.op, &ins))
     {
       // pipeline hazzard
+      if (lanes) lanes->Release(lane);
       return false;
     }
   }
   else if (!thread->QueueWrite(write_reg, result, write_cycle, ins.op, &ins, isMSA))
   {
     // pipeline hazzard
+    if (lanes) lanes->Release(lane);
     return false;
   }
 
-  issued_this_cycle++;
+  // a shared unit is clocked by every TM using it, so it isn't counted per cycle
+  if (!lanes || lanes->tms_per_unit == 1)
+    issued_this_cycle++;
   return true;
 }
 
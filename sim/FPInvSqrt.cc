@@ -2,13 +2,14 @@
 #include "SimpleRegisterFile.h"
 #include "IssueUnit.h"
 #include "ThreadState.h"
+#include "UnitLanes.h"
 #include "WriteRequest.h"
 #include <float.h>
 #include <math.h>
 #include <cassert>
 
-FPInvSqrt::FPInvSqrt(int _latency, int _width) :
-    FunctionalUnit(_latency), width(_width)
+FPInvSqrt::FPInvSqrt(int _latency, int _width, UnitLanes* _lanes) :
+    FunctionalUnit(_latency), width(_width), lanes(_lanes)
 {
   issued_this_cycle = 0;
 }
@@ -25,7 +26,13 @@ bool FPInvSqrt::SupportsOp(Instruction::Opcode op) const
 
 bool FPInvSqrt::AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState* thread)
 {
-  if (issued_this_cycle >= width) return false;
+  // with an INTERVAL line a free lane is needed, see UnitLanes.h
+  int lane = -1;
+  if (lanes) {
+    lane = lanes->Reserve(issuer->current_cycle, (int)thread->core_id);
+    if (lane < 0) return false;
+  }
+  else if (issued_this_cycle >= width) return false;
 
   reg_value arg1;
   int write_reg = ins.args[0];
@@ -58,10 +65,13 @@ bool FPInvSqrt::AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadSta
   if (!thread->QueueWrite(write_reg, result, write_cycle, ins.op, &ins))
   {
     // pipeline hazzard
+    if (lanes) lanes->Release(lane);
     return false;
   }
 
-  issued_this_cycle++;
+  // a shared unit is clocked by every TM using it, so it isn't counted per cycle
+  if (!lanes || lanes->tms_per_unit == 1)
+    issued_this_cycle++;
   return true;
 }
 
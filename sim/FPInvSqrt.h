@@ -3,9 +3,12 @@
 
 #include "FunctionalUnit.h"
 
+class UnitLanes;
+
 class FPInvSqrt : public FunctionalUnit {
  public:
-  FPInvSqrt(int latency, int width);
+  // lanes, from an INTERVAL line, may be shared with other TMs' units
+  FPInvSqrt(int latency, int width, UnitLanes* lanes = NULL);
 
   // From FunctionalUnit
   virtual bool SupportsOp(Instruction::Opcode op) const;
@@ -19,6 +22,8 @@ class FPInvSqrt : public FunctionalUnit {
 
   int width;
   int issued_this_cycle;
+  // NULL to issue up to width ops every cycle
+  UnitLanes* lanes;
 };
 
 #endif // _SIMHWRT_FPMUL_H_
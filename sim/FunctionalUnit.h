@@ -29,6 +29,11 @@ class FunctionalUnit : public HardwareModule {
   // If you can handle this instruction now, return true else false
   // You can assume that SupportsOps(ins.op) == true
   virtual bool AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState* thread) { return false; };
+
+  // Units compute their result at issue and queue it in the thread's write
+  // queue, so between issues an idle clock only resets per-cycle counters
+  virtual long long int NextEventCycle() { return NO_EVENT_CYCLE; }
+  virtual void SkipCycles(long long int num_cycles) { ClockRise(); ClockFall(); }
 };
 
 
@@ -4,6 +4,8 @@
 #include "ThreadState.h"
 #include "WriteRequest.h"
 #include <cassert>
+#include <stdio.h>
+#include <stdlib.h>
 #ifndef WIN32
 #  include <sys/time.h>
 #else
@@ -25,10 +27,24 @@ GlobalRegisterFile::GlobalRegisterFile(int num_regs, unsigned int sys_threads, u
   latency = 1;
   issued_this_cycle = 0;
   last_report_cycle = 0;
+  batched = false;
+  ops_per_cycle = 1;
+  num_tms = 0;
+  next_reg = 0;
+  requests = 0;
+  retries = 0;
+  max_batch = 0;
+  work_distributor = NULL;
+  sync_queues = NULL;
 }
 
 GlobalRegisterFile::~GlobalRegisterFile()
 {
+  ClearRequests();
+  if (work_distributor)
+    delete work_distributor;
+  if (sync_queues)
+    delete sync_queues;
   delete[] fdata;
 }
 
@@ -39,6 +55,74 @@ void GlobalRegisterFile::Reset()
 
   issued_this_cycle = 0;
   last_report_cycle = 0;
+
+  ClearRequests();
+  next_reg = 0;
+  requests = 0;
+  retries = 0;
+  max_batch = 0;
+  for (size_t i = 0; i < reg_ops.size(); i++) {
+    reg_ops[i] = 0;
+    reg_wait_cycles[i] = 0;
+    reg_max_depth[i] = 0;
+    for (size_t j = 0; j < reg_wait_histogram[i].size(); j++)
+      reg_wait_histogram[i][j] = 0;
+  }
+  if (work_distributor)
+    work_distributor->Reset();
+  if (sync_queues)
+    sync_queues->Reset();
+}
+
+void GlobalRegisterFile::ClearRequests()
+{
+  // every request is in a thread's pending map until it issues, except
+  // the work distributor's refills, queued until they are served
+  for (size_t i = 0; i < pending.size(); i++) {
+    for (std::map<ThreadState*, Request*>::iterator it = pending[i].begin(); it != pending[i].end(); ++it)
+      delete it->second;
+    pending[i].clear();
+    for (size_t j = 0; j < batches[i].size(); j++)
+      if (batches[i][j]->chunk)
+        delete batches[i][j];
+    batches[i].clear();
+  }
+  for (size_t i = 0; i < queues.size(); i++) {
+    for (size_t j = 0; j < queues[i].size(); j++)
+      if (queues[i][j]->chunk)
+        delete queues[i][j];
+    queues[i].clear();
+  }
+}
+
+void GlobalRegisterFile::EnableBatching(const GlobalRegisterParams& params, int _num_tms)
+{
+  if (params.ops_per_cycle < 1 || params.latency < 1) {
+    printf("ERROR: GLOBALS needs at least 1 op per cycle and a latency of at least 1 (%d, %d)\n",
+           params.ops_per_cycle, params.latency);
+    exit(1);
+  }
+  batched = true;
+  ops_per_cycle = params.ops_per_cycle;
+  latency = params.latency;
+  num_tms = _num_tms;
+  batches.resize(num_tms);
+  pending.resize(num_tms);
+  queues.resize(num_registers);
+  reg_ops.resize(num_registers, 0);
+  reg_wait_cycles.resize(num_registers, 0);
+  reg_max_depth.resize(num_registers, 0);
+  reg_wait_histogram.resize(num_registers, std::vector<long long int>(1, 0));
+}
+
+void GlobalRegisterFile::EnableWorkQueue(const WorkQueueParams& params, int _num_tms)
+{
+  work_distributor = new WorkDistributor(this, params, _num_tms);
+}
+
+void GlobalRegisterFile::EnableSyncQueues(const SyncWakeParams& params)
+{
+  sync_queues = new SyncQueues(this, params);
 }
 
 int GlobalRegisterFile::ReadInt(int which_reg) const
@@ -94,7 +178,7 @@ bool GlobalRegisterFile::SupportsOp(Instruction::Opcode op) const
   return false;
 }
 
-bool GlobalRegisterFile::AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState* thread)
+void GlobalRegisterFile::Report(long long int cycle)
 {
   static bool first_time = true;
 #ifndef WIN32
@@ -102,6 +186,60 @@ bool GlobalRegisterFile::AcceptInstruction(Instruction& ins, IssueUnit* issuer,
 #else
   static time_t start_time;
 #endif
+  if (report_period > 0 && last_report_cycle + report_period < cycle)
+  {
+#ifndef WIN32
+    timeval current_time;
+    gettimeofday( &current_time, NULL );
+    if (first_time)
+    {
+      start_time = current_time;
+      first_time = false;
+    }
+    printf("On cycle %lld\tTime(ms)\t%ld\tRegs\t", cycle,
+           (current_time.tv_sec - start_time.tv_sec)*1000 + (current_time.tv_usec - start_time.tv_usec)/1000 );
+    print();
+#else
+    time_t current_time = time( NULL );
+    if (first_time)
+    {
+      start_time = current_time;
+      first_time = false;
+    }
+    const double diffTimeSec = difftime(current_time, start_time);
+    printf("On cycle %lld\tTime(ms)\t%ld\tRegs\t", cycle, static_cast<unsigned long long>(diffTimeSec*1000));
+    print();
+#endif
+    fflush(stdout);
+    last_report_cycle += report_period;
+  }
+}
+
+bool GlobalRegisterFile::AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState* thread)
+{
+  if (work_distributor && work_distributor->Handles(ins, issuer->current_cycle, thread))
+    return work_distributor->AcceptInstruction(ins, issuer, thread);
+
+  if (thread->sync_granted)
+  {
+    // the semaphore was handed to the thread when it was released, so its
+    // SEM_ACQ is already done
+    thread->sync_granted = false;
+    if (batched)
+    {
+      std::map<ThreadState*, Request*>::iterator it = pending[thread->core_id].find(thread);
+      if (it != pending[thread->core_id].end())
+      {
+        delete it->second;
+        pending[thread->core_id].erase(it);
+      }
+    }
+    return true;
+  }
+
+  if (batched)
+    return AcceptBatched(ins, issuer, thread);
+
   if (issued_this_cycle >= 1) return false;
   int write_reg = ins.args[0];
   long long int write_cycle = issuer->current_cycle + latency;
@@ -161,34 +299,8 @@ bool GlobalRegisterFile::AcceptInstruction(Instruction& ins, IssueUnit* issuer,
       result.udata = ReadUint(arg1.udata);
 
       // report if enough cycles have passed (--atominc-report)
-      if (report_period > 0 && last_report_cycle + report_period < issuer->current_cycle)
-      {
-#ifndef WIN32
-        timeval current_time;
-        gettimeofday( &current_time, NULL );
-        if (first_time)
-        {
-          start_time = current_time;
-          first_time = false;
-        }
-        printf("On cycle %lld\tTime(ms)\t%ld\tRegs\t", issuer->current_cycle,
-               (current_time.tv_sec - start_time.tv_sec)*1000 + (current_time.tv_usec - start_time.tv_usec)/1000 );
-        print();
-#else
-        time_t current_time = time( NULL );
-        if (first_time)
-        {
-          start_time = current_time;
-          first_time = false;
-        }
-        const double diffTimeSec = difftime(current_time, start_time);
-        printf("On cycle %lld\tTime(ms)\t%ld\tRegs\t", issuer->current_cycle, static_cast<unsigned long long>(diffTimeSec*1000));
-        print();
-#endif
-        fflush(stdout);
-        last_report_cycle += report_period;
-      }
-      
+      Report(issuer->current_cycle);
+
       if(ins.op  == Instruction::ATOMIC_INC)
 	WriteUint(arg1.udata, result.udata+1);
       else
@@ -222,6 +334,8 @@ bool GlobalRegisterFile::AcceptInstruction(Instruction& ins, IssueUnit* issuer,
       result.udata = ReadUint(arg0.udata);
       if(result.udata != 0)
       {
+        if (sync_queues)
+          sync_queues->Block(arg0.udata, ins.op, thread, issuer, issuer->current_cycle);
         pthread_mutex_unlock(&global_mutex);
         return false;
       }
@@ -235,8 +349,10 @@ bool GlobalRegisterFile::AcceptInstruction(Instruction& ins, IssueUnit* issuer,
       // Check if the semaphore is already locked
       if(result.udata != 0)
       {
+        if (sync_queues)
+          sync_queues->Block(arg0.udata, ins.op, thread, issuer, issuer->current_cycle);
         pthread_mutex_unlock(&global_mutex);
-        return false; // instruction fails to issue, will automatically retry
+        return false; // instruction fails to issue, will automatically retry (or sleep with SYNCWAKE)
       }
       else // Otherwise, lock it (set it to 1)
         WriteUint(arg0.udata, 1);
@@ -287,12 +403,288 @@ bool GlobalRegisterFile::AcceptInstruction(Instruction& ins, IssueUnit* issuer,
     }
   }
 
+  // wake any threads waiting on a register this released
+  if (sync_queues)
+  {
+    if (ins.op == Instruction::BARRIER || ins.op == Instruction::SEM_ACQ ||
+        ins.op == Instruction::SEM_REL || ins.op == Instruction::GLOBAL_STORE)
+      sync_queues->Changed(arg0.udata, issuer->current_cycle);
+    else
+      sync_queues->Changed(arg1.udata, issuer->current_cycle);
+  }
+
   pthread_mutex_unlock(&global_mutex);
   issued_this_cycle++;
 
   return true;
 }
 
+void GlobalRegisterFile::ReadArgs(Instruction& ins, long long int cycle, ThreadState* thread, Request* request)
+{
+  reg_value which;
+  Instruction::Opcode failop = Instruction::NOP;
+  bool read = true;
+  request->arg.udata = 0;
+  switch (ins.op)
+  {
+    case Instruction::ATOMIC_ADD:
+      read = thread->ReadRegister(ins.args[1], cycle, which, failop) &&
+        thread->ReadRegister(ins.args[2], cycle, request->arg, failop);
+      break;
+
+    case Instruction::BARRIER:
+    case Instruction::SEM_ACQ:
+    case Instruction::SEM_REL:
+      read = thread->ReadRegister(ins.args[0], cycle, which, failop);
+      break;
+
+    case Instruction::GLOBAL_STORE:
+      read = thread->ReadRegister(ins.args[0], cycle, which, failop) &&
+        thread->ReadRegister(ins.args[1], cycle, request->arg, failop);
+      break;
+
+    default:
+      read = thread->ReadRegister(ins.args[1], cycle, which, failop);
+      break;
+  }
+  if (!read)
+  {
+    // bad stuff happened
+    printf("Error in GlobalRegisterFile. Should have passed.\n");
+  }
+  if (which.idata < 0 || which.idata >= num_registers)
+  {
+    printf("ERROR: global register %d out of range (--num-globals %d)\n", which.idata, num_registers);
+    exit(1);
+  }
+  request->op = ins.op;
+  request->reg = which.idata;
+  request->cycle = cycle;
+  request->done = false;
+  request->failed = false;
+  request->result.udata = 0;
+  request->thread = thread;
+  request->issuer = NULL;
+  request->chunk = NULL;
+}
+
+bool GlobalRegisterFile::AcceptBatched(Instruction& ins, IssueUnit* issuer, ThreadState* thread)
+{
+  // a TM only touches its own requests until every TM has been clocked
+  // and Service runs, so there is nothing to lock
+  long long int cycle = issuer->current_cycle;
+  int tm = (int)thread->core_id;
+  std::map<ThreadState*, Request*>::iterator it = pending[tm].find(thread);
+  Request* request = it == pending[tm].end() ? NULL : it->second;
+  if (request && !request->done)
+    return false;
+
+  if (request && request->failed)
+  {
+    // the barrier or semaphore wasn't free, ask again
+    pending[tm].erase(it);
+    delete request;
+    request = NULL;
+  }
+  if (!request)
+  {
+    request = new Request;
+    ReadArgs(ins, cycle, thread, request);
+    request->issuer = issuer;
+    pending[tm][thread] = request;
+    batches[tm].push_back(request);
+    return false;
+  }
+
+  // served, issue with the result
+  if (ins.op != Instruction::BARRIER     // these ops don't write anything to thread's RF
+      && ins.op != Instruction::SEM_ACQ
+      && ins.op != Instruction::SEM_REL
+      && ins.op != Instruction::GLOBAL_STORE)
+  {
+    long long int write_cycle = request->ready_cycle > cycle ? request->ready_cycle : cycle + 1;
+    if (!thread->QueueWrite(ins.args[0], request->result, write_cycle, ins.op, &ins))
+    {
+      // pipeline hazzard, the op is already done so just try again
+      return false;
+    }
+  }
+  pending[tm].erase(thread);
+  delete request;
+  return true;
+}
+
+void GlobalRegisterFile::Execute(Request* request, long long int cycle)
+{
+  int reg = request->reg;
+  long long int wait = cycle - request->cycle;
+  reg_ops[reg]++;
+  reg_wait_cycles[reg] += wait;
+  size_t bucket = 0;
+  while ((1LL << bucket) <= wait)
+    bucket++;
+  if (bucket >= reg_wait_histogram[reg].size())
+    reg_wait_histogram[reg].resize(bucket + 1, 0);
+  reg_wait_histogram[reg][bucket]++;
+
+  reg_value& result = request->result;
+  switch (request->op)
+  {
+    case Instruction::ATOMIC_INC:
+    case Instruction::ATOMIC_DEC:
+      result.udata = ReadUint(reg);
+      Report(cycle);
+      if (request->op == Instruction::ATOMIC_INC)
+        WriteUint(reg, result.udata + 1);
+      else
+        WriteUint(reg, result.udata - 1);
+      break;
+
+    case Instruction::ATOMIC_ADD:
+      result.udata = ReadUint(reg) + request->arg.udata;
+      WriteUint(reg, result.udata);
+      break;
+
+    case Instruction::GLOBAL_READ:
+      result.udata = ReadUint(reg);
+      break;
+
+    case Instruction::GLOBAL_STORE:
+      WriteUint(reg, request->arg.udata);
+      break;
+
+    case Instruction::INC_RESET:
+      result.udata = ReadUint(reg);
+      if (result.udata == total_system_threads - 1)
+        WriteUint(reg, 0);
+      else
+        WriteUint(reg, result.udata + 1);
+      break;
+
+    case Instruction::BARRIER:
+      request->failed = ReadUint(reg) != 0;
+      break;
+
+    case Instruction::SEM_ACQ:
+      request->failed = ReadUint(reg) != 0;
+      if (!request->failed)
+        WriteUint(reg, 1);
+      break;
+
+    case Instruction::SEM_REL:
+      WriteUint(reg, 0);
+      break;
+
+    default:
+      fprintf(stderr, "ERROR GlobalRegisterFile FOUND SOME OTHER OP\n");
+      break;
+  };
+
+  if (request->failed)
+  {
+    retries++;
+    // sleep until a release rather than being sent again right away
+    if (sync_queues)
+      sync_queues->Block(reg, request->op, request->thread, request->issuer, cycle);
+  }
+  else if (sync_queues)
+    sync_queues->Changed(reg, cycle);
+  request->ready_cycle = cycle + latency;
+  request->done = true;
+
+  // no thread waits on a refill, it goes straight to its chunk
+  if (request->chunk)
+  {
+    work_distributor->Filled(request->chunk, result.udata - request->arg.udata, cycle);
+    delete request;
+  }
+}
+
+void GlobalRegisterFile::QueueRefill(int tm, WorkDistributor::Chunk* chunk, long long int cycle)
+{
+  Request* request = new Request;
+  request->op = Instruction::ATOMIC_ADD;
+  request->reg = work_distributor->reg;
+  request->arg.udata = work_distributor->chunk_size;
+  request->cycle = cycle;
+  request->done = false;
+  request->failed = false;
+  request->result.udata = 0;
+  request->thread = NULL;
+  request->issuer = NULL;
+  request->chunk = chunk;
+  batches[tm].push_back(request);
+}
+
+void GlobalRegisterFile::Service(long long int cycle)
+{
+  // the work distributor's refills join this cycle's requests
+  if (work_distributor)
+    work_distributor->Service(cycle);
+  if (!batched)
+    return;
+
+  // queue this cycle's requests, TM by TM
+  long long int batch = 0;
+  for (int tm = 0; tm < num_tms; tm++)
+  {
+    for (size_t i = 0; i < batches[tm].size(); i++)
+    {
+      Request* request = batches[tm][i];
+      std::deque<Request*>& queue = queues[request->reg];
+      queue.push_back(request);
+      if ((int)queue.size() > reg_max_depth[request->reg])
+        reg_max_depth[request->reg] = (int)queue.size();
+    }
+    batch += batches[tm].size();
+    batches[tm].clear();
+  }
+  requests += batch;
+  if (batch > max_batch)
+    max_batch = batch;
+
+  // each register serves its oldest op, starting after the last one that served
+  int served = 0;
+  int last = -1;
+  for (int i = 0; i < num_registers && served < ops_per_cycle; i++)
+  {
+    int reg = (next_reg + i) % num_registers;
+    if (queues[reg].empty())
+      continue;
+    Execute(queues[reg].front(), cycle);
+    queues[reg].pop_front();
+    served++;
+    last = reg;
+  }
+  if (last >= 0)
+    next_reg = (last + 1) % num_registers;
+}
+
+void GlobalRegisterFile::PrintStats()
+{
+  printf(" GLOBALS: %d ops per cycle, latency %d\n", ops_per_cycle, latency);
+  printf("   requests: %lld (up to %lld in one cycle), BARRIER/SEM_ACQ sent again: %lld\n",
+         requests, max_batch, retries);
+  for (int reg = 0; reg < num_registers; reg++)
+  {
+    if (reg_ops[reg] == 0)
+      continue;
+    printf("   register %d: %lld ops, waited %.2f cycles average, queue up to %d\n", reg, reg_ops[reg],
+           static_cast<double>(reg_wait_cycles[reg]) / reg_ops[reg], reg_max_depth[reg]);
+    printf("     cycles waited:");
+    for (size_t i = 0; i < reg_wait_histogram[reg].size(); i++)
+    {
+      if (reg_wait_histogram[reg][i] == 0)
+        continue;
+      if (i < 2)
+        printf(" %d: %lld", (int)i, reg_wait_histogram[reg][i]);
+      else
+        printf(" %lld-%lld: %lld", 1LL << (i - 1), (1LL << i) - 1, reg_wait_histogram[reg][i]);
+    }
+    printf("\n");
+  }
+}
+
 // From HardwareModule
 void GlobalRegisterFile::ClockRise() {}
 
@@ -5,10 +5,49 @@
 
 // Global int registers with adders and counters built in
 // services ATOMIC_INC and ATOMIC_ADD instructions
+//
+// By default the registers are shared by every TM under global_mutex and
+// take one op per cycle with no queuing. A GLOBALS line in the config file
+// models them as a unit clocked once per cycle instead:
+//
+//   GLOBALS <ops per cycle> <latency>
+//
+// A thread's global register op is sent to the unit the cycle it is ready
+// to issue, and the thread stalls until it is served. After every TM has
+// been clocked, that cycle's requests are queued per register (in TM
+// order), and up to <ops per cycle> registers serve the oldest op in
+// their queue, one op per register per cycle. The thread then issues with
+// its result written <latency> cycles after it was served. A BARRIER that
+// finds its register nonzero or a SEM_ACQ that finds it taken is sent
+// again. Each register keeps a histogram of the cycles its ops waited.
+//
+// A WORKQUEUE line puts a work distributor in front of one register (see
+// WorkDistributor.h), which serves the ATOMIC_INCs on it, and a SYNCWAKE
+// line puts threads blocked on a BARRIER or SEM_ACQ to sleep until the
+// register is released instead of retrying (see SyncQueues.h).
 #include "FunctionalUnit.h"
+#include "SimpleRegisterFile.h"
+#include "SyncQueues.h"
+#include "WorkDistributor.h"
+#include <deque>
+#include <map>
+#include <vector>
 
 extern pthread_mutex_t global_mutex;
 
+class ThreadState;
+
+// GLOBALS config line parameters
+struct GlobalRegisterParams {
+  bool enabled;
+  int ops_per_cycle;
+  int latency;
+
+  GlobalRegisterParams() :
+    enabled(false), ops_per_cycle(1), latency(1)
+  {}
+};
+
 class GlobalRegisterFile : public FunctionalUnit {
  public:
   GlobalRegisterFile(int num_regs, unsigned int sys_threads, unsigned int report_period);
@@ -16,6 +55,19 @@ class GlobalRegisterFile : public FunctionalUnit {
 
   void Reset();
 
+  // Queue requests in batches per TM and serve them once a cycle (GLOBALS line)
+  void EnableBatching(const GlobalRegisterParams& params, int num_tms);
+  // Serve the requests made in cycle, once every TM has been clocked
+  void Service(long long int cycle);
+  // Queue a work distributor's refill of chunk for TM tm made in cycle,
+  // served like a thread's ATOMIC_ADD of the chunk size
+  void QueueRefill(int tm, WorkDistributor::Chunk* chunk, long long int cycle);
+  void PrintStats();
+  // Serve ATOMIC_INCs on a register from per TM work queues (WORKQUEUE line)
+  void EnableWorkQueue(const WorkQueueParams& params, int num_tms);
+  // Sleep on BARRIER and SEM_ACQ until woken by a release (SYNCWAKE line)
+  void EnableSyncQueues(const SyncWakeParams& params);
+
   int ReadInt(int which_reg) const;
   unsigned int ReadUint(int which_reg) const;
   float ReadFloat(int which_reg) const;
@@ -42,6 +94,55 @@ class GlobalRegisterFile : public FunctionalUnit {
   unsigned int total_system_threads;
   unsigned int last_report_cycle;
   unsigned int report_period;
+
+  // batching, see GLOBALS above
+  bool batched;
+  int ops_per_cycle;
+  long long int requests;
+  long long int retries;
+  long long int max_batch;
+  // per register: ops served, cycles they waited, the longest queue, and
+  // how many waited 0, 1, 2-3, 4-7, ... cycles
+  std::vector<long long int> reg_ops;
+  std::vector<long long int> reg_wait_cycles;
+  std::vector<int> reg_max_depth;
+  std::vector<std::vector<long long int> > reg_wait_histogram;
+
+  // NULL without a WORKQUEUE line
+  WorkDistributor* work_distributor;
+  // NULL without a SYNCWAKE line
+  SyncQueues* sync_queues;
+
+ private:
+  struct Request {
+    Instruction::Opcode op;
+    int reg;
+    reg_value arg;
+    long long int cycle;        // sent
+    bool done;
+    bool failed;                // a BARRIER or SEM_ACQ to send again
+    reg_value result;
+    long long int ready_cycle;
+    ThreadState* thread;
+    IssueUnit* issuer;
+    WorkDistributor::Chunk* chunk;  // a work distributor refill, not a thread's op
+  };
+
+  // --atominc-report
+  void Report(long long int cycle);
+  // Read the register and operand of ins into request
+  void ReadArgs(Instruction& ins, long long int cycle, ThreadState* thread, Request* request);
+  bool AcceptBatched(Instruction& ins, IssueUnit* issuer, ThreadState* thread);
+  void Execute(Request* request, long long int cycle);
+  void ClearRequests();
+
+  int num_tms;
+  // per TM: requests sent this cycle, and each waiting thread's request
+  std::vector<std::vector<Request*> > batches;
+  std::vector<std::map<ThreadState*, Request*> > pending;
+  std::vector<std::deque<Request*> > queues;
+  // the register that serves first next cycle
+  int next_reg;
 };
 
 #endif // _SIMHWRT_GLOBAL_REGISTER_FILE_H_
@@ -1,6 +1,9 @@
 #ifndef _SIMHWRT_HARDWARE_MODULE_H_
 #define _SIMHWRT_HARDWARE_MODULE_H_
 
+// Returned by NextEventCycle() when a module has nothing scheduled
+#define NO_EVENT_CYCLE 0x7fffffffffffffffLL
+
 class HardwareModule {
 public:
   virtual ~HardwareModule(){}
@@ -10,6 +13,14 @@ public:
   virtual double Utilization() { return 0.; }
   virtual bool ReportUtilization(int& processed, int& max_process) { return false; }
 
+  // Cycle skipping: the earliest cycle at which this module can change
+  // state if no new work arrives. Modules that must see every cycle
+  // return -1, which disables skipping.
+  virtual long long int NextEventCycle() { return -1; }
+  // Advance over num_cycles cycles in which nothing happens, crediting any
+  // per-cycle statistics in bulk. Only called after NextEventCycle() said so.
+  virtual void SkipCycles(long long int num_cycles) {}
+
   float area;
   float energy;
 
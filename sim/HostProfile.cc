@@ -0,0 +1,114 @@
+#include "HostProfile.h"
+#include "HardwareModule.h"
+#include "MemoryBase.h"
+#include "TraxCore.h"
+
+#include <stdlib.h>
+#include <typeinfo>
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+HostProfile::HostProfile()
+{
+  L2_slot = Slot("L2Cache");
+  dram_slot = Slot("USIMM");
+  sampler_slot = Slot("StatsSampler");
+  sync_slot = Slot("thread sync");
+  loop_slot = Slot("loop bookkeeping");
+}
+
+HostProfile::~HostProfile()
+{
+  for(size_t i = 0; i < counters.size(); i++)
+    delete counters[i];
+}
+
+int HostProfile::Slot(const std::string& name)
+{
+  for(size_t i = 0; i < names.size(); i++)
+    if(names[i] == name)
+      return (int)i;
+  names.push_back(name);
+  return (int)names.size() - 1;
+}
+
+std::string HostProfile::TypeName(HardwareModule* module)
+{
+  const char* name = typeid(*module).name();
+#ifdef __GNUG__
+  int status;
+  char* demangled = abi::__cxa_demangle(name, NULL, NULL, &status);
+  if(status == 0 && demangled) {
+    std::string result(demangled);
+    free(demangled);
+    return result;
+  }
+#endif
+  return std::string(name);
+}
+
+void HostProfile::AddCores(std::vector<TraxCore*>& cores)
+{
+  module_slots.resize(cores.size());
+  for(size_t i = 0; i < cores.size(); i++) {
+    std::vector<HardwareModule*>& modules = cores[i]->modules;
+    module_slots[i].resize(modules.size());
+    for(size_t j = 0; j < modules.size(); j++)
+      module_slots[i][j] = Slot(TypeName(modules[j]));
+  }
+}
+
+HostProfileCounters* HostProfile::NewCounters()
+{
+  HostProfileCounters* thread_counters = new HostProfileCounters;
+  thread_counters->rise_ns.resize(names.size(), 0);
+  thread_counters->fall_ns.resize(names.size(), 0);
+  thread_counters->calls.resize(names.size(), 0);
+  counters.push_back(thread_counters);
+  return thread_counters;
+}
+
+void HostProfile::Report(long long int simulated_cycles, FILE* output)
+{
+  std::vector<long long int> rise(names.size(), 0);
+  std::vector<long long int> fall(names.size(), 0);
+  std::vector<long long int> calls(names.size(), 0);
+  long long int total = 0;
+  for(size_t t = 0; t < counters.size(); t++) {
+    for(size_t i = 0; i < names.size(); i++) {
+      rise[i] += counters[t]->rise_ns[i];
+      fall[i] += counters[t]->fall_ns[i];
+      calls[i] += counters[t]->calls[i];
+      total += counters[t]->rise_ns[i] + counters[t]->fall_ns[i];
+    }
+  }
+  if(simulated_cycles < 1)
+    simulated_cycles = 1;
+
+  // print the most expensive entries first
+  std::vector<int> order;
+  for(size_t i = 0; i < names.size(); i++)
+    if(calls[i] > 0)
+      order.push_back((int)i);
+  for(size_t i = 1; i < order.size(); i++)
+    for(size_t j = i; j > 0 && rise[order[j]] + fall[order[j]] > rise[order[j-1]] + fall[order[j-1]]; j--) {
+      int temp = order[j];
+      order[j] = order[j-1];
+      order[j-1] = temp;
+    }
+
+  fprintf(output, "Host profile (%d simulation thread(s), %lld simulated cycles)\n",
+	  (int)counters.size(), simulated_cycles);
+  fprintf(output, "\t%-24s %14s %12s %12s %12s %7s\n", "module", "calls", "rise ns/cyc",
+	  "fall ns/cyc", "total ns/cyc", "% host");
+  for(size_t k = 0; k < order.size(); k++) {
+    int i = order[k];
+    fprintf(output, "\t%-24s %14lld %12.1f %12.1f %12.1f %7.2f\n", names[i].c_str(), calls[i],
+	    rise[i] / (double)simulated_cycles, fall[i] / (double)simulated_cycles,
+	    (rise[i] + fall[i]) / (double)simulated_cycles,
+	    total > 0 ? 100. * (rise[i] + fall[i]) / total : 0.);
+  }
+  fprintf(output, "\t%-24s %14s %12s %12s %12.1f\n\n", "total", "", "", "",
+	  total / (double)simulated_cycles);
+}
@@ -0,0 +1,80 @@
+#ifndef _SIMHWRT_HOST_PROFILE_H_
+#define _SIMHWRT_HOST_PROFILE_H_
+
+// Host-side profiling of the simulator itself: where does the host time go,
+// as opposed to the simulated time reported everywhere else.
+//
+// Compiled out by default. Build with -DHOST_PROFILE=1 (make
+// CXXFLAGS+=-DHOST_PROFILE=1, or cmake -DSIMTRAX_HOST_PROFILE=ON) and every
+// ClockRise/ClockFall call is timed and charged to its module type (the
+// dynamic type of the HardwareModule, so all FPMul units share one entry),
+// along with the L2s, USIMM, the stats sampler, thread synchronization and
+// the per-cycle bookkeeping of the simulation loop. A table of host
+// nanoseconds per simulated cycle for each entry is printed after the run.
+//
+// Each simulation thread accumulates into its own HostProfileCounters, so
+// timing adds no sharing between threads. Entries are summed over threads,
+// so with more than one simulation thread they are CPU time, not wall time.
+
+#ifndef HOST_PROFILE
+#define HOST_PROFILE 0
+#endif
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <boost/chrono.hpp>
+
+class HardwareModule;
+class TraxCore;
+
+struct HostProfileCounters {
+  std::vector<long long int> rise_ns;
+  std::vector<long long int> fall_ns;
+  std::vector<long long int> calls;
+
+  inline void Add(int slot, long long int rise, long long int fall) {
+    rise_ns[slot] += rise;
+    fall_ns[slot] += fall;
+    calls[slot]++;
+  }
+};
+
+class HostProfile {
+public:
+  HostProfile();
+  ~HostProfile();
+
+  // Find or add the entry for a name, must be called before NewCounters()
+  int Slot(const std::string& name);
+
+  // Assign an entry to every module of every core, by module type
+  void AddCores(std::vector<TraxCore*>& cores);
+
+  // One set of counters per simulation thread
+  HostProfileCounters* NewCounters();
+
+  void Report(long long int simulated_cycles, FILE* output);
+
+  static inline long long int Now() {
+    return boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+      boost::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  // module_slots[core_id][i] is the entry for cores[core_id]->modules[i]
+  std::vector< std::vector<int> > module_slots;
+
+  int L2_slot;
+  int dram_slot;
+  int sampler_slot;
+  int sync_slot;
+  int loop_slot;
+
+private:
+  static std::string TypeName(HardwareModule* module);
+
+  std::vector<std::string> names;
+  std::vector<HostProfileCounters*> counters;
+};
+
+#endif // _SIMHWRT_HOST_PROFILE_H_
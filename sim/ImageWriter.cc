@@ -0,0 +1,135 @@
+#include "ImageWriter.h"
+#include "lodepng.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+ImageWriter::ImageWriter(const char* _output_prefix, bool _use_png, int _image_width, int _image_height)
+  :use_png(_use_png), image_width(_image_width), image_height(_image_height)
+{
+  strncpy(output_prefix, _output_prefix, sizeof(output_prefix) - 1);
+  output_prefix[sizeof(output_prefix) - 1] = '\0';
+
+  framebuffer_size = 3 * image_width * image_height;
+  pending = new FourByte[framebuffer_size];
+  working = new FourByte[framebuffer_size];
+  rgb = new unsigned char[framebuffer_size];
+  pending_frame = 0;
+  has_pending = false;
+  done = false;
+  frames_written = 0;
+  frames_dropped = 0;
+
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cond, NULL);
+  if(pthread_create(&thread, NULL, WriterThread, (void*)this) != 0) {
+    printf("ERROR: unable to create image writer thread\n");
+    exit(1);
+  }
+}
+
+ImageWriter::~ImageWriter()
+{
+  Finish();
+  pthread_mutex_destroy(&mutex);
+  pthread_cond_destroy(&cond);
+  delete[] pending;
+  delete[] working;
+  delete[] rgb;
+}
+
+void ImageWriter::Snapshot(const FourByte* framebuffer, int frame_num)
+{
+  pthread_mutex_lock(&mutex);
+  if(has_pending)
+    frames_dropped++;
+  memcpy(pending, framebuffer, framebuffer_size * sizeof(FourByte));
+  pending_frame = frame_num;
+  has_pending = true;
+  pthread_cond_signal(&cond);
+  pthread_mutex_unlock(&mutex);
+}
+
+void ImageWriter::Finish()
+{
+  pthread_mutex_lock(&mutex);
+  if(done) {
+    pthread_mutex_unlock(&mutex);
+    return;
+  }
+  done = true;
+  pthread_cond_signal(&cond);
+  pthread_mutex_unlock(&mutex);
+  pthread_join(thread, NULL);
+}
+
+void* ImageWriter::WriterThread(void* args)
+{
+  static_cast<ImageWriter*>(args)->Run();
+  return NULL;
+}
+
+void ImageWriter::Run()
+{
+  char filename[512];
+  while(true) {
+    pthread_mutex_lock(&mutex);
+    while(!has_pending && !done)
+      pthread_cond_wait(&cond, &mutex);
+    if(!has_pending) {
+      // done and nothing left to write
+      pthread_mutex_unlock(&mutex);
+      return;
+    }
+    FourByte* temp = working;
+    working = pending;
+    pending = temp;
+    int frame_num = pending_frame;
+    has_pending = false;
+    pthread_mutex_unlock(&mutex);
+
+    ConvertFramebuffer(working, image_width, image_height, rgb);
+    sprintf(filename, "%s%d.%s", output_prefix, frame_num, use_png ? "png" : "ppm");
+    if(WriteImage(filename, rgb, image_width, image_height, use_png))
+      frames_written++;
+  }
+}
+
+void ImageWriter::ConvertFramebuffer(const FourByte* framebuffer, int width, int height, unsigned char* rgb)
+{
+  unsigned char* out = rgb;
+  for(int j = height - 1; j >= 0; j--) {
+    const FourByte* row = framebuffer + 3 * j * width;
+    for(int i = 0; i < 3 * width; i++)
+      *out++ = (unsigned char)(int)(row[i].fvalue * 255);
+  }
+}
+
+bool ImageWriter::WriteImage(const char* filename, const unsigned char* rgb, int width, int height, bool use_png)
+{
+  if(use_png) {
+    unsigned char* png = NULL;
+    size_t pngsize;
+    unsigned error = lodepng_encode24(&png, &pngsize, rgb, width, height);
+    if(!error)
+      error = lodepng_save_file(png, pngsize, filename);
+    free(png);
+    if(error) {
+      printf("Error %u: %s\n", error, lodepng_error_text(error));
+      return false;
+    }
+    return true;
+  }
+
+  FILE* output = fopen(filename, "wb");
+  if(!output) {
+    printf("Error: Failed to open image output file: %s\n", filename);
+    return false;
+  }
+  fprintf(output, "P6\n%d %d\n%d\n", width, height, 255);
+  size_t num_bytes = 3 * (size_t)width * height;
+  bool success = fwrite(rgb, 1, num_bytes, output) == num_bytes;
+  fclose(output);
+  return success;
+}
@@ -0,0 +1,63 @@
+#ifndef _SIMHWRT_IMAGE_WRITER_H_
+#define _SIMHWRT_IMAGE_WRITER_H_
+
+// Framebuffer image output.
+//
+// The static helpers convert the float framebuffer in simulated memory to
+// 8-bit RGB in one pass and write it with a single fwrite (PPM) or through
+// lodepng (PNG).
+//
+// An ImageWriter instance is used for --incremental-output. Snapshot() only
+// copies the framebuffer region into a pending buffer and returns, a
+// background pthread converts and writes the image. If the writer falls
+// behind, the pending snapshot is replaced by the newer one so the
+// simulation never waits on disk.
+
+#include "FourByte.h"
+#include <pthread.h>
+
+class ImageWriter {
+public:
+  ImageWriter(const char* _output_prefix, bool _use_png, int _image_width, int _image_height);
+  ~ImageWriter();
+
+  // Copy the framebuffer (3 floats per pixel) and queue it for writing as
+  // <prefix><frame_num>.<ext>. Does not block on file I/O.
+  void Snapshot(const FourByte* framebuffer, int frame_num);
+
+  // Write any pending snapshot and stop the background thread
+  void Finish();
+
+  // Convert a float RGB framebuffer to 8-bit RGB, flipping rows so the
+  // first row of the result is the top of the image
+  static void ConvertFramebuffer(const FourByte* framebuffer, int width, int height, unsigned char* rgb);
+
+  // Write 8-bit RGB pixels as binary PPM or PNG. Returns false on failure.
+  static bool WriteImage(const char* filename, const unsigned char* rgb, int width, int height, bool use_png);
+
+  long long int frames_written;
+  long long int frames_dropped;
+
+private:
+  static void* WriterThread(void* args);
+  void Run();
+
+  char output_prefix[256];
+  bool use_png;
+  int image_width, image_height;
+  int framebuffer_size;
+
+  // double buffer: Snapshot() fills pending, the writer thread owns working
+  FourByte* pending;
+  FourByte* working;
+  unsigned char* rgb;
+  int pending_frame;
+  bool has_pending;
+  bool done;
+
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+};
+
+#endif // _SIMHWRT_IMAGE_WRITER_H_
@@ -27,6 +27,7 @@ Instruction::Instruction(Opcode code,
   asmLine = "";
   lineNum = 0;
 
+  DecodeSources();
 }
 
 Instruction::Instruction(Opcode code,
@@ -51,6 +52,8 @@ Instruction::Instruction(Opcode code,
   srcInfo = _srcInfo;
   asmLine = _asmLine;
   lineNum = _lineNum;
+
+  DecodeSources();
 }
 
 Instruction::Instruction(const Instruction& ins)
@@ -70,6 +73,10 @@ Instruction::Instruction(const Instruction& ins)
   srcInfo = ins.srcInfo;
   asmLine = ins.asmLine;
   lineNum = ins.lineNum;
+
+  num_source_regs = ins.num_source_regs;
+  for (int i = 0; i < num_source_regs; i++)
+    source_regs[i] = ins.source_regs[i];
 }
 
 bool Instruction::RayReady(int ray_start, long long int* writes_in_flight, int kNoBlock) const
@@ -87,7 +94,7 @@ bool Instruction::RayReady(int ray_start, long long int* writes_in_flight, int k
   return true;
 }
 
-bool Instruction::ReadyToIssue(long long int* register_ready, int* fail_reg, long long int cur_cycle) const
+bool Instruction::ReadyToIssueSwitch(long long int* register_ready, int* fail_reg, long long int cur_cycle) const
 {
   // This function needs to check if the registers that would be read by
   // the given op would be ready by the given cycle
@@ -192,6 +199,7 @@ bool Instruction::ReadyToIssue(long long int* register_ready, int* fail_reg, lon
     case Instruction::xor_v:
     case Instruction::or_v:
     case Instruction::cle_s_w:
+    case Instruction::ATOMIC_ADD:
 
       // check args[1] and args[2] and choose the first fail_reg if there is a fail.
       if ( (register_ready[args[1]] <= cur_cycle) )
@@ -270,6 +278,10 @@ bool Instruction::ReadyToIssue(long long int* register_ready, int* fail_reg, lon
     case Instruction::slli_w:
     case Instruction::addvi_w:
     case Instruction::clti_s_w:
+    case Instruction::ATOMIC_INC:
+    case Instruction::ATOMIC_DEC:
+    case Instruction::INC_RESET:
+    case Instruction::GLOBAL_READ:
       // check args[1] and select it if it fails
       if ( register_ready[args[1]] <= cur_cycle )
         return true;
@@ -314,6 +326,7 @@ bool Instruction::ReadyToIssue(long long int* register_ready, int* fail_reg, lon
     case Instruction::SETSTRID:
     case Instruction::SEM_ACQ:
     case Instruction::SEM_REL:
+    case Instruction::BARRIER:
 
     case Instruction::bgez:
     case Instruction::bgtz:
@@ -462,6 +475,25 @@ bool Instruction::ReadyToIssue(long long int* register_ready, int* fail_reg, lon
       return true;
       break;
 
+    case Instruction::TRAVERSE:
+      // the root address, then the ray in registers 36 - 42
+      if (register_ready[args[1]] > cur_cycle)
+      {
+        *fail_reg = args[1];
+        return false;
+      }
+      for(int i = 36; i < 43; i++)
+      {
+        if (register_ready[i] > cur_cycle)
+        {
+          *fail_reg = i;
+          return false;
+        }
+      }
+
+      return true;
+      break;
+
     case Instruction::PRINT:
     case Instruction::PRINTF:
       if (register_ready[args[0]] <= cur_cycle)
@@ -489,14 +521,8 @@ bool Instruction::ReadyToIssue(long long int* register_ready, int* fail_reg, lon
       return false;
       break;
 
-      //TODO: these global atomic instructions are always ready to issue (this is wrong though)
-    case Instruction::ATOMIC_INC:
-    case Instruction::ATOMIC_DEC:
-    case Instruction::ATOMIC_ADD:
+      //TODO: ATOMIC_FPADD has no unit implementing it
     case Instruction::ATOMIC_FPADD:
-    case Instruction::INC_RESET:
-    case Instruction::BARRIER:
-    case Instruction::GLOBAL_READ:
       return true;
       break;
 
@@ -505,6 +531,7 @@ bool Instruction::ReadyToIssue(long long int* register_ready, int* fail_reg, lon
     case Instruction::ENDSR:
     case Instruction::STARTSR:
     case Instruction::STREAMR:
+    case Instruction::GETSTRID:
     case Instruction::brlid:
     case Instruction::brid:
     case Instruction::NOP:
@@ -537,11 +564,290 @@ bool Instruction::ReadyToIssue(long long int* register_ready, int* fail_reg, lon
       break;
   };
 
-  printf("Error, Instruction::ReadyToIssue fell through switch\n");
+  printf("Error, Instruction::ReadyToIssueSwitch fell through switch\n");
   exit(1);
   return false;
 }
 
+// Source register table.
+//
+// Which registers each opcode reads, the same information as the switch in
+// ReadyToIssueSwitch but as data, so it can be looked up once per
+// instruction at decode instead of on every issue attempt. A pattern is a
+// string of the registers to check, in order:
+//   '0'-'3'  args[n]
+//   'H' 'L'  HI_REG, LO_REG
+//   'B'      the box registers BOXTEST reads (36-47)
+//   'T'      the triangle registers TRITEST reads (36-50)
+//   'R'      the ray registers TRAVERSE reads (36-42)
+// Opcodes not listed (SPHERE_TEST, and any with no ReadyToIssue definition)
+// keep using the switch.
+
+// args[0]
+static const Instruction::Opcode reads_arg0[] = {
+  Instruction::rtsd, Instruction::BNZ, Instruction::JMPREG, Instruction::brd,
+  Instruction::brad, Instruction::beqid, Instruction::bgeid,
+  Instruction::bgtid, Instruction::bleid, Instruction::bltid,
+  Instruction::bneid, Instruction::STARTSW, Instruction::STREAMW,
+  Instruction::SETSTRID, Instruction::SEM_ACQ, Instruction::SEM_REL,
+  Instruction::BARRIER,
+  Instruction::bgez, Instruction::bgtz, Instruction::blez, Instruction::bltz,
+  Instruction::beqz, Instruction::bnez, Instruction::jr, Instruction::mtc1,
+  Instruction::PRINT, Instruction::PRINTF
+};
+// args[1]
+static const Instruction::Opcode reads_arg1[] = {
+  Instruction::STRSIZE, Instruction::STRSCHED, Instruction::FPCONV,
+  Instruction::INTCONV, Instruction::FPSQRT, Instruction::FPNEG,
+  Instruction::neg_s, Instruction::negu, Instruction::FPINVSQRT,
+  Instruction::FPINV, Instruction::LOAD, Instruction::LOADL1, Instruction::MOV,
+  Instruction::move, Instruction::PROF, Instruction::sra, Instruction::srl,
+  Instruction::bslli, Instruction::bsrli, Instruction::bsrai,
+  Instruction::brld, Instruction::brald, Instruction::braid,
+  Instruction::bralid, Instruction::brk, Instruction::ADDI, Instruction::ANDI,
+  Instruction::ORI, Instruction::XORI, Instruction::xori, Instruction::MULI,
+  Instruction::RSUBI, Instruction::LWI, Instruction::lbui, Instruction::lhui,
+  Instruction::sext8, Instruction::addi, Instruction::not_m,
+  Instruction::addiu, Instruction::andi, Instruction::cvt_s_w,
+  Instruction::mfc1, Instruction::movf, Instruction::movt, Instruction::movt_s,
+  Instruction::movf_s, Instruction::mov_s, Instruction::ori, Instruction::sll,
+  Instruction::slti, Instruction::sltiu, Instruction::sra_m,
+  Instruction::srl_m, Instruction::trunc_w_s, Instruction::fill_w,
+  Instruction::splati_w, Instruction::move_v, Instruction::pcnt_w,
+  Instruction::copy_s_w, Instruction::ffint_s_w, Instruction::frcp_w,
+  Instruction::slli_w, Instruction::addvi_w, Instruction::clti_s_w,
+  Instruction::ATOMIC_INC, Instruction::ATOMIC_DEC, Instruction::INC_RESET,
+  Instruction::GLOBAL_READ
+};
+// args[2]
+static const Instruction::Opcode reads_arg2[] = {
+  Instruction::lb, Instruction::lbu, Instruction::lh, Instruction::lhu,
+  Instruction::lw, Instruction::lwc1, Instruction::ld_w, Instruction::ld_b,
+  Instruction::FTOD
+};
+// args[0], args[1]
+static const Instruction::Opcode reads_args01[] = {
+  Instruction::BLT, Instruction::BET, Instruction::STORE, Instruction::beqd,
+  Instruction::bged, Instruction::bgtd, Instruction::bled, Instruction::bltd,
+  Instruction::bned, Instruction::SWI, Instruction::sbi, Instruction::shi,
+  Instruction::beq, Instruction::bne, Instruction::c_eq_s,
+  Instruction::c_ueq_s, Instruction::c_ole_s, Instruction::c_olt_s,
+  Instruction::c_ule_s, Instruction::c_ult_s, Instruction::div,
+  Instruction::mult, Instruction::multu, Instruction::teq,
+  Instruction::GLOBAL_STORE, Instruction::bseli_b
+};
+// args[0], args[2]
+static const Instruction::Opcode reads_args02[] = {
+  Instruction::sw, Instruction::swc1, Instruction::lwl, Instruction::lwr,
+  Instruction::swl, Instruction::swr, Instruction::sb, Instruction::sh,
+  Instruction::st_w, Instruction::st_b, Instruction::insve_w,
+  Instruction::insert_w
+};
+// args[1], args[2]
+static const Instruction::Opcode reads_args12[] = {
+  Instruction::ADD, Instruction::SUB, Instruction::MUL, Instruction::BITOR,
+  Instruction::BITXOR, Instruction::BITAND, Instruction::BITSLEFT,
+  Instruction::BITSRIGHT, Instruction::ANDN, Instruction::FPADD,
+  Instruction::FPSUB, Instruction::FPRSUB, Instruction::FPMUL,
+  Instruction::FPDIV, Instruction::DIV, Instruction::FPUN,
+  Instruction::FPCMPLT, Instruction::FPMIN, Instruction::FPMAX,
+  Instruction::MOVINDRD, Instruction::MOVINDWR, Instruction::FPEQ,
+  Instruction::FPNE, Instruction::FPLT, Instruction::FPLE, Instruction::FPGT,
+  Instruction::FPGE, Instruction::EQ, Instruction::NE, Instruction::LT,
+  Instruction::LE, Instruction::ADDK, Instruction::ADDKC, Instruction::RSUB,
+  Instruction::CMP, Instruction::CMPU, Instruction::LW, Instruction::bsrl,
+  Instruction::bsra, Instruction::bsll, Instruction::addu, Instruction::add_s,
+  Instruction::and_m, Instruction::div_s, Instruction::movn,
+  Instruction::movn_s, Instruction::movz_s, Instruction::movz,
+  Instruction::mul, Instruction::mul_s, Instruction::nor, Instruction::or_m,
+  Instruction::slt, Instruction::sltu, Instruction::subu, Instruction::sub_s,
+  Instruction::xor_m, Instruction::sllv, Instruction::srav, Instruction::srlv,
+  Instruction::lsa, Instruction::fmul_w, Instruction::fadd_w,
+  Instruction::fclt_w, Instruction::and_v, Instruction::mulv_w,
+  Instruction::div_s_w, Instruction::mod_s_w, Instruction::subv_w,
+  Instruction::ceq_w, Instruction::fdiv_w, Instruction::clt_s_w,
+  Instruction::fsub_w, Instruction::addv_w, Instruction::xor_v,
+  Instruction::or_v, Instruction::cle_s_w, Instruction::ATOMIC_ADD
+};
+// args[0], args[1], args[2]
+static const Instruction::Opcode reads_args012[] = {
+  Instruction::SW, Instruction::fmadd_w, Instruction::fmsub_w,
+  Instruction::bmnz_v, Instruction::msubv_w
+};
+// nothing
+static const Instruction::Opcode reads_nothing[] = {
+  Instruction::ATOMIC_FPADD, Instruction::ENDSW, Instruction::ENDSR,
+  Instruction::STARTSR, Instruction::STREAMR, Instruction::GETSTRID,
+  Instruction::brlid, Instruction::brid, Instruction::NOP, Instruction::RAND,
+  Instruction::HALT,
+  Instruction::SETBOXPIPE, Instruction::SETTRIPIPE, Instruction::LOADPIPEGLB,
+  Instruction::LOADPIPELOC, Instruction::CLOCK, Instruction::LOADIMM,
+  Instruction::nop, Instruction::bal, Instruction::bc1f, Instruction::bc1t,
+  Instruction::j, Instruction::jal, Instruction::lui, Instruction::ldi_b,
+  Instruction::ldi_w
+};
+
+static const Instruction::Opcode reads_hi[] = { Instruction::mfhi };
+static const Instruction::Opcode reads_lo[] = { Instruction::mflo };
+static const Instruction::Opcode reads_box_regs[] = { Instruction::BOXTEST };
+static const Instruction::Opcode reads_tri_regs[] = { Instruction::TRITEST };
+static const Instruction::Opcode reads_root_and_ray[] = { Instruction::TRAVERSE };
+
+struct SourcePattern {
+  const char* pattern;
+  const Instruction::Opcode* ops;
+  size_t num_ops;
+};
+
+#define SOURCE_PATTERN(pattern, ops) { pattern, ops, sizeof(ops) / sizeof(ops[0]) }
+
+static const SourcePattern source_patterns[] = {
+  SOURCE_PATTERN("0", reads_arg0),
+  SOURCE_PATTERN("1", reads_arg1),
+  SOURCE_PATTERN("2", reads_arg2),
+  SOURCE_PATTERN("01", reads_args01),
+  SOURCE_PATTERN("02", reads_args02),
+  SOURCE_PATTERN("12", reads_args12),
+  SOURCE_PATTERN("012", reads_args012),
+  SOURCE_PATTERN("", reads_nothing),
+  SOURCE_PATTERN("H", reads_hi),
+  SOURCE_PATTERN("L", reads_lo),
+  SOURCE_PATTERN("B", reads_box_regs),
+  SOURCE_PATTERN("T", reads_tri_regs),
+  SOURCE_PATTERN("1R", reads_root_and_ray),
+};
+
+// Opcodes the table can't describe, left to ReadyToIssueSwitch
+static const Instruction::Opcode switch_only_ops[] = {
+  Instruction::SPHERE_TEST
+};
+// Opcodes with no ReadyToIssue definition at all (the switch exits on them)
+static const Instruction::Opcode unsupported_ops[] = {
+  Instruction::JMP, Instruction::JAL, Instruction::COS, Instruction::SIN,
+  Instruction::ADDC, Instruction::RSUBC, Instruction::RSUBK,
+  Instruction::RSUBKC, Instruction::MULH, Instruction::MULHU,
+  Instruction::ADDIC, Instruction::ADDIK, Instruction::ADDIKC,
+  Instruction::RSUBIC, Instruction::RSUBIK, Instruction::RSUBIKC,
+  Instruction::ANDNI, Instruction::brki, Instruction::SLEEP,
+  Instruction::SYNC
+};
+
+#define OP_LISTED(ops, op) (std::find(ops, ops + sizeof(ops) / sizeof(ops[0]), op) != ops + sizeof(ops) / sizeof(ops[0]))
+
+// op_sources[op] is the pattern for op, or NULL to use the switch
+static const char* op_sources[Instruction::NUM_OPS];
+static bool op_sources_built = false;
+
+static void BuildSourceTable()
+{
+  if (op_sources_built)
+    return;
+  op_sources_built = true;
+  for (int i = 0; i < Instruction::NUM_OPS; i++)
+    op_sources[i] = NULL;
+  for (size_t p = 0; p < sizeof(source_patterns) / sizeof(source_patterns[0]); p++)
+    for (size_t i = 0; i < source_patterns[p].num_ops; i++) {
+      Instruction::Opcode op = source_patterns[p].ops[i];
+      if (op_sources[op] != NULL) {
+	printf("Error: opcode %s has more than one source register pattern\n", Instruction::Opnames[op].c_str());
+	exit(1);
+      }
+      op_sources[op] = source_patterns[p].pattern;
+    }
+}
+
+void Instruction::DecodeSources()
+{
+  BuildSourceTable();
+  const char* pattern = op_sources[op];
+  if (pattern == NULL) {
+    num_source_regs = -1;
+    return;
+  }
+  num_source_regs = 0;
+  for (const char* c = pattern; *c != '\0'; c++) {
+    switch (*c)
+    {
+      case 'H':
+	source_regs[num_source_regs++] = HI_REG;
+	break;
+      case 'L':
+	source_regs[num_source_regs++] = LO_REG;
+	break;
+      case 'B':
+	for (int i = 36; i < 48; i++)
+	  source_regs[num_source_regs++] = i;
+	break;
+      case 'T':
+	for (int i = 36; i < 51; i++)
+	  source_regs[num_source_regs++] = i;
+	break;
+      case 'R':
+	for (int i = 36; i < 43; i++)
+	  source_regs[num_source_regs++] = i;
+	break;
+      default:
+	source_regs[num_source_regs++] = args[*c - '0'];
+	break;
+    };
+  }
+}
+
+bool Instruction::CheckSourceTable()
+{
+  BuildSourceTable();
+  bool passed = true;
+
+  // Args are distinct registers clear of the fixed ones, so the switch's
+  // fail_reg says exactly which check failed. Starting with nothing ready and
+  // readying each fail_reg in turn gives the switch's checks in order.
+  const int num_regs = 128;
+  long long int register_ready[num_regs];
+  for (int op = 0; op < NUM_OPS; op++) {
+    bool listed = OP_LISTED(switch_only_ops, op) || OP_LISTED(unsupported_ops, op);
+    if (op_sources[op] == NULL) {
+      if (!listed) {
+	printf("Error: opcode %s has no source register pattern and isn't listed as switch only or unsupported\n", Opnames[op].c_str());
+	passed = false;
+      }
+      continue;
+    }
+    if (listed) {
+      printf("Error: opcode %s is listed as switch only or unsupported but has a source register pattern\n", Opnames[op].c_str());
+      passed = false;
+      continue;
+    }
+
+    Instruction ins((Opcode)op, 100, 101, 102, 103);
+    for (int i = 0; i < num_regs; i++)
+      register_ready[i] = 1;
+    int expected[MAX_SOURCE_REGS];
+    int num_expected = 0;
+    bool match = true;
+    int fail_reg;
+    while (!ins.ReadyToIssueSwitch(register_ready, &fail_reg, 0)) {
+      if (num_expected == MAX_SOURCE_REGS || register_ready[fail_reg] == 0) {
+	match = false;
+	break;
+      }
+      expected[num_expected++] = fail_reg;
+      register_ready[fail_reg] = 0;
+    }
+    if (num_expected != ins.num_source_regs)
+      match = false;
+    for (int i = 0; match && i < num_expected; i++)
+      if (expected[i] != ins.source_regs[i])
+	match = false;
+    if (!match) {
+      printf("Error: source register table for %s doesn't match ReadyToIssueSwitch\n", Opnames[op].c_str());
+      passed = false;
+    }
+  }
+
+  printf("Source register table self test %s (%d opcodes)\n", passed ? "passed" : "FAILED", (int)NUM_OPS);
+  return passed;
+}
+
 void Instruction::print()
 {
   printf("%d: %s %d %d %d %d",
@@ -720,6 +1026,7 @@ std::string Instruction::Opnames[NUM_OPS] = {
   std::string("SETTRIPIPE"),
   std::string("LOADPIPEGLB"),
   std::string("LOADPIPELOC"),
+  std::string("TRAVERSE"),
 
   std::string("FPEQ"),
   std::string("FPNE"),
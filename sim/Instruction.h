@@ -26,6 +26,9 @@
 #define BEGIN_COUNT_CYCLES 0
 #define END_COUNT_CYCLES 1
 
+// Most registers an instruction can read (TRITEST)
+#define MAX_SOURCE_REGS 15
+
 // Debug info about which source the instruction came from
 struct SourceInfo
 {
@@ -110,6 +113,8 @@ class Instruction {
     // load special pipeline input registers
     LOADPIPEGLB, // dst, source (global address)
     LOADPIPELOC, // dst, source (localstore address)
+    // whole ray traversal on the traversal unit
+    TRAVERSE,    // dst (2 registers), source (BVH root address)
 
     // old compares
     FPEQ,        // dst, source1, source2
@@ -373,11 +378,40 @@ class Instruction {
 
   // Helper function to see if all the ray data is stable
   bool RayReady(int ray_start, long long int* writes_in_flight, int kNoBlock) const;
-  bool ReadyToIssue(long long int* register_ready, int* fail_reg, long long int cur_cycle) const;
+
+  // Checks that every register the instruction reads is ready by cur_cycle,
+  // otherwise sets fail_reg to the first one that isn't
+  inline bool ReadyToIssue(long long int* register_ready, int* fail_reg, long long int cur_cycle) const {
+    if (num_source_regs < 0)
+      return ReadyToIssueSwitch(register_ready, fail_reg, cur_cycle);
+    for (int i = 0; i < num_source_regs; i++)
+      if (register_ready[source_regs[i]] > cur_cycle) {
+	*fail_reg = source_regs[i];
+	return false;
+      }
+    return true;
+  }
+  // The same check done per opcode. Defines the source register table, and
+  // still used for the opcodes the table can't describe (SPHERE_TEST)
+  bool ReadyToIssueSwitch(long long int* register_ready, int* fail_reg, long long int cur_cycle) const;
+
+  // Fill in source_regs from the opcode and args, done once at decode
+  void DecodeSources();
+  // Compares the source register table with ReadyToIssueSwitch for every
+  // opcode (--self-test). Every opcode needs a table entry or a place on the
+  // switch only or unsupported lists. Prints each mismatch, false if there
+  // were any
+  static bool CheckSourceTable();
+
   void print();
   Opcode op;
   int args[4];
 
+  // Registers read by this instruction, in the order they are checked, or
+  // num_source_regs = -1 to use ReadyToIssueSwitch
+  int source_regs[MAX_SOURCE_REGS];
+  int num_source_regs;
+
   // For profiling/debugging
   // Keep track of performance data
   long long int executions;
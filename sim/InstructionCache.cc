@@ -0,0 +1,93 @@
+#include "InstructionCache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+InstructionCache::InstructionCache(const InstructionCacheParams& params) :
+  fill_latency(params.fill_latency), cache_size(params.cache_size),
+  associativity(params.associativity), line_size(params.line_size),
+  prefetch_next_line(params.prefetch_next_line)
+{
+  num_sets = (cache_size >> line_size) / associativity;
+  if (num_sets < 1) {
+    printf("ERROR: ICACHE of %d instructions can't hold %d ways of %d-instruction lines\n",
+	   cache_size, associativity, 1 << line_size);
+    exit(1);
+  }
+
+  tags = new long long int[num_sets * associativity];
+  last_used = new long long int[num_sets * associativity];
+  ready_cycle = new long long int[num_sets * associativity];
+  Reset();
+}
+
+InstructionCache::~InstructionCache()
+{
+  delete [] tags;
+  delete [] last_used;
+  delete [] ready_cycle;
+}
+
+void InstructionCache::Reset()
+{
+  for (int i = 0; i < num_sets * associativity; i++) {
+    tags[i] = -1;
+    last_used[i] = -1;
+    ready_cycle[i] = 0;
+  }
+  accesses = 0;
+  misses = 0;
+  prefetches = 0;
+  fills = 0;
+}
+
+void InstructionCache::AddStats(InstructionCache* other)
+{
+  accesses += other->accesses;
+  misses += other->misses;
+  prefetches += other->prefetches;
+  fills += other->fills;
+}
+
+int InstructionCache::Find(long long int line) const
+{
+  int set = (int)(line % num_sets);
+  for (int way = 0; way < associativity; way++)
+    if (tags[set * associativity + way] == line)
+      return set * associativity + way;
+  return -1;
+}
+
+void InstructionCache::Fill(long long int line, long long int cycle)
+{
+  int set = (int)(line % num_sets);
+  int victim = set * associativity;
+  for (int way = 1; way < associativity; way++)
+    if (last_used[set * associativity + way] < last_used[victim])
+      victim = set * associativity + way;
+  tags[victim] = line;
+  last_used[victim] = cycle;
+  ready_cycle[victim] = cycle + fill_latency;
+  fills++;
+}
+
+InstructionCache::FetchResult InstructionCache::Fetch(long long int pc, long long int cycle)
+{
+  accesses++;
+  long long int line = pc >> line_size;
+  int index = Find(line);
+  if (index >= 0) {
+    last_used[index] = cycle;
+    if (ready_cycle[index] <= cycle)
+      return HIT;
+    return FILL_PENDING;
+  }
+
+  misses++;
+  Fill(line, cycle);
+  if (prefetch_next_line && Find(line + 1) < 0) {
+    Fill(line + 1, cycle);
+    prefetches++;
+  }
+  return MISS;
+}
@@ -0,0 +1,68 @@
+#ifndef _SIMHWRT_INSTRUCTION_CACHE_H_
+#define _SIMHWRT_INSTRUCTION_CACHE_H_
+
+// A set-associative instruction cache with LRU replacement. Lines are
+// filled from L2 after a fixed fill latency, optionally prefetching the
+// next line on a miss.
+//
+// Enabled by an ICACHE line in the config file (see ReadConfig). Without
+// one the IssueUnit only models icache bank conflicts and every fetch hits.
+// The program is not in the data memory image, so fills don't go through
+// the simulated L2/DRAM, only their latency is charged.
+
+// ICACHE config line parameters, stored on the TraxCore until the
+// IssueUnit is created
+struct InstructionCacheParams {
+  bool enabled;
+  int fill_latency;
+  int cache_size;      // in instructions
+  int associativity;
+  int line_size;       // line holds 2^line_size instructions
+  bool prefetch_next_line;
+
+  InstructionCacheParams() :
+    enabled(false), fill_latency(0), cache_size(0), associativity(1),
+    line_size(0), prefetch_next_line(false)
+  {}
+};
+
+class InstructionCache {
+public:
+  enum FetchResult {
+    HIT,
+    MISS,          // a fill was started for this line
+    FILL_PENDING   // the line is on its way
+  };
+
+  InstructionCache(const InstructionCacheParams& params);
+  ~InstructionCache();
+
+  FetchResult Fetch(long long int pc, long long int cycle);
+  void Reset();
+  void AddStats(InstructionCache* other);
+
+  int fill_latency;
+  int cache_size;
+  int associativity;
+  int line_size;
+  int num_sets;
+  bool prefetch_next_line;
+
+  long long int accesses;
+  long long int misses;
+  long long int prefetches;
+  long long int fills;
+
+private:
+  // Start a fill of line into its set, replacing the least recently used
+  void Fill(long long int line, long long int cycle);
+  // The way holding line, or -1
+  int Find(long long int line) const;
+
+  // indexed by set * associativity + way, tags are line numbers (pc >> line_size)
+  long long int* tags;
+  long long int* last_used;
+  long long int* ready_cycle;
+};
+
+#endif // _SIMHWRT_INSTRUCTION_CACHE_H_
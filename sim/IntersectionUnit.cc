@@ -0,0 +1,226 @@
+#include "IntersectionUnit.h"
+#include "IssueUnit.h"
+#include "ThreadState.h"
+#include "WriteRequest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// first pipeline input register, see ReadyToIssue
+#define PIPE_INPUT_REG 36
+
+IntersectionUnit::IntersectionUnit(Kind _kind, int _latency, int _num_pipelines, int _width, int _interval) :
+  FunctionalUnit(_latency), kind(_kind), num_pipelines(_num_pipelines), width(_width), interval(_interval)
+{
+  if (num_pipelines < 1 || width < 1 || interval < 1) {
+    printf("ERROR: %s needs at least 1 pipeline, a width of at least 1 and an initiation interval of at least 1 (%d, %d, %d)\n",
+           Name(), num_pipelines, width, interval);
+    exit(1);
+  }
+
+  tests = new long long int[num_pipelines];
+  busy_cycles = new long long int[num_pipelines];
+  group_cycle = new long long int[num_pipelines];
+  group_size = new int[num_pipelines];
+  next_start = new long long int[num_pipelines];
+  for (int i = 0; i < num_pipelines; i++) {
+    group_cycle[i] = -1;
+    group_size[i] = 0;
+    next_start[i] = 0;
+  }
+  issued_this_cycle = 0;
+  Reset();
+}
+
+IntersectionUnit::~IntersectionUnit()
+{
+  delete [] tests;
+  delete [] busy_cycles;
+  delete [] group_cycle;
+  delete [] group_size;
+  delete [] next_start;
+}
+
+const char* IntersectionUnit::Name() const
+{
+  return kind == BOX ? "BOXPIPE" : "TRIPIPE";
+}
+
+// From FunctionalUnit
+bool IntersectionUnit::SupportsOp(Instruction::Opcode op) const
+{
+  return op == (kind == BOX ? Instruction::BOXTEST : Instruction::TRITEST);
+}
+
+bool IntersectionUnit::AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState* thread)
+{
+  long long int cycle = issuer->current_cycle;
+
+  // join a group starting this cycle, or start a new one on a free pipeline
+  int pipe = -1;
+  for (int i = 0; i < num_pipelines && pipe < 0; i++)
+    if (group_cycle[i] == cycle && group_size[i] < width)
+      pipe = i;
+  for (int i = 0; i < num_pipelines && pipe < 0; i++)
+    if (next_start[i] <= cycle)
+      pipe = i;
+  if (pipe < 0)
+    return false;
+
+  int num_inputs = kind == BOX ? 12 : 15;
+  float in[15];
+  Instruction::Opcode failop = Instruction::NOP;
+  for (int i = 0; i < num_inputs; i++) {
+    reg_value arg;
+    if (!thread->ReadRegister(PIPE_INPUT_REG + i, cycle, arg, failop)) {
+      // bad stuff happened
+      printf("%s unit: Error in Accepting instruction. Should have passed.\n", Name());
+    }
+    in[i] = arg.fdata;
+  }
+
+  reg_value result;
+  result.fdata = kind == BOX ? BoxTest(in) : TriangleTest(in);
+  if (!thread->QueueWrite(ins.args[0], result, cycle + latency, ins.op, &ins)) {
+    // pipeline hazard
+    return false;
+  }
+
+  if (group_cycle[pipe] != cycle) {
+    group_cycle[pipe] = cycle;
+    group_size[pipe] = 0;
+    next_start[pipe] = cycle + interval;
+    busy_cycles[pipe] += interval;
+  }
+  group_size[pipe]++;
+  tests[pipe]++;
+  if (result.fdata >= 0)
+    hits++;
+  issued_this_cycle++;
+  return true;
+}
+
+// Slab test, in is origin, 1/direction, box min, box max
+float IntersectionUnit::BoxTest(const float* in) const
+{
+  float t_near = -1e30f;
+  float t_far = 1e30f;
+  for (int axis = 0; axis < 3; axis++) {
+    float t0 = (in[6 + axis] - in[axis]) * in[3 + axis];
+    float t1 = (in[9 + axis] - in[axis]) * in[3 + axis];
+    if (t0 > t1) {
+      float temp = t0;
+      t0 = t1;
+      t1 = temp;
+    }
+    if (t0 > t_near)
+      t_near = t0;
+    if (t1 < t_far)
+      t_far = t1;
+  }
+  if (t_near > t_far || t_far < 0)
+    return -1.f;
+  return t_near > 0 ? t_near : 0.f;
+}
+
+// Moller-Trumbore, in is origin, direction, p0, p1, p2
+float IntersectionUnit::TriangleTest(const float* in) const
+{
+  const float* org = in;
+  const float* dir = in + 3;
+  const float* p0 = in + 6;
+  float edge1[3], edge2[3], tvec[3], pvec[3], qvec[3];
+  for (int i = 0; i < 3; i++) {
+    edge1[i] = in[9 + i] - p0[i];
+    edge2[i] = in[12 + i] - p0[i];
+    tvec[i] = org[i] - p0[i];
+  }
+  pvec[0] = dir[1] * edge2[2] - dir[2] * edge2[1];
+  pvec[1] = dir[2] * edge2[0] - dir[0] * edge2[2];
+  pvec[2] = dir[0] * edge2[1] - dir[1] * edge2[0];
+  float det = edge1[0] * pvec[0] + edge1[1] * pvec[1] + edge1[2] * pvec[2];
+  if (det > -1e-12f && det < 1e-12f)
+    return -1.f;
+  float inv_det = 1.f / det;
+
+  float u = (tvec[0] * pvec[0] + tvec[1] * pvec[1] + tvec[2] * pvec[2]) * inv_det;
+  if (u < 0.f || u > 1.f)
+    return -1.f;
+  qvec[0] = tvec[1] * edge1[2] - tvec[2] * edge1[1];
+  qvec[1] = tvec[2] * edge1[0] - tvec[0] * edge1[2];
+  qvec[2] = tvec[0] * edge1[1] - tvec[1] * edge1[0];
+  float v = (dir[0] * qvec[0] + dir[1] * qvec[1] + dir[2] * qvec[2]) * inv_det;
+  if (v < 0.f || u + v > 1.f)
+    return -1.f;
+  float t = (edge2[0] * qvec[0] + edge2[1] * qvec[1] + edge2[2] * qvec[2]) * inv_det;
+  return t > 0.f ? t : -1.f;
+}
+
+void IntersectionUnit::SkipCycles(long long int num_cycles)
+{
+  cycles += num_cycles - 1;
+  ClockRise();
+  ClockFall();
+}
+
+// From HardwareModule
+void IntersectionUnit::ClockRise()
+{
+  cycles++;
+  issued_this_cycle = 0;
+}
+
+void IntersectionUnit::ClockFall()
+{
+}
+
+void IntersectionUnit::print()
+{
+  printf("%d tests started", issued_this_cycle);
+}
+
+double IntersectionUnit::Utilization()
+{
+  return static_cast<double>(issued_this_cycle) / static_cast<double>(num_pipelines * width);
+}
+
+void IntersectionUnit::Reset()
+{
+  cycles = 0;
+  hits = 0;
+  for (int i = 0; i < num_pipelines; i++) {
+    tests[i] = 0;
+    busy_cycles[i] = 0;
+  }
+}
+
+void IntersectionUnit::AddStats(IntersectionUnit* other)
+{
+  cycles += other->cycles;
+  hits += other->hits;
+  for (int i = 0; i < num_pipelines; i++) {
+    tests[i] += other->tests[i];
+    busy_cycles[i] += other->busy_cycles[i];
+  }
+}
+
+void IntersectionUnit::PrintStats(int num_units)
+{
+  long long int total_tests = 0;
+  for (int i = 0; i < num_pipelines; i++)
+    total_tests += tests[i];
+  printf(" %s: %d pipeline(s) x %d wide, latency %d, initiation interval %d\n",
+         Name(), num_pipelines, width, latency, interval);
+  printf("   tests: %lld, hits: %lld (%.2f%%)\n", total_tests, hits,
+         total_tests > 0 ? 100. * hits / total_tests : 0.);
+  for (int i = 0; i < num_pipelines; i++) {
+    // busy is the fraction of cycles the pipeline couldn't start a new
+    // group, occupancy how full its groups were
+    long long int slots = busy_cycles[i] / interval * width;
+    printf("   pipeline %d: %lld tests, busy %.2f%%, lane occupancy %.2f%%\n", i, tests[i],
+           cycles > 0 ? 100. * busy_cycles[i] / cycles : 0.,
+           slots > 0 ? 100. * tests[i] / slots : 0.);
+  }
+  printf("   area (mm2): %f, energy (J): %f\n", GetArea() * num_pipelines * width * num_units,
+         GetEnergy() * total_tests / 1000000000.f);
+}
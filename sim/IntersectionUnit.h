@@ -0,0 +1,76 @@
+#ifndef _SIMHWRT_INTERSECTION_UNIT_H_
+#define _SIMHWRT_INTERSECTION_UNIT_H_
+
+// Fixed function ray-box (BOXTEST) and ray-triangle (TRITEST) pipelines,
+// set up by BOXPIPE and TRIPIPE lines in the config file:
+//
+//   BOXPIPE <latency> <pipelines> <width> <initiation interval> <area per lane mm^2 (optional)> <energy per test nJ (optional)>
+//   TRIPIPE <latency> <pipelines> <width> <initiation interval> <area per lane mm^2 (optional)> <energy per test nJ (optional)>
+//
+// Each pipeline starts up to width tests together, then can't start more
+// until initiation interval cycles later. Results are written latency
+// cycles after a test starts.
+//
+// The operands are the pipeline input registers, laid out like the words
+// of a BVH node (BVHNodeSize = 10) and a triangle (TriangleSize = 11) in
+// memory, so the first 6 or 9 words can be loaded straight in:
+//
+//   BOXTEST rd:  r36-38 ray origin, r39-41 1/direction, r42-44 box min, r45-47 box max
+//   TRITEST rd:  r36-38 ray origin, r39-41 direction,   r42-50 p0, p1, p2
+//
+// rd gets the distance to the box entry (0 if the origin is inside) or
+// the triangle hit, or -1 on a miss.
+
+#include "FunctionalUnit.h"
+
+class IntersectionUnit : public FunctionalUnit {
+ public:
+  enum Kind {
+    BOX,
+    TRIANGLE
+  };
+
+  IntersectionUnit(Kind kind, int latency, int num_pipelines, int width, int interval);
+  ~IntersectionUnit();
+
+  // From FunctionalUnit
+  virtual bool SupportsOp(Instruction::Opcode op) const;
+  virtual bool AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState* thread);
+  virtual void SkipCycles(long long int num_cycles);
+
+  // From HardwareModule
+  virtual void ClockRise();
+  virtual void ClockFall();
+  virtual void print();
+  virtual double Utilization();
+
+  const char* Name() const;
+  void Reset();
+  void AddStats(IntersectionUnit* other);
+  // num_units is the number of TMs summed into this one
+  void PrintStats(int num_units);
+
+  Kind kind;
+  int num_pipelines;
+  int width;
+  int interval;
+  int issued_this_cycle;
+
+  long long int cycles;
+  long long int hits;
+  // per pipeline
+  long long int* tests;
+  long long int* busy_cycles;
+
+ private:
+  float BoxTest(const float* in) const;
+  float TriangleTest(const float* in) const;
+
+  // per pipeline: the cycle its current group of tests started, how many
+  // joined, and when it can start the next group
+  long long int* group_cycle;
+  int* group_size;
+  long long int* next_start;
+};
+
+#endif // _SIMHWRT_INTERSECTION_UNIT_H_
@@ -0,0 +1,166 @@
+#include "IssueRules.h"
+#include "Bitwise.h"
+#include "BranchUnit.h"
+#include "ConversionUnit.h"
+#include "DebugUnit.h"
+#include "FPAddSub.h"
+#include "FPCompare.h"
+#include "FPDiv.h"
+#include "FPInvSqrt.h"
+#include "FPMinMax.h"
+#include "FPMul.h"
+#include "GlobalRegisterFile.h"
+#include "IntAddSub.h"
+#include "IntMul.h"
+#include "IntersectionUnit.h"
+#include "L1Cache.h"
+#include "LocalStore.h"
+#include "SharedUnitPool.h"
+#include "SimpleRegisterFile.h"
+#include "Synchronize.h"
+#include "TraversalUnit.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char* lost_slot_names[IssueRules::NUM_LOST] = {
+  "fetch (icache)",
+  "data dependence",
+  "unit busy",
+  "register file ports",
+  "pairing rules",
+  "register bank conflicts",
+  "other (HALT, SLEEP, ...)"
+};
+
+// The config file name of a unit
+static const char* UnitName(FunctionalUnit* unit)
+{
+  if (SharedUnitPool* pool = dynamic_cast<SharedUnitPool*>(unit)) return UnitName(pool->unit);
+  if (dynamic_cast<FPAddSub*>(unit)) return "FPADD";
+  if (dynamic_cast<FPMinMax*>(unit)) return "FPMIN";
+  if (dynamic_cast<FPCompare*>(unit)) return "FPCMP";
+  if (dynamic_cast<IntAddSub*>(unit)) return "INTADD";
+  if (dynamic_cast<FPMul*>(unit)) return "FPMUL";
+  if (dynamic_cast<FPInvSqrt*>(unit)) return "FPINV";
+  if (dynamic_cast<FPDiv*>(unit)) return "FPINV";
+  if (dynamic_cast<IntMul*>(unit)) return "INTMUL";
+  if (dynamic_cast<ConversionUnit*>(unit)) return "CONV";
+  if (dynamic_cast<BranchUnit*>(unit)) return "BLT";
+  if (dynamic_cast<Bitwise*>(unit)) return "BITWISE";
+  if (dynamic_cast<DebugUnit*>(unit)) return "DEBUG";
+  if (IntersectionUnit* pipe = dynamic_cast<IntersectionUnit*>(unit)) return pipe->Name();
+  if (dynamic_cast<TraversalUnit*>(unit)) return "TRAVERSAL";
+  if (dynamic_cast<L1Cache*>(unit)) return "L1";
+  if (dynamic_cast<GlobalRegisterFile*>(unit)) return "GLOBAL";
+  if (dynamic_cast<Synchronize*>(unit)) return "SYNC";
+  if (dynamic_cast<LocalStore*>(unit)) return "STACK";
+  return "OTHER";
+}
+
+IssueRules::IssueRules(const IssueParams& params, std::vector<FunctionalUnit*>& units,
+                       SimpleRegisterFile* registers) :
+  width(params.width), read_ports(params.read_ports)
+{
+  if (width < 1 || read_ports < 0) {
+    printf("ERROR: ISSUE needs a width of at least 1 and a read port count of at least 0 (%d, %d)\n",
+           width, read_ports);
+    exit(1);
+  }
+
+  // Each op belongs to the unit that would execute it, the same search Issue() does
+  class_names.push_back("NONE");
+  class_names.push_back("RF");
+  for (int op = 0; op < Instruction::NUM_OPS; op++) {
+    op_class[op] = 0;
+    if (op == Instruction::NOP || op == Instruction::nop || op == Instruction::SYNC ||
+        op == Instruction::SLEEP || op == Instruction::PROF || op == Instruction::HALT ||
+        op == Instruction::SETTRIPIPE || op == Instruction::SETBOXPIPE)
+      continue;
+    if (registers->SupportsOp((Instruction::Opcode)op)) {
+      op_class[op] = 1;
+      continue;
+    }
+    for (size_t i = 0; i < units.size(); i++) {
+      if (units[i]->SupportsOp((Instruction::Opcode)op)) {
+        std::string name(UnitName(units[i]));
+        op_class[op] = ClassOf(name);
+        if (op_class[op] < 0) {
+          op_class[op] = (int)class_names.size();
+          class_names.push_back(name);
+        }
+        break;
+      }
+    }
+  }
+
+  size_t num_classes = class_names.size();
+  can_pair.assign(num_classes * num_classes, params.pairs.empty());
+  for (size_t i = 0; i + 1 < params.pairs.size(); i += 2) {
+    int a = ClassOf(params.pairs[i]);
+    int b = ClassOf(params.pairs[i + 1]);
+    if (a < 0 || b < 0) {
+      printf("ERROR: PAIR %s %s names a unit this TM doesn't have. Units are:",
+             params.pairs[i].c_str(), params.pairs[i + 1].c_str());
+      for (size_t j = 0; j < num_classes; j++)
+        printf(" %s", class_names[j].c_str());
+      printf("\n");
+      exit(1);
+    }
+    can_pair[a * num_classes + b] = true;
+    can_pair[b * num_classes + a] = true;
+  }
+
+  Reset();
+}
+
+int IssueRules::ClassOf(const std::string& name) const
+{
+  for (size_t i = 0; i < class_names.size(); i++)
+    if (class_names[i] == name)
+      return (int)i;
+  return -1;
+}
+
+int IssueRules::ReadPorts(const Instruction* ins)
+{
+  // ops without a decoded source list read at most 3 registers
+  return ins->num_source_regs >= 0 ? ins->num_source_regs : 3;
+}
+
+IssueRules::LostSlot IssueRules::Check(Instruction::Opcode prev, const Instruction* ins, int ports_used) const
+{
+  if (read_ports > 0 && ports_used + ReadPorts(ins) > read_ports)
+    return LOST_PORTS;
+  if (!can_pair[op_class[prev] * class_names.size() + op_class[ins->op]])
+    return LOST_PAIRING;
+  return NUM_LOST;
+}
+
+void IssueRules::Reset()
+{
+  slots = 0;
+  for (int i = 0; i < NUM_LOST; i++)
+    lost[i] = 0;
+}
+
+void IssueRules::AddStats(IssueRules* other)
+{
+  slots += other->slots;
+  for (int i = 0; i < NUM_LOST; i++)
+    lost[i] += other->lost[i];
+}
+
+void IssueRules::Print()
+{
+  long long int total_lost = 0;
+  for (int i = 0; i < NUM_LOST; i++)
+    total_lost += lost[i];
+  printf(" --issue slots (%d per thread, %d read ports%s): %lld, %lld used (%.2f%%)\n",
+         width, read_ports, read_ports > 0 ? "" : " = unlimited", slots, slots - total_lost,
+         slots > 0 ? 100. * (slots - total_lost) / slots : 0.);
+  for (int i = 0; i < NUM_LOST; i++)
+    if (lost[i] > 0)
+      printf("   lost to %-24s %lld (%.2f%%)\n", lost_slot_names[i], lost[i],
+             slots > 0 ? 100. * lost[i] / slots : 0.);
+}
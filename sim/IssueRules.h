@@ -0,0 +1,81 @@
+#ifndef _SIMHWRT_ISSUE_RULES_H_
+#define _SIMHWRT_ISSUE_RULES_H_
+
+// Multiple issue per thread processor, set up by ISSUE and PAIR lines in
+// the config file:
+//
+//   ISSUE <instructions per thread per cycle> <register file read ports per thread (0 = unlimited)>
+//   PAIR <unit> <unit>
+//
+// The first instruction a thread issues in a cycle is never held back.
+// Each one after it has to fit in the read ports the earlier ones left,
+// and if there are any PAIR lines, its unit and that of the instruction
+// issued just before it must be listed as a pair (in either order). Units
+// are named as in the config (FPADD, FPMUL, L1, BLT, ...), plus GLOBAL,
+// SYNC and STACK for the built in units, RF for register file ops (MOV,
+// LOADIMM, ...) and NONE for NOP, HALT, SLEEP and the like.
+//
+// Only the default (non-SIMD, non-SIMT) issue mode uses these.
+
+#include "Instruction.h"
+#include <string>
+#include <vector>
+
+class FunctionalUnit;
+class SimpleRegisterFile;
+
+// ISSUE/PAIR config lines, stored on the TraxCore until the IssueUnit is created
+struct IssueParams {
+  bool enabled;
+  int width;
+  int read_ports;
+  // unit names, two per PAIR line
+  std::vector<std::string> pairs;
+
+  IssueParams() : enabled(false), width(1), read_ports(0) {}
+};
+
+class IssueRules {
+public:
+  // Why a thread used fewer than width issue slots in a cycle
+  enum LostSlot {
+    LOST_FETCH,    // icache bank conflict or fill
+    LOST_DATA,     // data dependence
+    LOST_UNIT,     // functional unit busy
+    LOST_PORTS,    // out of register file read ports
+    LOST_PAIRING,  // no PAIR rule for the two units
+    LOST_BANKS,    // operand collector waiting on register banks
+    LOST_OTHER,    // HALT, SLEEP, ...
+    NUM_LOST
+  };
+
+  IssueRules(const IssueParams& params, std::vector<FunctionalUnit*>& units,
+             SimpleRegisterFile* registers);
+
+  // Read ports an instruction takes
+  static int ReadPorts(const Instruction* ins);
+
+  // Whether ins can issue after prev in the same cycle with ports_used
+  // ports already taken. Returns NUM_LOST if it can, otherwise the reason.
+  LostSlot Check(Instruction::Opcode prev, const Instruction* ins, int ports_used) const;
+
+  void Reset();
+  void AddStats(IssueRules* other);
+  void Print();
+
+  int width;
+  int read_ports;
+
+  long long int slots;
+  long long int lost[NUM_LOST];
+
+private:
+  int ClassOf(const std::string& name) const;
+
+  std::vector<std::string> class_names;
+  int op_class[Instruction::NUM_OPS];
+  // can_pair[a * class_names.size() + b], everything if there are no PAIR lines
+  std::vector<bool> can_pair;
+};
+
+#endif // _SIMHWRT_ISSUE_RULES_H_
@@ -2,17 +2,29 @@
 #include "ThreadState.h"
 #include "SimpleRegisterFile.h"
 #include "L1Cache.h"
+#include "L2Cache.h"
+#include "GlobalRegisterFile.h"
 #include "FPMul.h"
 #include "FPAddSub.h"
+#include "IntersectionUnit.h"
 #include "ReadConfig.h"
+#include "SharedUnitPool.h"
 #include "Profiler.h"
 #include "Debugger.h"
 #include "memory_controller.h"
+#include "params.h"
 #include <stdlib.h>
 #include <fstream>
 
+extern pthread_mutex_t usimm_mutex[MAX_NUM_CHANNELS];
+
 extern pthread_mutex_t profile_mutex;
 
+// every TM has the same icaches, so only the first one warns about their
+// area and energy
+static bool default_icache_warned = false;
+static bool model_icache_warned = false;
+
 IssueUnit::IssueUnit(const char* icache_params_file, std::vector<ThreadProcessor*>& _thread_procs,
                      std::vector<FunctionalUnit*>& functional_units,
                      int _verbosity, int _num_icaches, int _icache_banks,
@@ -26,7 +38,7 @@ IssueUnit::IssueUnit(const char* icache_params_file, std::vector<ThreadProcessor
   debugger = _debugger;
 
   if(!ReadCacheParams(icache_params_file, 4096, _icache_banks, 4, area, energy, false))
-    perror("WARNING: Unable to find area and energy profile for specified instruction cache.\nAssuming 0\n");
+    NearestICacheParams(icache_params_file, 4096, _icache_banks, 4, area, energy, default_icache_warned);
 
   area *= _num_icaches;
 
@@ -47,12 +59,14 @@ IssueUnit::IssueUnit(const char* icache_params_file, std::vector<ThreadProcessor
   kernel_cycles = new long long int*[MAX_NUM_KERNELS];
   kernel_calls = new int*[MAX_NUM_KERNELS];
   kernel_profiling = new int*[MAX_NUM_KERNELS];
+  kernel_icache_misses = new long long int*[MAX_NUM_KERNELS];
 
   for (size_t i = 0; i < MAX_NUM_KERNELS; ++i)
   {
     kernel_cycles[i] = new long long int[_thread_procs.size()];
     kernel_calls[i] = new int[_thread_procs.size()];
     kernel_profiling[i] = new int[_thread_procs.size()];
+    kernel_icache_misses[i] = new long long int[_thread_procs.size()];
 
     for(size_t j = 0; j < _thread_procs.size(); j++)
     {
@@ -61,6 +75,7 @@ IssueUnit::IssueUnit(const char* icache_params_file, std::vector<ThreadProcessor
       //initialize cycles and calls for each kernel
       kernel_cycles[i][j] = 0;
       kernel_calls[i][j] = 0;
+      kernel_icache_misses[i][j] = 0;
     }
   }
 
@@ -70,6 +85,7 @@ IssueUnit::IssueUnit(const char* icache_params_file, std::vector<ThreadProcessor
   //   total_kernel_stalls = 0;
   //   total_kernel_fu_dependencies = 0;
   schedule_data = new ScheduleData[_thread_procs.size()];
+  skip_fail_op = new Instruction::Opcode[_thread_procs.size()];
 
   int count = 0;
   thread_issue_count = new int[_thread_procs.size()+1];
@@ -79,6 +95,7 @@ IssueUnit::IssueUnit(const char* icache_params_file, std::vector<ThreadProcessor
     thread_issue_count[count++] = 0;
     schedule_data[i].last_issued = Instruction::NOP;
     schedule_data[i].last_stall = Instruction::NOP;
+    schedule_data[i].last_blocked = false;
   }
 
   // for counting the max number of threads
@@ -167,6 +184,19 @@ IssueUnit::IssueUnit(const char* icache_params_file, std::vector<ThreadProcessor
   simd_issue = 0;
   simd_bonus_fetches = 0;
 
+  simt_width = 1;
+  reconvergence = NULL;
+  coalesce_group = -1;
+  issue_rules = NULL;
+  register_bank_stalls = 0;
+  treelets = NULL;
+  treelet_stalls = 0;
+  arbitration_stalls = 0;
+  sync_sleep_stalls = 0;
+  watchdog_cycles = 500000;
+  last_progress_cycle = 0;
+  watchdog_checkpoint = NULL;
+
   // iCache setup
   num_icaches = _num_icaches;
   icache_banks = _icache_banks;
@@ -182,6 +212,7 @@ IssueUnit::IssueUnit(const char* icache_params_file, std::vector<ThreadProcessor
   }
 
   iCache_conflicts = 0;
+  iCache_fill_stalls = 0;
   total_bank_cycles = 0;
   bank_cycles_used = 0;
 }
@@ -207,6 +238,7 @@ void IssueUnit::Reset()
       //initialize cycles and calls for each kernel
       kernel_cycles[i][j] = 0;
       kernel_calls[i][j] = 0;
+      kernel_icache_misses[i][j] = 0;
     }
   }
 
@@ -216,6 +248,7 @@ void IssueUnit::Reset()
     thread_issue_count[count++] = 0;
     schedule_data[i].last_issued = Instruction::NOP;
     schedule_data[i].last_stall = Instruction::NOP;
+    schedule_data[i].last_blocked = false;
   }
 
   // for counting the max number of threads
@@ -273,6 +306,9 @@ void IssueUnit::Reset()
   simd_issue = 0;
   simd_bonus_fetches = 0;
 
+  for (size_t i = 0; i < warps.size(); ++i)
+    warps[i].Reset(simt_width);
+
   // iCache setup
   for (int j = 0; j < num_icaches; ++j)
   {
@@ -280,7 +316,23 @@ void IssueUnit::Reset()
       bank_fetched[j][i] = 0;
   }
 
+  for (size_t i = 0; i < icaches.size(); ++i)
+    icaches[i]->Reset();
+  if (issue_rules)
+    issue_rules->Reset();
+  for (size_t i = 0; i < register_banks.size(); ++i)
+    register_banks[i]->Reset();
+  register_bank_stalls = 0;
+  if (treelets)
+    treelets->Reset();
+  treelet_stalls = 0;
+  arbitration_stalls = 0;
+  sync_sleepers.clear();
+  sync_sleep_stalls = 0;
+  last_progress_cycle = 0;
+
   iCache_conflicts = 0;
+  iCache_fill_stalls = 0;
   total_bank_cycles = 0;
   bank_cycles_used = 0;
 }
@@ -301,20 +353,357 @@ IssueUnit::~IssueUnit()
     delete [] kernel_cycles[i];
     delete [] kernel_calls[i];
     delete [] kernel_profiling[i];
+    delete [] kernel_icache_misses[i];
   }
 
   delete [] kernel_cycles;
   delete [] kernel_calls;
   delete [] kernel_profiling;
+  delete [] kernel_icache_misses;
   delete [] thread_issue_count;
   delete [] atominc_bins;
   delete [] simd_last_issued;
   delete [] simd_state;
+  delete [] skip_fail_op;
 
   for (int j = 0; j < num_icaches; ++j)
     delete [] bank_fetched[j];
 
   delete [] bank_fetched;
+
+  for (size_t i = 0; i < icaches.size(); ++i)
+    delete icaches[i];
+  delete issue_rules;
+  for (size_t i = 0; i < register_banks.size(); ++i)
+    delete register_banks[i];
+  delete treelets;
+}
+
+void IssueUnit::EnableICacheModel(const InstructionCacheParams& params, const char* icache_params_file)
+{
+  for (int j = 0; j < num_icaches; ++j)
+    icaches.push_back(new InstructionCache(params));
+
+  // the bank-only model used the numbers for a 4KB cache of 4-byte lines
+  float model_area, model_energy;
+  int capacity_bytes = params.cache_size * 4;
+  int line_size_bytes = (1 << params.line_size) * 4;
+  if(ReadCacheParams(icache_params_file, capacity_bytes, icache_banks, line_size_bytes, model_area, model_energy, false) ||
+     NearestICacheParams(icache_params_file, capacity_bytes, icache_banks, line_size_bytes, model_area, model_energy,
+                         model_icache_warned))
+  {
+    area = model_area * num_icaches;
+    energy = model_energy;
+  }
+}
+
+bool IssueUnit::NearestICacheParams(const char* icache_params_file, int capacity_bytes, int banks, int line_size_bytes,
+                                    float& model_area, float& model_energy, bool& warned)
+{
+  int row_capacity, row_banks, row_line_size;
+  bool found = ReadNearestCacheParams(icache_params_file, capacity_bytes, banks, line_size_bytes, model_area, model_energy,
+                                      row_capacity, row_banks, row_line_size);
+  if (!warned)
+  {
+    if (found)
+      printf("WARNING: no icache params for a %d byte, %d bank instruction cache with %d byte lines, using the %d byte, %d bank, %d byte line entry with its area scaled to %d bytes\n",
+             capacity_bytes, banks, line_size_bytes, row_capacity, row_banks, row_line_size, capacity_bytes);
+    else
+      printf("WARNING: no icache params for a %d byte, %d bank instruction cache with %d byte lines, assuming 0 area and energy\n",
+             capacity_bytes, banks, line_size_bytes);
+  }
+  warned = true;
+  return found;
+}
+
+bool IssueUnit::ICacheFetch(ThreadState* thread, size_t proc_id, int icache_num)
+{
+  InstructionCache* icache = icaches[icache_num];
+  InstructionCache::FetchResult result = icache->Fetch(thread->program_counter, current_cycle);
+  if (result == InstructionCache::HIT)
+    return true;
+
+  if (result == InstructionCache::MISS)
+  {
+    for (int k = 0; k < MAX_NUM_KERNELS; ++k)
+    {
+      if (kernel_profiling[k][proc_id])
+        kernel_icache_misses[k][proc_id]++;
+    }
+  }
+  iCache_fill_stalls++;
+  return false;
+}
+
+long long int IssueUnit::ICacheFills()
+{
+  long long int fills = 0;
+  for (size_t i = 0; i < icaches.size(); ++i)
+    fills += icaches[i]->fills;
+  return fills;
+}
+
+void IssueUnit::EnableIssueRules(const IssueParams& params)
+{
+  if (simd_width > 1)
+    printf("WARNING: the ISSUE/PAIR config lines don't apply to --simd-width issue\n");
+  issue_rules = new IssueRules(params, units, thread_procs[0]->GetActiveThread()->registers);
+}
+
+void IssueUnit::EnableRegisterBanks(const RegisterBankParams& params)
+{
+  for (size_t i = 0; i < thread_procs.size(); ++i)
+  {
+    RegisterBanks* banks = new RegisterBanks(params);
+    register_banks.push_back(banks);
+    // hardware threads of a thread processor share its register file
+    for (int j = 0; j < thread_procs[i]->num_threads; ++j)
+      thread_procs[i]->thread_states[j]->register_banks = banks;
+  }
+}
+
+double IssueUnit::RegisterBankEnergy()
+{
+  double bank_energy = 0;
+  for (size_t i = 0; i < register_banks.size(); ++i)
+    bank_energy += register_banks[i]->energy * (register_banks[i]->reads + register_banks[i]->writes);
+  return bank_energy;
+}
+
+void IssueUnit::EnableTreeletScheduler(const TreeletParams& params, MainMemory* memory)
+{
+  treelets = new TreeletScheduler(params, memory);
+}
+
+void IssueUnit::EnableSIMT(int width, const ReconvergenceTable* table)
+{
+  if (width < 2 || width > MAX_SIMT_WIDTH || thread_procs.size() % width != 0)
+  {
+    printf("ERROR: --simt-width %d must be between 2 and %d and divide the %d thread processors of a TM\n",
+           width, MAX_SIMT_WIDTH, (int)thread_procs.size());
+    exit(1);
+  }
+  if (simd_width > 1 || thread_procs[0]->num_threads > 1)
+  {
+    printf("ERROR: --simt-width can't be combined with --simd-width or --threads-per-proc\n");
+    exit(1);
+  }
+
+  simt_width = width;
+  reconvergence = table;
+  warps.resize(thread_procs.size() / simt_width);
+  for (size_t i = 0; i < warps.size(); ++i)
+    warps[i].Reset(simt_width);
+}
+
+void IssueUnit::Watchdog()
+{
+  // one dump at a time when several TMs give up together
+  static pthread_mutex_t watchdog_mutex = PTHREAD_MUTEX_INITIALIZER;
+  pthread_mutex_lock(&watchdog_mutex);
+
+  printf("_-=<WATCHDOG>=-_ TM %d: no instruction issued for %lld cycles (cycle %lld).\n",
+         (int)thread_procs[0]->GetActiveThread()->core_id, current_cycle - last_progress_cycle, current_cycle);
+  printf("Raise --watchdog for workloads that legitimately stall this long.\n");
+  for (size_t i = 0; i < thread_procs.size(); ++i)
+  {
+    if (thread_procs[i]->halted)
+      continue;
+    for (int j = 0; j < thread_procs[i]->num_threads; ++j)
+    {
+      ThreadState* thread = thread_procs[i]->thread_states[j];
+      printf("Thread processor %d", (int)i);
+      if (thread_procs[i]->num_threads > 1)
+        printf(" thread %d%s", j, j == thread_procs[i]->active_thread ? " (active)" : "");
+      printf(", PC %lld: ", thread->program_counter);
+      DescribeStall(stdout, thread, j == thread_procs[i]->active_thread);
+    }
+  }
+  DescribeMemory(stdout);
+
+  if (watchdog_checkpoint)
+    WriteCheckpoint(watchdog_checkpoint);
+  fflush(stdout);
+  exit(1);
+}
+
+void IssueUnit::DescribeStall(FILE* out, ThreadState* thread, bool active)
+{
+  Instruction* ins = thread->fetched_instruction;
+  if (ins == NULL)
+  {
+    fprintf(out, active ? "nothing fetched\n" : "nothing fetched, not scheduled\n");
+    return;
+  }
+  fprintf(out, "%s (pc %d) ", Instruction::Opnames[ins->op].c_str(), ins->pc_address);
+
+  int fail_reg = -1;
+  if (!ins->ReadyToIssue(thread->register_ready, &fail_reg, current_cycle))
+  {
+    fprintf(out, "waits on register %d", fail_reg);
+    Instruction* producer = thread->GetFailInstruction(fail_reg);
+    if (producer)
+      fprintf(out, " from %s (pc %d)", Instruction::Opnames[producer->op].c_str(), producer->pc_address);
+    L1Cache* L1 = NULL;
+    for (size_t i = 0; i < units.size() && !L1; ++i)
+      L1 = dynamic_cast<L1Cache*>(units[i]);
+    bool memory = producer && L1 && L1->SupportsOp(producer->op);
+    if (thread->register_ready[fail_reg] >= UNKNOWN_LATENCY)
+      fprintf(out, ", %s pending with unknown latency\n", memory ? "memory" : "result");
+    else
+      fprintf(out, "%s, ready on cycle %lld\n", memory ? " (memory pending)" : "", thread->register_ready[fail_reg]);
+    return;
+  }
+
+  GlobalRegisterFile* globals = NULL;
+  for (size_t i = 0; i < units.size() && !globals; ++i)
+    globals = dynamic_cast<GlobalRegisterFile*>(units[i]);
+  switch (ins->op)
+  {
+    case Instruction::HALT:
+      fprintf(out, "at HALT, waiting for the rest of the TM\n");
+      break;
+    case Instruction::SLEEP:
+      fprintf(out, "sleeping until cycle %lld\n", thread->end_sleep_cycle);
+      break;
+    case Instruction::BARRIER:
+    case Instruction::SEM_ACQ:
+    {
+      int which = thread->registers->idata[ins->args[0]];
+      fprintf(out, "%s on global register %d", ins->op == Instruction::BARRIER ? "barrier" : "semaphore", which);
+      if (globals && which >= 0 && which < globals->num_registers)
+        fprintf(out, " = %u", globals->ReadUint(which));
+      fprintf(out, "\n");
+      break;
+    }
+    default:
+      // only the scheduled thread tries to issue
+      if (active)
+        fprintf(out, "operands ready, unit busy\n");
+      else
+        fprintf(out, "operands ready, not scheduled\n");
+      break;
+  }
+}
+
+void IssueUnit::DescribeMemory(FILE* out)
+{
+  const int max_listed = 16;
+  L1Cache* L1 = NULL;
+  for (size_t i = 0; i < units.size() && !L1; ++i)
+    L1 = dynamic_cast<L1Cache*>(units[i]);
+  if (!L1)
+    return;
+
+  fprintf(out, "L1: %d line fills pending, %d bus transfers\n",
+          (int)L1->update_list.size(), (int)L1->bus_traffic.size());
+  for (size_t i = 0; i < L1->bus_traffic.size() && (int)i < max_listed; ++i)
+  {
+    fprintf(out, "  line (index %d, tag %d) for %d registers ", L1->bus_traffic[i].index,
+            L1->bus_traffic[i].tag, (int)L1->bus_traffic[i].recipients.size());
+    if (L1->bus_traffic[i].update_cycle >= UNKNOWN_LATENCY)
+      fprintf(out, "waiting on DRAM\n");
+    else
+      fprintf(out, "arrives cycle %lld\n", L1->bus_traffic[i].update_cycle);
+  }
+
+  L2Cache* L2 = L1->L2;
+  if (!L2)
+    return;
+  // the L2 and DRAM are shared with TMs that may still be running
+  pthread_mutex_lock(&L2->cache_mutex);
+  fprintf(out, "L2: %d line fills pending (MSHRs)\n", (int)L2->update_list.size());
+  for (size_t i = 0; i < L2->update_list.size() && (int)i < max_listed; ++i)
+    fprintf(out, "  line (index %d, tag %d) arrives cycle %lld\n",
+            L2->update_list[i].index, L2->update_list[i].tag, L2->update_list[i].update_cycle);
+  pthread_mutex_unlock(&L2->cache_mutex);
+
+  if (L2->disable_usimm)
+    return;
+  size_t core_id = thread_procs[0]->GetActiveThread()->core_id;
+  int idle_channels = 0;
+  for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+  {
+    pthread_mutex_lock(&usimm_mutex[channel]);
+    int reads = 0, ours = 0, writes = 0;
+    for (request_t* req = read_queue_head[channel]; req; req = req->next)
+    {
+      reads++;
+      for (size_t i = 0; i < req->trax_reqs.size(); ++i)
+      {
+        if (req->trax_reqs[i].thread->core_id != core_id)
+          continue;
+        if (ours++ < max_listed)
+          fprintf(out, "  channel %d read of address %d (arrived cycle %lld) for thread %d register %d\n",
+                  channel, req->trax_reqs[i].trax_addr, req->arrival_time,
+                  req->trax_reqs[i].thread->thread_id, req->trax_reqs[i].which_reg);
+      }
+    }
+    for (request_t* req = write_queue_head[channel]; req; req = req->next)
+      writes++;
+    pthread_mutex_unlock(&usimm_mutex[channel]);
+    if (reads == 0 && writes == 0)
+      idle_channels++;
+    else
+      fprintf(out, "DRAM channel %d: %d reads queued (%d for this TM), %d writes queued\n",
+              channel, reads, ours, writes);
+  }
+  fprintf(out, "DRAM: %d of %d channels have empty queues\n", idle_channels, NUM_CHANNELS);
+}
+
+void IssueUnit::WriteCheckpoint(const char* filename)
+{
+  FILE* out = fopen(filename, "w");
+  if (!out)
+  {
+    printf("ERROR: could not open watchdog checkpoint file %s\n", filename);
+    return;
+  }
+
+  fprintf(out, "# TRaX watchdog checkpoint\n");
+  fprintf(out, "TM %d cycle %lld last_issue %lld\n",
+          (int)thread_procs[0]->GetActiveThread()->core_id, current_cycle, last_progress_cycle);
+  for (size_t i = 0; i < thread_procs.size(); ++i)
+  {
+    for (int j = 0; j < thread_procs[i]->num_threads; ++j)
+    {
+      ThreadState* thread = thread_procs[i]->thread_states[j];
+      fprintf(out, "\nthread %d (thread processor %d, hw thread %d)%s pc %lld next_pc %lld in_flight %d\n",
+              thread->thread_id, (int)i, j, thread_procs[i]->halted ? " halted" : "",
+              thread->program_counter, thread->next_program_counter, thread->instructions_in_flight);
+      fprintf(out, "stall: ");
+      DescribeStall(out, thread, j == thread_procs[i]->active_thread);
+      // register contents, and where the pending write comes from
+      for (int reg = 0; reg < thread->registers->num_registers; ++reg)
+      {
+        fprintf(out, "r%d 0x%08x %g", reg, thread->registers->udata[reg], thread->registers->fdata[reg]);
+        if (thread->register_ready[reg] > current_cycle)
+        {
+          Instruction* producer = thread->GetFailInstruction(reg);
+          fprintf(out, " ready %lld", thread->register_ready[reg]);
+          if (producer)
+            fprintf(out, " from %s (pc %d)", Instruction::Opnames[producer->op].c_str(), producer->pc_address);
+        }
+        fprintf(out, "\n");
+      }
+    }
+  }
+
+  GlobalRegisterFile* globals = NULL;
+  for (size_t i = 0; i < units.size() && !globals; ++i)
+    globals = dynamic_cast<GlobalRegisterFile*>(units[i]);
+  if (globals)
+  {
+    fprintf(out, "\nglobal registers:");
+    for (int reg = 0; reg < globals->num_registers; ++reg)
+      fprintf(out, " %u", globals->ReadUint(reg));
+    fprintf(out, "\n");
+  }
+
+  fprintf(out, "\n");
+  DescribeMemory(out);
+  fclose(out);
+  printf("Watchdog checkpoint written to %s\n", filename);
 }
 
 void IssueUnit::HaltSystem()
@@ -327,14 +716,37 @@ void IssueUnit::HaltSystem()
 
 void IssueUnit::ClockRise()
 {
+  // wake the threads a barrier or semaphore release is due to wake (see
+  // SyncQueues.h), released by TMs that may be clocked on other host threads
+  if (!sync_sleepers.empty())
+  {
+    pthread_mutex_lock(&global_mutex);
+    for (size_t i = 0; i < sync_sleepers.size(); )
+    {
+      ThreadState* thread = sync_sleepers[i];
+      if (thread->sync_wake_cycle <= current_cycle)
+      {
+        thread->sync_wake_cycle = -1;
+        thread->Wake(true);
+        sync_sleepers.erase(sync_sleepers.begin() + i);
+      }
+      else
+        i++;
+    }
+    pthread_mutex_unlock(&global_mutex);
+  }
 
   // schedule next thread for multitrthreading
   for(size_t i=0; i<thread_procs.size(); i++)
   {
     thread_procs[i]->Schedule(schedule_data[i].last_issued,
-                              schedule_data[i].last_stall);
+                              schedule_data[i].last_stall,
+                              schedule_data[i].last_blocked,
+                              current_cycle);
     schedule_data[i].last_issued = Instruction::NOP;
     schedule_data[i].last_stall = Instruction::NOP;
+    schedule_data[i].last_blocked = false;
+    schedule_data[i].last_blocked = false;
   }
 
   // clear issued "bit" (for printing)
@@ -420,8 +832,32 @@ bool IssueUnit::Issue(ThreadProcessor* tp, ThreadState* thread, Instruction* fet
 
   int fail_reg = -1;
   bool issued = false;
+  // asleep until a release wakes it
+  if (thread->sync_wake_cycle >= 0)
+  {
+    sync_sleep_stalls++;
+    schedule_data[proc_id].last_blocked = true;
+    return false;
+  }
+
   if (fetched_instruction->ReadyToIssue(thread->register_ready, &fail_reg, current_cycle))
   {
+    // a node load waits while its treelet isn't active
+    if (treelets && !treelets->MayIssue(thread, fetched_instruction, current_cycle))
+    {
+      treelet_stalls++;
+      schedule_data[proc_id].last_blocked = true;
+      return false;
+    }
+
+    // the operands are ready, but banked registers may take a few cycles to read
+    if (!register_banks.empty() &&
+        !register_banks[proc_id]->Collect(fetched_instruction, thread, current_cycle))
+    {
+      register_bank_stalls++;
+      return false;
+    }
+
     // check functional units
     if (fetched_instruction->op == Instruction::NOP ||
         fetched_instruction->op == Instruction::nop ||
@@ -495,30 +931,38 @@ bool IssueUnit::Issue(ThreadProcessor* tp, ThreadState* thread, Instruction* fet
     // TODO: Need to add these to the ISA
     else if (fetched_instruction->op == Instruction::SETTRIPIPE)
     {
-      for (size_t i = 0; i < units.size(); i++)
+      // a TRIPIPE line's pipelines are dedicated units, always set up
+      if (!HasIntersectionUnit(Instruction::TRITEST))
       {
-        // Double triangle pipelines use 8 MULs, 4 ADDs,
-        // leaving 1 and 4 (if we assume 9 MULs, 8 ADDs)
-        FPMul* munit = dynamic_cast<FPMul*>(units[i]);
-        if(munit)
-          munit->width = 1;
-        FPAddSub* aunit = dynamic_cast<FPAddSub*>(units[i]);
-        if(aunit)
-          aunit->width = 4;
+        for (size_t i = 0; i < units.size(); i++)
+        {
+          // Double triangle pipelines use 8 MULs, 4 ADDs,
+          // leaving 1 and 4 (if we assume 9 MULs, 8 ADDs)
+          FPMul* munit = dynamic_cast<FPMul*>(units[i]);
+          if(munit)
+            munit->width = 1;
+          FPAddSub* aunit = dynamic_cast<FPAddSub*>(units[i]);
+          if(aunit)
+            aunit->width = 4;
+        }
       }
       issued = true;
     }
     else if (fetched_instruction->op == Instruction::SETBOXPIPE)
     {
-      for (size_t i = 0; i < units.size(); i++)
+      // a BOXPIPE line's pipelines are dedicated units, always set up
+      if (!HasIntersectionUnit(Instruction::BOXTEST))
       {
-        // Box pipeline use 6 MULs, 6 ADDs, leaving 3 and 2 (if we assume 9 MULs, 8 ADDs)
-        FPMul* munit = dynamic_cast<FPMul*>(units[i]);
-        if(munit)
-          munit->width = 3;
-        FPAddSub* aunit = dynamic_cast<FPAddSub*>(units[i]);
-        if(aunit)
-          aunit->width = 2;
+        for (size_t i = 0; i < units.size(); i++)
+        {
+          // Box pipeline use 6 MULs, 6 ADDs, leaving 3 and 2 (if we assume 9 MULs, 8 ADDs)
+          FPMul* munit = dynamic_cast<FPMul*>(units[i]);
+          if(munit)
+            munit->width = 3;
+          FPAddSub* aunit = dynamic_cast<FPAddSub*>(units[i]);
+          if(aunit)
+            aunit->width = 2;
+        }
       }
       issued = true;
     }
@@ -530,12 +974,17 @@ bool IssueUnit::Issue(ThreadProcessor* tp, ThreadState* thread, Instruction* fet
       // Only HaltSystem() after all threads reach a halt, otherwise return false
       for (size_t i = 0; i < thread_procs.size(); ++i)
       {
-        ThreadState *curr_thread = thread_procs[i]->GetActiveThread();
-        if (!curr_thread->fetched_instruction ||
-            curr_thread->fetched_instruction->op != Instruction::HALT)
+        // every hardware thread, not just the ones the schedulers picked
+        for (size_t k = 0; k < thread_procs[i]->thread_states.size(); ++k)
         {
-          // stall halts until they all agree
-          return false;
+          ThreadState *curr_thread = thread_procs[i]->thread_states[k];
+          if (!curr_thread->fetched_instruction ||
+              curr_thread->fetched_instruction->op != Instruction::HALT)
+          {
+            // stall halts until they all agree, running the other threads
+            schedule_data[proc_id].last_blocked = true;
+            return false;
+          }
         }
       }
       // All threads fetched a halt
@@ -612,6 +1061,8 @@ bool IssueUnit::Issue(ThreadProcessor* tp, ThreadState* thread, Instruction* fet
 
     if (!issued)
     {
+      // let the scheduler try another thread
+      schedule_data[proc_id].last_blocked = true;
       if (fetched_instruction->op == Instruction::SLEEP)
         instructions_misc++;
       else
@@ -668,6 +1119,12 @@ bool IssueUnit::Issue(ThreadProcessor* tp, ThreadState* thread, Instruction* fet
 	debugger->run(thread, fetched_instruction);
       }
 
+    if (!register_banks.empty())
+      register_banks[proc_id]->Issued();
+    if (treelets)
+      treelets->Issued(thread, fetched_instruction);
+    last_progress_cycle = current_cycle;
+
     // stats and info
     simd_issue++;
     profile_instruction_count[thread->program_counter]++;
@@ -684,55 +1141,8 @@ void IssueUnit::MultipleIssueClockFall()
   if(halted)
     return;
 
-  // This just checks for long periods without successful issue
-  static unsigned int current_issue_fails = 0;
-  if (current_issue_fails > 500000 * thread_procs.size())
-  {
-    bool allHalted = true;
-    printf("_-=<WARNING>=-_ 500000 cycles without a successful issue.\n");
-    for (size_t thread_offset = 0;
-         thread_offset < thread_procs.size();
-         thread_offset += simd_width)
-    {
-      size_t proc_id = thread_offset;
-      ThreadState* thread = thread_procs[proc_id]->GetActiveThread();
-      Instruction* fetched_instruction = thread->fetched_instruction;
-      if(fetched_instruction->op != Instruction::HALT)
-        allHalted = false;
-
-      printf("Cycle %lld: Thread %d: Instruction %llu (PC:%llu): current op (%s)\n",
-             current_cycle,
-             static_cast<int>(proc_id),
-             fetched_instruction->id,
-             thread->program_counter - 1,
-             Instruction::Opnames[fetched_instruction->op].c_str() );
-
-      printf("\tthread_id = %d, core_id = %d\n", thread->thread_id, (int)thread->core_id);
-
-      printf("\tregister_ready[%d][%d][%d] = %lld, %lld, %lld\n",
-             fetched_instruction->args[0], fetched_instruction->args[1],
-             fetched_instruction->args[2],
-             thread->register_ready[fetched_instruction->args[0]],
-             thread->register_ready[fetched_instruction->args[1]],
-             thread->register_ready[fetched_instruction->args[2]]);
-    }
-
-    exit(1);
-
-    if(allHalted)
-    {
-      printf("halting\n");
-      HaltSystem();
-    }
-    else
-    {
-      printf("Not halting\n");
-      verbosity = 1;
-    }
-  }
-
   // Begin standard issue code
-  int issue_width = 1;
+  int issue_width = issue_rules ? issue_rules->width : 1;
 
   // Choose a start thread
   int start_thread = 0;
@@ -757,6 +1167,14 @@ void IssueUnit::MultipleIssueClockFall()
       continue;
     int num_issued = 0;
     bool issued = true;
+    // for the ISSUE rules: what the thread issued so far this cycle, and
+    // what stopped it short of issue_width
+    Instruction::Opcode last_op = Instruction::NOP;
+    int ports_used = 0;
+    IssueRules::LostSlot lost_to = IssueRules::LOST_OTHER;
+    long long int data_before = data_dependence;
+    long long int fu_before = fu_dependence;
+    long long int banks_before = register_bank_stalls;
 
     // change this when simd is added back in
     size_t proc_id = (thread_offset + start_thread) % thread_procs.size();
@@ -773,17 +1191,18 @@ void IssueUnit::MultipleIssueClockFall()
       issued = Issue(thread_procs[proc_id], thread, fetched_instruction, proc_id);
       if (issued)
       {
+        last_op = fetched_instruction->op;
+        ports_used += IssueRules::ReadPorts(fetched_instruction);
         thread->fetched_instruction = NULL;
         fetched_instruction = NULL;
         num_issued++;
-        current_issue_fails = 0;
         thread->last_issue = current_cycle;
       }
       else
       {
         // stall
         instructions_stalled++;
-        current_issue_fails++;
+        lost_to = IssueFailure(data_before, fu_before, banks_before);
       }
     }
 
@@ -802,6 +1221,14 @@ void IssueUnit::MultipleIssueClockFall()
           exit(1);
         }
 
+        if (!icaches.empty() && !ICacheFetch(thread, proc_id, icache_num))
+        {
+          // waiting for the line to arrive from L2
+          instructions_stalled++;
+          lost_to = IssueRules::LOST_FETCH;
+          break;
+        }
+
         thread->fetched_instruction = thread->instructions[thread->program_counter];
         thread->program_counter = thread->next_program_counter;
         thread->next_program_counter++;
@@ -811,21 +1238,34 @@ void IssueUnit::MultipleIssueClockFall()
         // stats
         bank_cycles_used++;
 
+        // a later instruction of the cycle has to pair with the one before
+        // it, it waits for the next cycle otherwise
+        if (issue_rules && num_issued > 0)
+        {
+          lost_to = issue_rules->Check(last_op, fetched_instruction, ports_used);
+          if (lost_to != IssueRules::NUM_LOST)
+            break;
+        }
+
         // Issue
+        data_before = data_dependence;
+        fu_before = fu_dependence;
+        banks_before = register_bank_stalls;
         issued = Issue(thread_procs[proc_id], thread, fetched_instruction, proc_id);
         if (issued)
         {
+          last_op = fetched_instruction->op;
+          ports_used += IssueRules::ReadPorts(fetched_instruction);
           thread->fetched_instruction = NULL;
           fetched_instruction = NULL;
           num_issued++;
-          current_issue_fails = 0;
           thread->last_issue = current_cycle;
         }
         else
         {
           // stall - record reason
           instructions_stalled++;
-          current_issue_fails++;
+          lost_to = IssueFailure(data_before, fu_before, banks_before);
           break;
         }
       }
@@ -842,13 +1282,32 @@ void IssueUnit::MultipleIssueClockFall()
         iCache_conflicts++;
         instructions_stalled++;
         // unfilled_issue_slots += issued_width - num_issued;
-        current_issue_fails++;
+        lost_to = IssueRules::LOST_FETCH;
         break;
       }
     }
+
+    if (issue_rules)
+    {
+      issue_rules->slots += issue_width;
+      if (num_issued < issue_width)
+        issue_rules->lost[lost_to] += issue_width - num_issued;
+    }
   }
 }
 
+IssueRules::LostSlot IssueUnit::IssueFailure(long long int data_before, long long int fu_before,
+                                             long long int banks_before)
+{
+  if (register_bank_stalls != banks_before)
+    return IssueRules::LOST_BANKS;
+  if (data_dependence != data_before)
+    return IssueRules::LOST_DATA;
+  if (fu_dependence != fu_before)
+    return IssueRules::LOST_UNIT;
+  return IssueRules::LOST_OTHER;
+}
+
 void IssueUnit::SIMDClockFall()
 {
   // first choose a simd block
@@ -860,6 +1319,7 @@ void IssueUnit::SIMDClockFall()
     bool issued = true;
 
     // try to issue any threads that have been fetched first
+    coalesce_group = thread_offset / simd_width;
     for (size_t i = 0; i < simd_width; ++i)
     {
       size_t proc_id = thread_offset + i;
@@ -883,7 +1343,7 @@ void IssueUnit::SIMDClockFall()
           simd_state[proc_id] = 0;
           thread->last_issue = current_cycle;
           // save the last issued to fetch the next one first
-          simd_last_issued[thread_offset] = proc_id - thread_offset;
+          simd_last_issued[thread_offset / simd_width] = proc_id - thread_offset;
         }
         else
         {
@@ -892,13 +1352,17 @@ void IssueUnit::SIMDClockFall()
         }
       }
     }
+    coalesce_group = -1;
 
-    // check if any threads in this block still need to issue
+    // check if any threads in this block still need to issue. Lanes parked
+    // at a BARRIER, SEM_ACQ or HALT may be waiting for lanes of the block
+    // that diverged from them, which are fetched around them.
     bool any_fetched = false;
     for (size_t i = 0; i < simd_width; ++i)
     {
       size_t proc_id = thread_offset + i;
-      if (simd_state[proc_id] > 0)
+      if (simd_state[proc_id] > 0 &&
+          !SIMDLaneParked(thread_procs[proc_id]->GetActiveThread()))
       {
         any_fetched = true;
         break;
@@ -911,8 +1375,23 @@ void IssueUnit::SIMDClockFall()
       continue;
     }
 
-    // start with the one after the last one to issue, but only when fetching
-    size_t proc_id = (simd_last_issued[thread_offset] + 1) % simd_width + thread_offset;
+    // start with the one after the last one to issue, but only when
+    // fetching, and skip the parked lanes
+    size_t proc_id = thread_procs.size();
+    for (size_t i = 1; i <= simd_width; ++i)
+    {
+      size_t lane = (simd_last_issued[thread_offset / simd_width] + i) % simd_width;
+      if (simd_state[thread_offset + lane] == 0)
+      {
+        proc_id = thread_offset + lane;
+        break;
+      }
+    }
+    if (proc_id == thread_procs.size())
+    {
+      // every lane is parked
+      continue;
+    }
     ThreadState* thread = thread_procs[proc_id]->GetActiveThread();
 
     // Fetch this block
@@ -926,32 +1405,42 @@ void IssueUnit::SIMDClockFall()
         printf("Error: invalid program counter: %lld\n", thread->program_counter);
         exit(1);
       }
-      thread->fetched_instruction = thread->instructions[thread->program_counter];
-      thread->program_counter = thread->next_program_counter;
-      thread->next_program_counter++;
-      thread->fetched_instruction->id = thread->instruction_id++;
-      // stats
-      bank_cycles_used++;
-      // mark thread as fetched
-      simd_state[proc_id] = 1;
-
-      // fetch simd block
-      for (size_t i = 1; i < simd_width; ++i)
+      if (!icaches.empty() && !ICacheFetch(thread, proc_id, icache_num))
+      {
+        // waiting for the line to arrive from L2
+        instructions_stalled++;
+      }
+      else
       {
-        size_t mod_val = (proc_id - thread_offset + i) % simd_width;
-        size_t next_proc_id = mod_val + thread_offset;
-        ThreadState* next_thread = thread_procs[next_proc_id]->GetActiveThread();
-        // check if this thread is on the same instruction
-        if (thread->program_counter - 1 == next_thread->program_counter)
+        thread->fetched_instruction = thread->instructions[thread->program_counter];
+        thread->program_counter = thread->next_program_counter;
+        thread->next_program_counter++;
+        thread->fetched_instruction->id = thread->instruction_id++;
+        // stats
+        bank_cycles_used++;
+        // mark thread as fetched
+        simd_state[proc_id] = 1;
+
+        // fetch simd block
+        for (size_t i = 1; i < simd_width; ++i)
         {
-          next_thread->fetched_instruction =
-              next_thread->instructions[next_thread->program_counter];
-          next_thread->program_counter = next_thread->next_program_counter;
-          next_thread->next_program_counter++;
-          next_thread->fetched_instruction->id = next_thread->instruction_id++;
-
-          // mark thread as fetched
-          simd_state[next_proc_id] = 1;
+          size_t mod_val = (proc_id - thread_offset + i) % simd_width;
+          size_t next_proc_id = mod_val + thread_offset;
+          ThreadState* next_thread = thread_procs[next_proc_id]->GetActiveThread();
+          // check if this thread is on the same instruction (and not parked
+          // on one already)
+          if (simd_state[next_proc_id] == 0 &&
+              thread->program_counter - 1 == next_thread->program_counter)
+          {
+            next_thread->fetched_instruction =
+                next_thread->instructions[next_thread->program_counter];
+            next_thread->program_counter = next_thread->next_program_counter;
+            next_thread->next_program_counter++;
+            next_thread->fetched_instruction->id = next_thread->instruction_id++;
+
+            // mark thread as fetched
+            simd_state[next_proc_id] = 1;
+          }
         }
       }
     }
@@ -965,6 +1454,138 @@ void IssueUnit::SIMDClockFall()
   }
 }
 
+bool IssueUnit::HasIntersectionUnit(Instruction::Opcode test)
+{
+  for (size_t i = 0; i < units.size(); i++)
+    if (dynamic_cast<IntersectionUnit*>(units[i]) && units[i]->SupportsOp(test))
+      return true;
+  return false;
+}
+
+bool IssueUnit::SIMDLaneParked(ThreadState* thread)
+{
+  Instruction* fetched_instruction = thread->fetched_instruction;
+  return fetched_instruction != NULL &&
+    (fetched_instruction->op == Instruction::BARRIER ||
+     fetched_instruction->op == Instruction::SEM_ACQ ||
+     fetched_instruction->op == Instruction::HALT);
+}
+
+// Each warp fetches the instruction at the top of its reconvergence stack
+// once for all its active lanes, and fetches the next only when every one
+// of them has issued it. Lanes that reach HALT leave the warp.
+void IssueUnit::SIMTClockFall()
+{
+  if (halted)
+    return;
+
+  long long int next_pc[MAX_SIMT_WIDTH];
+  for (size_t w = 0; w < warps.size(); ++w)
+  {
+    SIMTWarp& warp = warps[w];
+    size_t first_proc = w * simt_width;
+
+    // lanes at HALT wait for the rest of the TM
+    for (unsigned int lane = 0; lane < simt_width; ++lane)
+    {
+      if (warp.exited & (1ULL << lane))
+      {
+        ThreadState* thread = thread_procs[first_proc + lane]->GetActiveThread();
+        Issue(thread_procs[first_proc + lane], thread, thread->fetched_instruction, first_proc + lane);
+      }
+    }
+
+    if (warp.pending == 0)
+    {
+      if (warp.Done())
+        continue;
+
+      long long int pc = warp.PC();
+      unsigned long long int active = warp.ActiveMask();
+      size_t leader = first_proc;
+      while (!(active & (1ULL << (leader - first_proc))))
+        leader++;
+      ThreadState* thread = thread_procs[leader]->GetActiveThread();
+      if (pc < 0)
+      {
+        printf("Error: invalid program counter: %lld\n", pc);
+        exit(1);
+      }
+
+      // Fetch once for the warp
+      int icache_num = w % num_icaches;
+      int bank_num = pc % icache_banks;
+      if (bank_fetched[icache_num][bank_num] >= fetch_per_cycle)
+      {
+        iCache_conflicts++;
+        instructions_stalled++;
+        continue;
+      }
+      bank_fetched[icache_num][bank_num]++;
+      if (!icaches.empty() && !ICacheFetch(thread, leader, icache_num))
+      {
+        // waiting for the line to arrive from L2
+        instructions_stalled++;
+        continue;
+      }
+      bank_cycles_used++;
+
+      for (unsigned int lane = 0; lane < simt_width; ++lane)
+      {
+        if (!(active & (1ULL << lane)))
+          continue;
+        ThreadState* lane_thread = thread_procs[first_proc + lane]->GetActiveThread();
+        if (lane_thread->program_counter != pc)
+        {
+          printf("ERROR: SIMT lane %d of warp %d is at pc %lld, its warp at %lld\n",
+                 lane, (int)w, lane_thread->program_counter, pc);
+          exit(1);
+        }
+        lane_thread->fetched_instruction = lane_thread->instructions[pc];
+        lane_thread->program_counter = lane_thread->next_program_counter;
+        lane_thread->next_program_counter++;
+        lane_thread->fetched_instruction->id = lane_thread->instruction_id++;
+        warp.active_lanes++;
+      }
+      warp.pending = active;
+      warp.fetched_pc = pc;
+      warp.instructions++;
+    }
+
+    // Issue the lanes that haven't yet
+    coalesce_group = w;
+    for (unsigned int lane = 0; lane < simt_width; ++lane)
+    {
+      if (!(warp.pending & (1ULL << lane)))
+        continue;
+      size_t proc_id = first_proc + lane;
+      ThreadState* thread = thread_procs[proc_id]->GetActiveThread();
+      profile_instruction_cycle_count[thread->program_counter]++;
+      if (Issue(thread_procs[proc_id], thread, thread->fetched_instruction, proc_id))
+      {
+        warp.pending &= ~(1ULL << lane);
+        thread->fetched_instruction = NULL;
+        thread->last_issue = current_cycle;
+      }
+      else if (thread->fetched_instruction->op == Instruction::HALT)
+      {
+        warp.pending &= ~(1ULL << lane);
+        warp.halting |= 1ULL << lane;
+      }
+      else
+        instructions_stalled++;
+    }
+    coalesce_group = -1;
+
+    if (warp.pending == 0)
+    {
+      for (unsigned int lane = 0; lane < simt_width; ++lane)
+        next_pc[lane] = thread_procs[first_proc + lane]->GetActiveThread()->program_counter;
+      warp.Advance(warp.fetched_pc, next_pc, reconvergence);
+    }
+  }
+}
+
 void IssueUnit::ClockFall()
 {
 #if 0 // This method of profiling is deprecated.
@@ -1011,7 +1632,12 @@ void IssueUnit::ClockFall()
     }
   }
 */
-  if (simd_width < 2)
+  if (watchdog_cycles > 0 && !halted && current_cycle - last_progress_cycle > watchdog_cycles)
+    Watchdog();
+
+  if (simt_width > 1)
+    SIMTClockFall();
+  else if (simd_width < 2)
     MultipleIssueClockFall();
   else
     SIMDClockFall();
@@ -1019,6 +1645,102 @@ void IssueUnit::ClockFall()
   current_cycle++;
 }
 
+// The issue unit can only skip a cycle if every thread already has an
+// instruction fetched that is waiting on a register (or waiting at HALT for
+// the rest of the TM), since the outcome is then the same every cycle until
+// the earliest of those registers is written. Anything else (fetching,
+// resource conflicts, SLEEP, SIMD/SIMT, multiple threads per processor,
+// register banks, tracing)
+// is handled cycle by cycle.
+long long int IssueUnit::NextEventCycle()
+{
+  if (halted)
+    return NO_EVENT_CYCLE;
+  if (simd_width > 1 || simt_width > 1 || !register_banks.empty() ||
+      verbosity > 0 || enable_profiling || debugger->isEnabled())
+    return -1;
+
+  long long int next_cycle = NO_EVENT_CYCLE;
+  size_t num_at_halt = 0;
+  for (size_t i = 0; i < thread_procs.size(); i++)
+  {
+    if (thread_procs[i]->halted)
+      continue;
+    if (thread_procs[i]->num_threads > 1)
+      return -1;
+    ThreadState* thread = thread_procs[i]->GetActiveThread();
+    Instruction* fetched_instruction = thread->fetched_instruction;
+    if (fetched_instruction == NULL)
+      return -1;
+
+    int fail_reg = -1;
+    if (fetched_instruction->ReadyToIssue(thread->register_ready, &fail_reg, current_cycle))
+    {
+      if (fetched_instruction->op != Instruction::HALT)
+        return -1;
+      skip_fail_op[i] = Instruction::HALT;
+      num_at_halt++;
+    }
+    else
+    {
+      skip_fail_op[i] = thread->GetFailOp(fail_reg);
+      if (thread->register_ready[fail_reg] < next_cycle)
+        next_cycle = thread->register_ready[fail_reg];
+    }
+  }
+
+  // the whole TM halts once every thread reaches HALT
+  if (num_at_halt == thread_procs.size())
+    return -1;
+  return next_cycle;
+}
+
+// Credits the same stats ClockRise and ClockFall would have for each
+// stalled cycle
+void IssueUnit::SkipCycles(long long int num_cycles)
+{
+  thread_issue_count[0] += num_cycles;
+  total_bank_cycles += num_cycles * num_icaches * icache_banks;
+
+  if (!halted)
+  {
+    for (size_t i = 0; i < thread_procs.size(); i++)
+    {
+      if (thread_procs[i]->halted)
+        continue;
+      ThreadState* thread = thread_procs[i]->GetActiveThread();
+      profile_instruction_cycle_count[thread->program_counter] += num_cycles;
+      if (issue_rules)
+        issue_rules->slots += num_cycles * issue_rules->width;
+      if (skip_fail_op[i] == Instruction::HALT)
+      {
+        halted_count += num_cycles;
+        if (issue_rules)
+          issue_rules->lost[IssueRules::LOST_OTHER] += num_cycles * issue_rules->width;
+      }
+      else
+      {
+        if (issue_rules)
+          issue_rules->lost[IssueRules::LOST_DATA] += num_cycles * issue_rules->width;
+        data_dependence += num_cycles;
+        data_depend_bins[skip_fail_op[i]] += num_cycles;
+        not_ready += num_cycles;
+      }
+      instructions_stalled += num_cycles;
+    }
+  }
+
+  std::vector<ThreadProcessor*>::iterator tpIter;
+  for (tpIter = thread_procs.begin() ; tpIter != thread_procs.end(); ++tpIter)
+  {
+    ThreadProcessor* tpRef = *tpIter;
+    for(int j = 0; j < tpRef->num_threads; ++j)
+      tpRef->thread_states[j]->ApplyWrites(current_cycle + num_cycles - 1);
+  }
+
+  current_cycle += num_cycles;
+}
+
 void IssueUnit::print()
 {
   print(-1);
@@ -1027,13 +1749,17 @@ void IssueUnit::print()
 void IssueUnit::print(int total_system_TMs = -1)
 {
   printf("profile data:\n");
-  printf("kernel\ttotal calls\ttotal cycles\n");
+  if (icaches.empty())
+    printf("kernel\ttotal calls\ttotal cycles\n");
+  else
+    printf("kernel\ttotal calls\ttotal cycles\ticache misses\n");
 
   // print machine-wide kernel stats
   for (int i = 0; i < MAX_NUM_KERNELS; ++i)
   {
     long long int total_calls = 0;
     long long int total_cycles = 0;
+    long long int total_icache_misses = 0;
 
     for(size_t j = 0; j < thread_procs.size(); j++)
     {
@@ -1041,13 +1767,17 @@ void IssueUnit::print(int total_system_TMs = -1)
       {
         total_calls += kernel_calls[i][j];
         total_cycles += kernel_cycles[i][j];
+        total_icache_misses += kernel_icache_misses[i][j];
       }
     }
 
     if(total_calls == 0)
       continue;
 
-    printf("%d\t%lld\t%lld\n", i, total_calls, total_cycles);
+    if (icaches.empty())
+      printf("%d\t%lld\t%lld\n", i, total_calls, total_cycles);
+    else
+      printf("%d\t%lld\t%lld\t%lld\n", i, total_calls, total_cycles, total_icache_misses);
   }
 
   printf("Data dependence stalls (caused by):\n");
@@ -1116,10 +1846,90 @@ void IssueUnit::print(int total_system_TMs = -1)
   printf(" --Average #threads Issuing each cycle: %.4lf\n", issue_stats.avg_issue);
   printf(" --Issue Rate: %.2f%%\n", (issue_stats.avg_issue / static_cast<float>(total_system_threads) * 100));
   printf(" --iCache conflicts: %lld (%f%%)\n", iCache_conflicts, issue_stats.avg_iCache_conflicts / divisor);
+  if (!icaches.empty())
+  {
+    long long int accesses = 0, misses = 0, fills = 0, prefetches = 0;
+    for (size_t i = 0; i < icaches.size(); i++)
+    {
+      accesses += icaches[i]->accesses;
+      misses += icaches[i]->misses;
+      fills += icaches[i]->fills;
+      prefetches += icaches[i]->prefetches;
+    }
+    printf(" --iCache misses: %lld of %lld lookups (%f%%), %lld lines filled (%lld prefetched)\n",
+           misses, accesses, accesses > 0 ? 100.f * misses / accesses : 0.f, fills, prefetches);
+    printf(" --thread*cycles waiting on iCache fills: %lld\n", iCache_fill_stalls);
+  }
   printf(" --thread*cycles of resource conflicts: %lld (%f%%)\n", fu_dependence, issue_stats.avg_fu_dependence / divisor);
+  if (!register_banks.empty())
+  {
+    long long int reads = 0, writes = 0, spilled = 0;
+    for (size_t i = 0; i < register_banks.size(); i++)
+    {
+      reads += register_banks[i]->reads;
+      writes += register_banks[i]->writes;
+      spilled += register_banks[i]->write_conflicts;
+    }
+    printf(" --register banks (%d banks, %d read and %d write ports each): %lld reads, %lld writes (%lld delayed by write port conflicts)\n",
+           register_banks[0]->num_banks, register_banks[0]->read_ports, register_banks[0]->write_ports, reads, writes, spilled);
+    printf(" --thread*cycles of register bank conflicts: %lld\n", register_bank_stalls);
+  }
+  if (treelets)
+    printf(" --thread*cycles parked waiting for a treelet: %lld\n", treelet_stalls);
+  for (size_t i = 0; i < units.size(); i++)
+    if (dynamic_cast<SharedUnitPool*>(units[i])) {
+      printf(" --thread*cycles waiting for a shared unit grant: %lld\n", arbitration_stalls);
+      break;
+    }
+  if (sync_sleep_stalls > 0)
+    printf(" --thread*cycles asleep on BARRIER/SEM_ACQ: %lld\n", sync_sleep_stalls);
   printf(" --thread*cycles of data dependence: %lld (%f%%)\n", data_dependence, issue_stats.avg_data_dependence / divisor);
   printf(" --thread*cycles halted: %lld (%f%%)\n", halted_count, issue_stats.avg_halted_count / divisor);
   printf(" --thread*cycles of issue NOP/other: %lld (%f%%)\n", instructions_misc, issue_stats.avg_misc_count / divisor);
+  if (issue_rules && simt_width < 2)
+    issue_rules->Print();
+
+  if (simt_width > 1)
+  {
+    long long int warp_instructions = 0, active_lanes = 0, divergences = 0;
+    size_t max_depth = 0;
+    double min_efficiency = 100., max_efficiency = 0.;
+    for (size_t i = 0; i < warps.size(); i++)
+    {
+      warp_instructions += warps[i].instructions;
+      active_lanes += warps[i].active_lanes;
+      divergences += warps[i].divergences;
+      if (warps[i].max_depth > max_depth)
+        max_depth = warps[i].max_depth;
+      if (warps[i].instructions == 0)
+        continue;
+      double efficiency = 100. * warps[i].active_lanes / warps[i].instructions / simt_width;
+      if (efficiency < min_efficiency)
+        min_efficiency = efficiency;
+      if (efficiency > max_efficiency)
+        max_efficiency = efficiency;
+    }
+    double lanes = warp_instructions > 0 ? static_cast<double>(active_lanes) / warp_instructions : 0.;
+    printf(" --SIMT (%u-lane warps): %lld warp instructions for %lld thread instructions, %lld divergent branches, stack depth up to %d\n",
+           simt_width, warp_instructions, active_lanes, divergences, (int)max_depth);
+    printf(" --average active lanes: %.2f, SIMD efficiency: %.2f%% (per warp %.2f%% to %.2f%%)\n",
+           lanes, 100. * lanes / simt_width, min_efficiency, max_efficiency);
+  }
+
+  if (thread_procs[0]->num_threads > 1)
+  {
+    long long int switches = 0, other_ready = 0, none_ready = 0;
+    for (size_t i = 0; i < thread_procs.size(); i++)
+    {
+      switches += thread_procs[i]->thread_switches;
+      other_ready += thread_procs[i]->stalls_other_ready;
+      none_ready += thread_procs[i]->stalls_none_ready;
+    }
+    printf(" --thread scheduling (%s): %lld thread switches\n",
+           ThreadProcessor::SchedulingName(thread_procs[0]->schedule), switches);
+    printf(" --thread*cycles of data stalls with another thread ready: %lld\n", other_ready);
+    printf(" --thread*cycles of data stalls with no thread ready: %lld\n", none_ready);
+  }
 }
 
 // This function is for stats-tracking only.
@@ -1137,7 +1947,28 @@ void IssueUnit::AddStats(IssueUnit* otherIssuer)
   fu_dependence += otherIssuer->fu_dependence;
   data_dependence += otherIssuer->data_dependence;
   iCache_conflicts += otherIssuer->iCache_conflicts;
+  iCache_fill_stalls += otherIssuer->iCache_fill_stalls;
+  for (size_t i = 0; i < icaches.size(); i++)
+    icaches[i]->AddStats(otherIssuer->icaches[i]);
   halted_count += otherIssuer->halted_count;
+  if (issue_rules)
+    issue_rules->AddStats(otherIssuer->issue_rules);
+  for (size_t i = 0; i < otherIssuer->register_banks.size() && !register_banks.empty(); ++i)
+    register_banks[i % register_banks.size()]->AddStats(otherIssuer->register_banks[i]);
+  register_bank_stalls += otherIssuer->register_bank_stalls;
+  if (treelets)
+    treelets->AddStats(otherIssuer->treelets);
+  treelet_stalls += otherIssuer->treelet_stalls;
+  arbitration_stalls += otherIssuer->arbitration_stalls;
+  sync_sleep_stalls += otherIssuer->sync_sleep_stalls;
+  for (size_t i = 0; i < warps.size(); i++)
+  {
+    warps[i].instructions += otherIssuer->warps[i].instructions;
+    warps[i].active_lanes += otherIssuer->warps[i].active_lanes;
+    warps[i].divergences += otherIssuer->warps[i].divergences;
+    if (otherIssuer->warps[i].max_depth > warps[i].max_depth)
+      warps[i].max_depth = otherIssuer->warps[i].max_depth;
+  }
 
   current_cycle = current_cycle < otherIssuer->current_cycle ? otherIssuer->current_cycle : current_cycle;
 
@@ -1156,12 +1987,16 @@ void IssueUnit::AddStats(IssueUnit* otherIssuer)
     {
       kernel_calls[i][j] += otherIssuer->kernel_calls[i][j];
       kernel_cycles[i][j] += otherIssuer->kernel_cycles[i][j];
+      kernel_icache_misses[i][j] += otherIssuer->kernel_icache_misses[i][j];
     }
   }
 
   // Issue statistics
   for (size_t i = 0; i < thread_procs.size(); i++)
   {
+    thread_procs[i]->thread_switches += otherIssuer->thread_procs[i]->thread_switches;
+    thread_procs[i]->stalls_other_ready += otherIssuer->thread_procs[i]->stalls_other_ready;
+    thread_procs[i]->stalls_none_ready += otherIssuer->thread_procs[i]->stalls_none_ready;
     for(size_t j = 0; j < thread_procs[i]->thread_states.size(); j++)
     {
       thread_procs[i]->thread_states[j]->instructions_issued +=
@@ -6,6 +6,11 @@
 #include "Instruction.h"
 #include "FunctionalUnit.h"
 #include "Debugger.h"
+#include "InstructionCache.h"
+#include "SIMTStack.h"
+#include "IssueRules.h"
+#include "RegisterBanks.h"
+#include "TreeletScheduler.h"
 #include <setjmp.h>
 #include <vector>
 #include <map>
@@ -59,6 +64,7 @@ class IssueUnit : public HardwareModule {
   long long int **kernel_cycles;
   int **kernel_calls;
   int **kernel_profiling;
+  long long int **kernel_icache_misses;
   long long int current_cycle;
   //long long int end_sleep_cycle;
   /*   long long int total_kernel_stalls; */
@@ -85,6 +91,8 @@ class IssueUnit : public HardwareModule {
   void ClockFall();
   void print();
   void print(int total_system_TMs);
+  long long int NextEventCycle();
+  void SkipCycles(long long int num_cycles);
 
   void HaltSystem();
 
@@ -93,9 +101,49 @@ class IssueUnit : public HardwareModule {
   bool Issue(ThreadProcessor* tp, ThreadState* thread, Instruction* fetched_instruction, size_t proc_id);
   void MultipleIssueClockFall();
   void SIMDClockFall();
+  // Is there a BOXPIPE or TRIPIPE unit for test (BOXTEST or TRITEST)
+  bool HasIntersectionUnit(Instruction::Opcode test);
+  // Is a SIMD lane waiting at a BARRIER, SEM_ACQ or HALT it fetched
+  bool SIMDLaneParked(ThreadState* thread);
+  void SIMTClockFall();
   void AddStats(IssueUnit* otherIssuer);
   void CalculateIssueStats();
 
+  // Replace the always-hit icache with a tag model (ICACHE config line)
+  void EnableICacheModel(const InstructionCacheParams& params, const char* icache_params_file);
+  // Area and energy from the closest icache params entry, warning once
+  bool NearestICacheParams(const char* icache_params_file, int capacity_bytes, int banks, int line_size_bytes,
+                           float& model_area, float& model_energy, bool& warned);
+  // Look up the thread's next instruction, false if it has to wait for a fill
+  bool ICacheFetch(ThreadState* thread, size_t proc_id, int icache_num);
+  long long int ICacheFills();
+
+  // Multiple issue per thread under ISSUE/PAIR config rules
+  void EnableIssueRules(const IssueParams& params);
+  // Why Issue() just failed, from the stall counters it bumped
+  IssueRules::LostSlot IssueFailure(long long int data_before, long long int fu_before,
+                                    long long int banks_before);
+
+  // Banked register file with operand collectors (RFBANKS config line)
+  void EnableRegisterBanks(const RegisterBankParams& params);
+  // nJ spent on register bank accesses
+  double RegisterBankEnergy();
+
+  // Park threads entering treelets that aren't active (TREELETS config line)
+  void EnableTreeletScheduler(const TreeletParams& params, MainMemory* memory);
+
+  // Called when no instruction has issued for watchdog_cycles cycles (a
+  // deadlock or a very long stall): print why each thread is stuck and
+  // what the memory system holds for this TM, write the checkpoint and exit
+  void Watchdog();
+  // active: the thread is its thread processor's scheduled thread
+  void DescribeStall(FILE* out, ThreadState* thread, bool active);
+  void DescribeMemory(FILE* out);
+  void WriteCheckpoint(const char* filename);
+
+  // Issue in warps of width thread processors (--simt-width)
+  void EnableSIMT(int width, const ReconvergenceTable* table);
+
   bool vector_stats;
   bool enable_profiling;
   Profiler* profiler;
@@ -126,6 +174,16 @@ class IssueUnit : public HardwareModule {
   long long int unit_contention[Instruction::NUM_OPS];
   long long int data_depend_bins[Instruction::NUM_OPS];
   long long int fu_dependence, data_dependence;
+  // thread*cycles spent collecting operands from conflicting register banks
+  long long int register_bank_stalls;
+  // thread*cycles parked by the treelet scheduler
+  long long int treelet_stalls;
+  // thread*cycles waiting for a grant from a shared unit pool
+  long long int arbitration_stalls;
+  // threads asleep on a BARRIER or SEM_ACQ (SYNCWAKE line), and the
+  // thread*cycles they slept
+  std::vector<ThreadState*> sync_sleepers;
+  long long int sync_sleep_stalls;
   IssueStats issue_stats;
 
   // The current read queue for this TM
@@ -139,6 +197,24 @@ class IssueUnit : public HardwareModule {
   long long int simd_issue;
   long long int simd_bonus_fetches;
 
+  // SIMT: warps[i] is thread_procs[i * simt_width, (i + 1) * simt_width)
+  unsigned int simt_width;
+  std::vector<SIMTWarp> warps;
+  const ReconvergenceTable* reconvergence;
+  // from ISSUE/PAIR config lines, NULL for single issue
+  IssueRules* issue_rules;
+  // one per thread processor with RFBANKS, empty without
+  std::vector<RegisterBanks*> register_banks;
+  // from a TREELETS config line, NULL without
+  TreeletScheduler* treelets;
+  // --watchdog cycles without any issue before Watchdog() (0 = never)
+  long long int watchdog_cycles;
+  long long int last_progress_cycle;
+  // --watchdog-checkpoint file, NULL for none
+  const char* watchdog_checkpoint;
+  // The warp being issued, for the L1 to coalesce its lanes' accesses (-1: none)
+  int coalesce_group;
+
   long long int *profile_instruction_count;
   long long int *profile_instruction_cycle_count;
 
@@ -147,12 +223,18 @@ class IssueUnit : public HardwareModule {
   int **bank_fetched;
   static const int fetch_per_cycle = 2;
   long long int iCache_conflicts;
+  // one per icache with the ICACHE model, empty without
+  std::vector<InstructionCache*> icaches;
+  long long int iCache_fill_stalls;
   long long int total_bank_cycles;
   long long int bank_cycles_used;
   ScheduleData *schedule_data;
 
   int current_proc_id;
 
+  // Why each thread is stalled, filled in by NextEventCycle() for SkipCycles()
+  Instruction::Opcode *skip_fail_op;
+
 #if 0
   Instruction* fetched_instruction;
   Instruction* issued_this_cycle;
@@ -92,6 +92,11 @@ L1Cache::L1Cache(L2Cache* _L2, int _hit_latency,
   same_word_conflicts = 0;
   bus_transfers = 0;
   bus_hits = 0;
+
+  coalescing = true;
+  warp_accesses = 0;
+  warp_requests = 0;
+  warp_instructions = 0;
 }
 
 L1Cache::~L1Cache() {
@@ -117,6 +122,11 @@ void L1Cache::Reset()
   same_word_conflicts = 0;
   bus_transfers = 0;
   bus_hits = 0;
+  coalesced_lines.clear();
+  warp_issuing.clear();
+  warp_accesses = 0;
+  warp_requests = 0;
+  warp_instructions = 0;
 }
 
 bool L1Cache::SupportsOp(Instruction::Opcode op) const {
@@ -126,6 +136,56 @@ bool L1Cache::SupportsOp(Instruction::Opcode op) const {
 }
 
 bool L1Cache::AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState* thread) {
+  int group = issuer->coalesce_group;
+  if (!coalescing || group < 0 || (ins.op != Instruction::LOAD && ins.op != Instruction::STORE))
+    return Access(ins, issuer, thread, false);
+
+  // Find the line, Access() does the real register read
+  reg_value arg;
+  Instruction::Opcode failop;
+  thread->ReadRegister(ins.op == Instruction::LOAD ? ins.args[1] : ins.args[0], issuer->current_cycle, arg, failop);
+  int line = (arg.idata + ins.args[2]) >> line_size;
+
+  bool coalesced = false;
+  for (size_t i = 0; i < coalesced_lines.size(); ++i) {
+    if (coalesced_lines[i].group == group && coalesced_lines[i].line == line)
+      coalesced = true;
+  }
+
+  if (!Access(ins, issuer, thread, coalesced))
+    return false;
+
+  // a lane issuing a different instruction, or one of the warp's lanes
+  // issuing again, starts the warp's next instruction
+  if ((size_t)group >= warp_issuing.size()) {
+    WarpInstruction none;
+    none.ins = NULL;
+    warp_issuing.resize(group + 1, none);
+  }
+  WarpInstruction& issuing = warp_issuing[group];
+  bool new_instruction = issuing.ins != &ins;
+  for (size_t i = 0; i < issuing.lanes.size() && !new_instruction; ++i)
+    if (issuing.lanes[i] == thread)
+      new_instruction = true;
+  if (new_instruction) {
+    issuing.ins = &ins;
+    issuing.lanes.clear();
+    warp_instructions++;
+  }
+  issuing.lanes.push_back(thread);
+
+  warp_accesses++;
+  if (!coalesced) {
+    warp_requests++;
+    CoalescedLine request;
+    request.group = group;
+    request.line = line;
+    coalesced_lines.push_back(request);
+  }
+  return true;
+}
+
+bool L1Cache::Access(Instruction& ins, IssueUnit* issuer, ThreadState* thread, bool coalesced) {
   // Synchronize current cycle with issuer
   //current_cycle = issuer->current_cycle;
   
@@ -178,7 +238,7 @@ bool L1Cache::AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState
 	return true;
       }
     }
-    if (issued_this_cycle[bank_id] && !unit_off) {
+    if (issued_this_cycle[bank_id] && !unit_off && !coalesced) {
       bank_conflicts++;
       //printf("\tbank conflict\n", address);
       return false;
@@ -465,7 +525,7 @@ bool L1Cache::AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState
     }    
     int address = arg0.idata + ins.args[2];
     int bank_id = address % num_banks;
-    if (issued_this_cycle[bank_id] && !unit_off) {
+    if (issued_this_cycle[bank_id] && !unit_off && !coalesced) {
       bank_conflicts++;
       return false;
     }
@@ -497,6 +557,7 @@ bool L1Cache::AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState
 // From HardwareModule
 void L1Cache::ClockRise() {
   processed_this_cycle = 0;
+  coalesced_lines.clear();
   for (int i = 0; i < num_banks; ++i) {
     issued_this_cycle[i] = 0;
     read_address[i] = -1;
@@ -540,6 +601,14 @@ void L1Cache::ClockFall() {
   current_cycle++;
 }
 
+// Pending line fills and bus transfers are only looked at on the clock, so
+// skipping is the same as one clock at the last skipped cycle
+void L1Cache::SkipCycles(long long int num_cycles) {
+  current_cycle += num_cycles - 1;
+  ClockRise();
+  ClockFall();
+}
+
 void L1Cache::print() {
   printf("L1Cache\n");
 }
@@ -556,6 +625,9 @@ void L1Cache::PrintStats() {
   printf("L1 stores: \t%lld\n", stores);
   printf("L1 hit rate: \t%f\n", static_cast<float>(hits)/accesses);
   printf("Hit under miss: %lld\n", bus_hits);
+  if (warp_instructions > 0)
+    printf("L1 coalescing: %lld warp lane accesses in %lld line requests, %.2f requests per warp instruction\n",
+	   warp_accesses, warp_requests, static_cast<float>(warp_requests) / warp_instructions);
   //printf("L2 -> L1 bus transfers: %lld\n", bus_transfers);
 }
 
@@ -680,5 +752,8 @@ void L1Cache::AddStats(L1Cache* otherL1)
   same_word_conflicts += otherL1->same_word_conflicts;
   bus_transfers += otherL1->bus_transfers;
   bus_hits += otherL1->bus_hits;
+  warp_accesses += otherL1->warp_accesses;
+  warp_requests += otherL1->warp_requests;
+  warp_instructions += otherL1->warp_instructions;
   
 }
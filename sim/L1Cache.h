@@ -26,6 +26,8 @@ public:
   ~L1Cache();
   virtual bool SupportsOp(Instruction::Opcode op) const;
   virtual bool AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState* thread);
+  // A coalesced access shares the line request of another lane of its warp
+  bool Access(Instruction& ins, IssueUnit* issuer, ThreadState* thread, bool coalesced);
 
   // From HardwareModule
   virtual void ClockRise();
@@ -33,6 +35,7 @@ public:
   virtual void print();
   virtual void PrintStats();
   virtual double Utilization();
+  virtual void SkipCycles(long long int num_cycles);
   void Clear();
   void Reset();
   void AddStats(L1Cache* otherL1);
@@ -91,6 +94,28 @@ public:
   long long int same_word_conflicts;
   long long int bus_transfers;
   long long int bus_hits;
+
+  // Coalescing of warp (SIMD/SIMT) loads and stores. While the issue unit
+  // issues the lanes of a warp it sets issuer->coalesce_group, and lanes
+  // going to a line another lane of that warp reached this cycle don't need
+  // a bank of their own, they get their word out of the same line access.
+  struct CoalescedLine {
+    int group;
+    int line;
+  };
+  // The instruction each warp's lanes are issuing and the lanes that have
+  // issued it, so a warp instruction whose lanes issue over several cycles
+  // is counted once
+  struct WarpInstruction {
+    const Instruction* ins;
+    std::vector<ThreadState*> lanes;
+  };
+  bool coalescing;
+  std::vector<CoalescedLine> coalesced_lines;
+  std::vector<WarpInstruction> warp_issuing;
+  long long int warp_accesses;
+  long long int warp_requests;
+  long long int warp_instructions;
   
 //   // Memory access record
 //   bool memory_trace;
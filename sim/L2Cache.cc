@@ -415,6 +415,15 @@ void L2Cache::PrintStats() {
     printf("L2 bandwidth limited stalls: %lld\n", bandwidth_stalls);
 }
 
+void L2Cache::SkipCycles(long long int num_cycles) {
+  // the fill bandwidth drains max_data_per_cycle each cycle
+  long long int drained = (long long int)max_data_per_cycle * (num_cycles - 1);
+  outstanding_data = drained >= outstanding_data ? 0 : outstanding_data - (int)drained;
+  current_cycle += num_cycles - 1;
+  ClockRise();
+  ClockFall();
+}
+
 double L2Cache::Utilization() {
   return static_cast<double>(processed_this_cycle) / num_banks;
 }
@@ -38,6 +38,7 @@ public:
   virtual void print();
   virtual void PrintStats();
   virtual double Utilization();
+  virtual void SkipCycles(long long int num_cycles);
 
   bool IssueInstruction(Instruction* ins, L1Cache* L1, ThreadState* thread, 
 			long long int &ret_latency, long long int current_cycle, 
@@ -6,9 +6,19 @@
 #include <limits.h>
 #include <cstdlib>
 #include <math.h>
+#include <boost/chrono.hpp>
 
 using namespace simtrax;
 
+// The few words of the memory image that depend on the machine rather than the scene.
+// Kept separate so a parameter sweep can reuse one loaded scene for different machines.
+void LoadMachineParams(FourByte* mem, int num_rotation_threads, int num_TMs)
+{
+  mem[23].ivalue = (int)log2f(static_cast<float>(num_rotation_threads)); // + 1 for finer granularity on work assignments
+  mem[25].ivalue = num_rotation_threads;
+  mem[35].ivalue = num_TMs;
+}
+
 void LoadMemory(LoadMemoryParams &pio)
 {
   int permutation[] = { 151,160,137,91,90,15,
@@ -60,9 +70,8 @@ void LoadMemory(LoadMemoryParams &pio)
   
 // pio.mem[21].ivalue = num_nodes;
 // pio.mem[22].ivalue = start_costs;
-  pio.mem[23].ivalue = (int)log2f(static_cast<float>(pio.num_rotation_threads)); // + 1 for finer granularity on work assignments
+// pio.mem[23], pio.mem[25] and pio.mem[35] hold the machine size, see LoadMachineParams
 // pio.mem[24].ivalue = start_secondary_bvh;
-  pio.mem[25].ivalue = pio.num_rotation_threads;
   //pio.mem[26].ivalue = start_subtree_sizes;
   //pio.mem[27].ivalue = start_rotated_flags;
   //pio.mem[28].ivalue = start_triangles;
@@ -72,7 +81,7 @@ void LoadMemory(LoadMemoryParams &pio)
   //pio.mem[32].ivalue = start_parent_pointers;
   //pio.mem[33].ivalue = start_subtree_ids;
   //pio.mem[34].ivalue = num_subtrees;
-  pio.mem[35].ivalue = pio.num_TMs;
+  LoadMachineParams(pio.mem, pio.num_rotation_threads, pio.num_TMs);
   //pio.mem[36].ivalue = start_vertex_normals;
   //pio.mem[37].ivalue = num_interior_subtrees;
   pio.mem[38].ivalue = pio.pack_split_axis;
@@ -149,10 +158,13 @@ void LoadMemory(LoadMemoryParams &pio)
       pio.start_scene++;
 
       Grid* grid = NULL;
+      boost::chrono::system_clock::time_point build_start = boost::chrono::system_clock::now();
       if(pio.grid_dimensions==-1)
         pio.bvh = new BVH( triangles, pio.subtree_size, pio.duplicate_bvh, pio.triangles_store_edges, pio.pack_split_axis, pio.pack_stream_boundaries, pio.store_parent_pointers);
       else
         grid = new Grid(triangles, pio.triangles_store_edges, pio.grid_dimensions);
+      boost::chrono::duration<double> build_time = boost::chrono::system_clock::now() - build_start;
+      pio.bvh_build_seconds = build_time.count();
       pio.mem[21].ivalue = pio.bvh->num_nodes;
       int scene_data = pio.start_scene;
 
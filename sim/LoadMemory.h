@@ -58,6 +58,7 @@ struct LoadMemoryParams
     int  start_light;
     int  start_permutation;
     int  end_memory;
+    double bvh_build_seconds;
 
     LoadMemoryParams() :
         // Memory info, Trax setup
@@ -98,7 +99,8 @@ struct LoadMemoryParams
         start_bg_color(0),
         start_light(0),
         start_permutation(0),
-        end_memory(0)
+        end_memory(0),
+        bvh_build_seconds(0)
     {
         light_pos[0] = 7.97f;
         light_pos[1] = 1.4f;
@@ -108,5 +110,6 @@ struct LoadMemoryParams
 
 
 void LoadMemory(LoadMemoryParams &paramsInOut);
+void LoadMachineParams(FourByte* mem, int num_rotation_threads, int num_TMs);
 
 #endif // _HWRT_LOADMEMORY_H_
@@ -4,20 +4,13 @@
 #include "Instruction.h"
 #include "ThreadState.h"
 #include "SimpleRegisterFile.h"
+#include "ImageWriter.h"
 
 #include <pthread.h>
 
 // use this if writes need to be atomic
 extern pthread_mutex_t memory_mutex;
 
-// Windows pipe stuff (needs stdio.h)
-#ifdef WIN32
-# ifndef popen
-#       define popen _popen
-#       define pclose _pclose
-# endif
-#endif
-
 
 MainMemory::MainMemory(int _num_blocks,  int _latency, int _max_bandwidth)
     :latency(_latency)
@@ -32,6 +25,7 @@ MainMemory::MainMemory(int _num_blocks,  int _latency, int _max_bandwidth)
   image_height = 0;
   image_width = 0;
   incremental_output = false;
+  image_writer = NULL;
 }
 
 bool MainMemory::IssueInstruction(Instruction* ins, L2Cache* L2, ThreadState* thread,
@@ -67,39 +61,14 @@ bool MainMemory::IssueInstruction(Instruction* ins, L2Cache* L2, ThreadState* th
     pthread_mutex_lock(&memory_mutex);
     data[address].uvalue = arg1.udata;
     store_count++;
+    // Output as we go along. The writer copies the framebuffer and returns,
+    // the image is encoded and written by its own thread.
+    if(incremental_output && image_writer && store_count%stores_between_output==0)
+      image_writer->Snapshot(data + start_framebuffer, store_count/stores_between_output);
     pthread_mutex_unlock(&memory_mutex);
     return true;
   }
 
-  // Output as we go along
-  if(incremental_output && store_count%stores_between_output==0)
-  {
-    char command_buf[512];
-    sprintf(command_buf, "convert PPM:- out%d.png", store_count/stores_between_output);
-    FILE* output = popen(command_buf, "w");
-    if (!output)
-      perror("Failed to open out.png");
-
-    fprintf(output, "P6\n%d %d\n%d\n", image_width, image_height, 255);
-    for (int j = image_height - 1; j >= 0; j--)
-    {
-      for (int i = 0; i < image_width; i++)
-      {
-        int index = start_framebuffer + 3 * (j * image_width + i);
-        float rgb[3];
-        // for gradient/colors we have the result
-        rgb[0] = L2->mem->getData()[index + 0].fvalue;
-        rgb[1] = L2->mem->getData()[index + 1].fvalue;
-        rgb[2] = L2->mem->getData()[index + 2].fvalue;
-        fprintf(output, "%c%c%c",
-                (char)(int)(rgb[0] * 255),
-                (char)(int)(rgb[1] * 255),
-                (char)(int)(rgb[2] * 255));
-      }
-    }
-    pclose(output);
-  }
-
   return false;
 }
 
@@ -0,0 +1,68 @@
+#include "RandomGenerator.h"
+#include "SimpleRegisterFile.h"
+#include "ThreadState.h"
+
+// x^32 + x^22 + x^2 + x + 1
+#define LFSR_TAPS 0x80200003u
+
+unsigned long long RandomGenerator::Seed(const RandParams& params, ThreadState* thread)
+{
+  // splitmix64 of the seed and the thread's TM and number within it
+  unsigned long long key = ((unsigned long long)thread->core_id << 32) | (unsigned int)thread->registers->thread_id;
+  unsigned long long z = params.seed + (key + 1) * 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  z = z ^ (z >> 31);
+
+  // the 32 bit generators get stuck at 0
+  if (params.generator != RandParams::PCG)
+    z &= 0xffffffffULL;
+  return z != 0 ? z : 1;
+}
+
+float RandomGenerator::Next(const RandParams& params, ThreadState* thread, unsigned long long& state)
+{
+  state = thread->rand_state != 0 ? thread->rand_state : Seed(params, thread);
+
+  unsigned int output = 0;
+  switch (params.generator)
+  {
+    case RandParams::LFSR:
+    {
+      unsigned int lfsr = (unsigned int)state;
+      for (int i = 0; i < 32; i++)
+        lfsr = (lfsr >> 1) ^ (-(lfsr & 1u) & LFSR_TAPS);
+      state = lfsr;
+      output = lfsr;
+      break;
+    }
+
+    case RandParams::XORSHIFT:
+    {
+      unsigned int x = (unsigned int)state;
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      state = x;
+      output = x;
+      break;
+    }
+
+    case RandParams::PCG:
+    {
+      // each thread is its own stream
+      unsigned long long stream = ((unsigned long long)thread->core_id << 32) | (unsigned int)thread->registers->thread_id;
+      unsigned long long old = state;
+      state = old * 6364136223846793005ULL + ((stream << 1) | 1);
+      unsigned int xorshifted = (unsigned int)(((old >> 18) ^ old) >> 27);
+      unsigned int rot = (unsigned int)(old >> 59);
+      output = (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+      // 0 means unseeded
+      if (state == 0)
+        state = 1;
+      break;
+    }
+  }
+
+  return (output >> 8) * (1.f / 16777216.f);
+}
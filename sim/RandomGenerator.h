@@ -0,0 +1,52 @@
+#ifndef _SIMHWRT_RANDOM_GENERATOR_H_
+#define _SIMHWRT_RANDOM_GENERATOR_H_
+
+// Per hardware thread random number generators for RAND, set up by an RNG
+// line in the config file:
+//
+//   RNG <LFSR | XORSHIFT | PCG> <latency> <seed (optional)>
+//
+// Without it RAND returns the host's drand48(), shared by every thread, so
+// what each thread gets depends on the order the host runs them in. With
+// it every hardware thread has its own generator state, seeded from <seed>
+// (default 0), its TM and its thread number, so a thread's sequence is the
+// same in every run at any --simulation-threads count. RAND then takes
+// <latency> cycles instead of the FPADD unit's latency.
+//
+// LFSR is a 32 bit Galois LFSR stepped 32 times per RAND (a leap-forward
+// LFSR in hardware), XORSHIFT is Marsaglia's 32 bit xorshift, and PCG is
+// PCG32 (XSH RR, 64 bit state, one stream per thread) as a reference. The
+// result is the top 24 bits of the output as a float in [0, 1).
+
+class ThreadState;
+
+// RNG config line parameters
+struct RandParams {
+  enum Generator {
+    LFSR,
+    XORSHIFT,
+    PCG
+  };
+
+  bool enabled;
+  Generator generator;
+  int latency;
+  unsigned long long seed;
+
+  RandParams() :
+    enabled(false), generator(XORSHIFT), latency(1), seed(0)
+  {}
+};
+
+class RandomGenerator {
+public:
+  // thread's next random number; state is set to the thread's state after
+  // it, for the caller to keep once the RAND issues
+  static float Next(const RandParams& params, ThreadState* thread, unsigned long long& state);
+
+private:
+  // thread's starting state, never 0
+  static unsigned long long Seed(const RandParams& params, ThreadState* thread);
+};
+
+#endif // _SIMHWRT_RANDOM_GENERATOR_H_
@@ -1,6 +1,7 @@
 #include "ReadConfig.h"
 #include "HardwareModule.h"
 #include "FunctionalUnit.h"
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -20,16 +21,20 @@
 #include "Instruction.h"
 #include "IntAddSub.h"
 #include "IntMul.h"
+#include "IntersectionUnit.h"
 #include "L1Cache.h"
 #include "L2Cache.h"
 #include "MainMemory.h"
+#include "StreamMemory.h"
+#include "TraversalUnit.h"
 #include "TraxCore.h"
 
 
 ReadConfig::ReadConfig(const char* input_file, const char* _dcache_params_file,
 		       L2Cache** L2s, size_t num_L2s, MainMemory*& mem,
 		       double &size_estimate, bool disable_usimm, bool _memory_trace, bool _l1_off, bool _l2_off, bool _l1_read_copy) :
-  input_file(input_file), memory_trace(_memory_trace), l1_off(_l1_off), l2_off(_l2_off), l1_read_copy(_l1_read_copy)
+  input_file(input_file), memory_trace(_memory_trace), l1_off(_l1_off), l2_off(_l2_off), l1_read_copy(_l1_read_copy),
+  stream_memory(NULL)
 {
   FILE* input = fopen(input_file, "r");
   if (!input) {
@@ -100,12 +105,139 @@ ReadConfig::ReadConfig(const char* input_file, const char* _dcache_params_file,
 			     memory_trace, l2_off, l1_off);
       }
 
+    }
+    else if (unit_string == "STREAM") {
+      // chip-wide stream buffer, see StreamMemory.h
+      int latency;
+      int capacity;
+      int num_banks;
+      int dram_latency;
+      int burst_words;
+      float unit_area = 0;
+      float unit_energy = 0;
+
+      int scanvalue = sscanf(line_buf, "%*s %d %d %d %d %d %f %f", &latency, &capacity,
+			     &num_banks, &dram_latency, &burst_words, &unit_area, &unit_energy);
+      if ( scanvalue < 5 || scanvalue > 7 ) {
+	printf("ERROR: STREAM syntax is STREAM <latency> <capacity in words> <banks> <DRAM latency> <DRAM burst words> <area mm^2 (optional)> <energy per access nJ (optional)>\n");
+	continue;
+      }
+
+      if(scanvalue != 7)
+	{
+	  // sized like a data cache with a burst per line, or the closest one
+	  // dcacheparams.txt has
+	  if(!ReadCacheParams(dcache_params_file, capacity * 4, num_banks, burst_words * 4, unit_area, unit_energy, true))
+	    {
+	      int row_capacity, row_banks, row_line_size;
+	      if(ReadNearestCacheParams(dcache_params_file, capacity * 4, num_banks, burst_words * 4, unit_area, unit_energy,
+					row_capacity, row_banks, row_line_size))
+		printf("WARNING: no dcache params for a %d byte, %d bank STREAM with %d byte bursts, using the %d byte, %d bank, %d byte line entry with its area scaled to %d bytes\n",
+		       capacity * 4, num_banks, burst_words * 4, row_capacity, row_banks, row_line_size, capacity * 4);
+	      else
+		printf("WARNING: no dcache params for a %d byte, %d bank STREAM with %d byte bursts, assuming 0 area and energy\n",
+		       capacity * 4, num_banks, burst_words * 4);
+	    }
+	}
+
+      stream_memory = new StreamMemory(latency, capacity, num_banks, dram_latency, burst_words);
+      stream_memory->area = unit_area;
+      // energy is counted per word accessed rather than per instruction
+      stream_memory->energy = 0;
+      stream_memory->access_energy = unit_energy;
+    }
+    else if (unit_string == "GLOBALS") {
+      // batched global registers, see GlobalRegisterFile.h
+      if (sscanf(line_buf, "%*s %d %d", &global_params.ops_per_cycle, &global_params.latency) != 2) {
+	printf("ERROR: GLOBALS syntax is GLOBALS <ops per cycle> <latency>\n");
+	continue;
+      }
+      global_params.enabled = true;
+    }
+    else if (unit_string == "WORKQUEUE") {
+      // per TM work queues in front of a global register, see WorkDistributor.h
+      int scanvalue = sscanf(line_buf, "%*s %d %d %d %d", &work_queue.reg, &work_queue.chunk_size,
+			     &work_queue.refill_latency, &work_queue.refill_threshold);
+      if ( scanvalue < 3 ) {
+	printf("ERROR: WORKQUEUE syntax is WORKQUEUE <global register> <chunk size> <refill latency> <refill threshold (optional)>\n");
+	continue;
+      }
+      work_queue.enabled = true;
+    }
+    else if (unit_string == "SYNCWAKE") {
+      // sleeping BARRIER and SEM_ACQ, see SyncQueues.h
+      if (sscanf(line_buf, "%*s %d", &sync_wake.release_latency) != 1) {
+	printf("ERROR: SYNCWAKE syntax is SYNCWAKE <release latency>\n");
+	continue;
+      }
+      sync_wake.enabled = true;
+    }
+    else if (unit_string == "RNG") {
+      // per thread generators for RAND, see RandomGenerator.h
+      char generator[100];
+      int scanvalue = sscanf(line_buf, "%*s %99s %d %llu", generator, &rand_params.latency, &rand_params.seed);
+      std::string generator_name(generator);
+      if ( scanvalue < 2 || rand_params.latency < 1 ||
+	   (generator_name != "LFSR" && generator_name != "XORSHIFT" && generator_name != "PCG") ) {
+	printf("ERROR: RNG syntax is RNG <LFSR | XORSHIFT | PCG> <latency> <seed (optional)>\n");
+	continue;
+      }
+      if (generator_name == "LFSR")
+	rand_params.generator = RandParams::LFSR;
+      else if (generator_name == "XORSHIFT")
+	rand_params.generator = RandParams::XORSHIFT;
+      else
+	rand_params.generator = RandParams::PCG;
+      rand_params.enabled = true;
+    }
+    else if (unit_string == "INTERVAL") {
+      // initiation interval and sharing of the long latency units, see UnitLanes.h
+      char unit[100];
+      UnitLaneParams params;
+      int scanvalue = sscanf(line_buf, "%*s %99s %d %d", unit, &params.interval, &params.tms_per_unit);
+      std::string unit_name(unit);
+      if ( scanvalue < 2 || (unit_name != "FPDIV" && unit_name != "FPINVSQRT" && unit_name != "FPINV") ) {
+	printf("ERROR: INTERVAL syntax is INTERVAL <FPDIV | FPINVSQRT> <initiation interval> <TMs per unit (optional)>\n");
+	continue;
+      }
+      params.enabled = true;
+      if (unit_name == "FPDIV")
+	div_lanes = params;
+      else
+	invsqrt_lanes = params;
+    }
+    else if (unit_string == "SHARE") {
+      // a unit shared between TMs, see SharedUnitPool.h
+      char unit[100];
+      char arbitration[100] = "ROUNDROBIN";
+      SharedUnitParams params;
+      int scanvalue = sscanf(line_buf, "%*s %99s %d %99s", unit, &params.tms_per_pool, arbitration);
+      std::string unit_name(unit == std::string("FPINVSQRT") ? "FPINV" : unit);
+      std::string arbitration_name(arbitration);
+      if ( scanvalue < 2 || params.tms_per_pool < 1 ||
+	   (arbitration_name != "ROUNDROBIN" && arbitration_name != "AGE") ||
+	   (unit_name != "FPADD" && unit_name != "FPMIN" && unit_name != "FPCMP" &&
+	    unit_name != "INTADD" && unit_name != "FPMUL" && unit_name != "FPINV" &&
+	    unit_name != "INTMUL" && unit_name != "CONV" && unit_name != "BLT" &&
+	    unit_name != "BITWISE") ) {
+	printf("ERROR: SHARE syntax is SHARE <FPADD | FPMIN | FPCMP | INTADD | FPMUL | FPINV | INTMUL | CONV | BLT | BITWISE> <TMs per pool> <ROUNDROBIN | AGE (optional)>\n");
+	continue;
+      }
+      if (arbitration_name == "AGE")
+	params.arbitration = SharedUnitParams::AGE;
+      shared_units[unit_name] = params;
     } else {
       // a per-core module line (skipped here)
     }
   }
 
   fclose(input);
+
+  if (shared_units.count("FPINV") &&
+      (div_lanes.tms_per_unit > 1 || invsqrt_lanes.tms_per_unit > 1)) {
+    printf("ERROR: FPINV can't be shared by both a SHARE line and an INTERVAL line\n");
+    exit(1);
+  }
 }
 
 void ReadConfig::LoadConfig(L2Cache* L2, double &size_estimate) {
@@ -130,10 +262,24 @@ void ReadConfig::LoadConfig(L2Cache* L2, double &size_estimate) {
     sscanf(line_buf, "%s ", unit_type);
     std::string unit_string(unit_type);
     if (unit_string == "MEMORY" ||
-        unit_string == "L2")
+        unit_string == "L2" ||
+        unit_string == "GLOBALS" ||
+        unit_string == "WORKQUEUE" ||
+        unit_string == "SYNCWAKE" ||
+        unit_string == "RNG" ||
+        unit_string == "INTERVAL" ||
+        unit_string == "SHARE")
       {
       // already loaded
       } 
+    else if (unit_string == "STREAM") {
+      // already loaded, shared by every TM
+      if (stream_memory) {
+	modules->push_back(stream_memory);
+	functional_units->push_back(stream_memory);
+	module_names->push_back(std::string("Stream Memory"));
+      }
+    }
     else if (unit_string == "L1") {
       // load L1
       int hit_latency;
@@ -166,13 +312,152 @@ void ReadConfig::LoadConfig(L2Cache* L2, double &size_estimate) {
 
       modules->push_back(current_core->L1);
 
-    }     
+    }
+    else if (unit_string == "ICACHE") {
+      // instruction cache model, built by the IssueUnit
+      InstructionCacheParams& params = current_core->icache_params;
+      int prefetch = 0;
+      int scanvalue = sscanf(line_buf, "%*s %d %d %d %d %d", &params.fill_latency,
+			     &params.cache_size, &params.associativity, &params.line_size, &prefetch);
+      if ( scanvalue < 4 || scanvalue > 5 || params.associativity < 1) {
+	printf("ERROR: ICACHE syntax is ICACHE <fill latency> <cache size> <associativity> <line size(**2)> <next-line prefetch 0/1 (optional)>\n");
+	continue;
+      }
+      params.prefetch_next_line = prefetch != 0;
+      params.enabled = true;
+    }
+    else if (unit_string == "ISSUE") {
+      // issue width and register file read ports per thread, see IssueRules.h
+      IssueParams& params = current_core->issue_params;
+      if (sscanf(line_buf, "%*s %d %d", &params.width, &params.read_ports) != 2) {
+	printf("ERROR: ISSUE syntax is ISSUE <instructions per thread per cycle> <register file read ports (0 for unlimited)>\n");
+	continue;
+      }
+      params.enabled = true;
+    }
+    else if (unit_string == "RFBANKS") {
+      // banked register file per thread processor, see RegisterBanks.h
+      RegisterBankParams& params = current_core->register_bank_params;
+      if (sscanf(line_buf, "%*s %d %d %d %f", &params.num_banks, &params.read_ports,
+		 &params.write_ports, &params.energy) < 3) {
+	printf("ERROR: RFBANKS syntax is RFBANKS <banks> <read ports per bank> <write ports per bank> <energy per access nJ (optional)>\n");
+	continue;
+      }
+      params.enabled = true;
+    }
+    else if (unit_string == "TREELETS") {
+      // treelet-aware thread scheduling, see TreeletScheduler.h
+      TreeletParams& params = current_core->treelet_params;
+      if (sscanf(line_buf, "%*s %d %d %d", &params.active_treelets, &params.idle_cycles,
+		 &params.treelet_words) < 2) {
+	printf("ERROR: TREELETS syntax is TREELETS <active treelets> <idle cycles> <treelet size in words (optional)>\n");
+	continue;
+      }
+      params.enabled = true;
+    }
+    else if (unit_string == "PAIR") {
+      char first[100], second[100];
+      if (sscanf(line_buf, "%*s %99s %99s", first, second) != 2) {
+	printf("ERROR: PAIR syntax is PAIR <unit> <unit>\n");
+	continue;
+      }
+      current_core->issue_params.pairs.push_back(std::string(first));
+      current_core->issue_params.pairs.push_back(std::string(second));
+      current_core->issue_params.enabled = true;
+    }
+    else if (unit_string == "BOXPIPE" || unit_string == "TRIPIPE") {
+      // fixed function intersection pipelines, see IntersectionUnit.h
+      int latency;
+      int num_pipelines;
+      int pipe_width;
+      int interval;
+      float unit_area = -1;
+      float unit_energy = -1;
+      int scanvalue = sscanf(line_buf, "%*s %d %d %d %d %f %f", &latency, &num_pipelines,
+			     &pipe_width, &interval, &unit_area, &unit_energy);
+      if ( scanvalue < 4 || scanvalue > 6) {
+	printf("ERROR: %s syntax is %s <latency> <pipelines> <width> <initiation interval> <area per lane mm^2 (optional)> <energy per test nJ (optional)>\n",
+	       unit_type, unit_type);
+	continue;
+      }
+
+      IntersectionUnit* pipe;
+      if (unit_string == "BOXPIPE") {
+	pipe = new IntersectionUnit(IntersectionUnit::BOX, latency, num_pipelines, pipe_width, interval);
+	module_names->push_back(std::string("Box Pipeline"));
+	// the FP units a box test replaces: 6 muls, 6 adds, 12 min/max and compares
+	if (unit_area < 0 || unit_energy < 0)
+	  {
+	    unit_area = .1257;
+	    unit_energy = .1360;
+	  }
+      }
+      else {
+	pipe = new IntersectionUnit(IntersectionUnit::TRIANGLE, latency, num_pipelines, pipe_width, interval);
+	module_names->push_back(std::string("Triangle Pipeline"));
+	// 27 muls, 24 adds, 5 compares and a divide
+	if (unit_area < 0 || unit_energy < 0)
+	  {
+	    unit_area = .6331;
+	    unit_energy = .7200;
+	  }
+      }
+      modules->push_back(pipe);
+      functional_units->push_back(pipe);
+      current_core->intersection_units.push_back(pipe);
+
+      size_estimate += unit_area * num_pipelines * pipe_width;
+      pipe->area = unit_area;
+      pipe->energy = unit_energy;
+    }
+    else if (unit_string == "TRAVERSAL") {
+      // fixed function BVH traversal, see TraversalUnit.h
+      int rays_in_flight;
+      int stack_depth;
+      int node_size;
+      int box_latency;
+      int triangle_latency;
+      float unit_area = -1;
+      float unit_energy = -1;
+      int scanvalue = sscanf(line_buf, "%*s %d %d %d %d %d %f %f", &rays_in_flight, &stack_depth,
+			     &node_size, &box_latency, &triangle_latency, &unit_area, &unit_energy);
+      if ( scanvalue < 5 || scanvalue > 7) {
+	printf("ERROR: TRAVERSAL syntax is TRAVERSAL <rays in flight> <stack depth> <node size> <box test latency> <triangle test latency> <area mm^2 (optional)> <energy per node or triangle nJ (optional)>\n");
+	continue;
+      }
+      if (current_core->traversal_unit) {
+	printf("ERROR: only one TRAVERSAL unit per TM\n");
+	continue;
+      }
+
+      TraversalUnit* traversal = new TraversalUnit(rays_in_flight, stack_depth, node_size,
+						   box_latency, triangle_latency);
+      modules->push_back(traversal);
+      functional_units->push_back(traversal);
+      module_names->push_back(std::string("Traversal Unit"));
+      current_core->traversal_unit = traversal;
+
+      // a box and a triangle pipeline (see BOXPIPE, TRIPIPE), plus the ray
+      // state and stack storage per ray in flight
+      if (unit_area < 0 || unit_energy < 0)
+	{
+	  unit_area = .1257 + .6331 + rays_in_flight * (stack_depth + 16) * .0147665 / 128;
+	  unit_energy = .1360;
+	}
+      size_estimate += unit_area;
+      traversal->area = unit_area;
+      // energy is counted per visit rather than per instruction
+      traversal->energy = 0;
+      traversal->visit_energy = unit_energy;
+    }
     else {
       // a simple module taking latency and issue width
       int latency;
       int issue_width;
       float unit_area = -1;
       float unit_energy = -1;
+      // the part of the unit's area this TM pays for
+      float area_share = 1;
 
       int scanvalue = sscanf(line_buf, "%*s %d %d %f %f", &latency, &issue_width, &unit_area, &unit_energy);
       // see if everything is provided
@@ -187,6 +472,18 @@ void ReadConfig::LoadConfig(L2Cache* L2, double &size_estimate) {
         // otherwise it worked
       }
 
+      // after the first TM in a group, a shared unit's pools already exist
+      std::string share_name = unit_string == "FPINVSQRT" ? "FPINV" : unit_string;
+      std::map<std::string, SharedUnitParams>::iterator shared = shared_units.find(share_name);
+      size_t first_unit = functional_units->size();
+      if (shared != shared_units.end()) {
+	area_share = 1.f / shared->second.tms_per_pool;
+	if (JoinPools(share_name, shared->second)) {
+	  size_estimate += functional_units->back()->area * issue_width * area_share;
+	  continue;
+	}
+      }
+
 
       // Add area to count if given
       if (unit_area >= 0) {
@@ -194,7 +491,7 @@ void ReadConfig::LoadConfig(L2Cache* L2, double &size_estimate) {
       }
 
       if (unit_string == "FPADD") {
-        FPAddSub* fp_addsub = new FPAddSub(latency, issue_width);
+        FPAddSub* fp_addsub = new FPAddSub(latency, issue_width, rand_params.enabled ? &rand_params : NULL);
 
         modules->push_back(fp_addsub);
         functional_units->push_back(fp_addsub);
@@ -257,13 +554,13 @@ void ReadConfig::LoadConfig(L2Cache* L2, double &size_estimate) {
 	  }
 
       } else if (unit_string == "FPINV" || unit_string == "FPINVSQRT") {
-        FPInvSqrt* fp_invsqrt = new FPInvSqrt(latency, issue_width);
+        FPInvSqrt* fp_invsqrt = InvSqrtUnit(latency, issue_width);
         modules->push_back(fp_invsqrt);
         functional_units->push_back(fp_invsqrt);
         module_names->push_back(std::string("FP InvSqrt"));
 
 	// ****** placeholder, add divide unit with same latency and width as the sqrt unit
-        FPDiv* fp_div = new FPDiv(latency, issue_width);
+        FPDiv* fp_div = DivUnit(latency, issue_width);
         modules->push_back(fp_div);
         functional_units->push_back(fp_div);
         module_names->push_back(std::string("FP Div"));
@@ -279,6 +576,8 @@ void ReadConfig::LoadConfig(L2Cache* L2, double &size_estimate) {
 	fp_invsqrt->energy = unit_energy;
 	fp_div->area = unit_area;
 	fp_div->energy = unit_energy;
+	// the area covers both, and a shared unit's is split between its TMs
+	area_share *= .5f / invsqrt_lanes.tms_per_unit + .5f / div_lanes.tms_per_unit;
 
       } else if (unit_string == "INTMUL") {
         IntMul* int_mul = new IntMul(latency, issue_width);
@@ -348,16 +647,101 @@ void ReadConfig::LoadConfig(L2Cache* L2, double &size_estimate) {
         continue;
       }
 
-      size_estimate += unit_area * issue_width;
+      size_estimate += unit_area * issue_width * area_share;
       functional_units->at(functional_units->size()-1)->area = unit_area;
       functional_units->at(functional_units->size()-1)->energy = unit_energy;
 
+      if (shared != shared_units.end())
+	MakePools(share_name, shared->second, first_unit, issue_width);
+
     }
   }
 
   fclose(input);
 }
 
+FPDiv* ReadConfig::DivUnit(int latency, int issue_width)
+{
+  if (!div_lanes.enabled)
+    return new FPDiv(latency, issue_width);
+
+  int unit = (int)current_core->core_id / div_lanes.tms_per_unit * div_lanes.tms_per_unit;
+  std::map<int, FPDiv*>::iterator it = shared_divs.find(unit);
+  if (it != shared_divs.end())
+    return it->second;
+
+  UnitLanes* lanes = new UnitLanes("FPDIV", latency, issue_width, div_lanes, unit);
+  unit_lanes.push_back(lanes);
+  FPDiv* fp_div = new FPDiv(latency, issue_width, lanes);
+  if (div_lanes.tms_per_unit > 1)
+    shared_divs[unit] = fp_div;
+  return fp_div;
+}
+
+FPInvSqrt* ReadConfig::InvSqrtUnit(int latency, int issue_width)
+{
+  if (!invsqrt_lanes.enabled)
+    return new FPInvSqrt(latency, issue_width);
+
+  int unit = (int)current_core->core_id / invsqrt_lanes.tms_per_unit * invsqrt_lanes.tms_per_unit;
+  std::map<int, FPInvSqrt*>::iterator it = shared_invsqrts.find(unit);
+  if (it != shared_invsqrts.end())
+    return it->second;
+
+  UnitLanes* lanes = new UnitLanes("FPINVSQRT", latency, issue_width, invsqrt_lanes, unit);
+  unit_lanes.push_back(lanes);
+  FPInvSqrt* fp_invsqrt = new FPInvSqrt(latency, issue_width, lanes);
+  if (invsqrt_lanes.tms_per_unit > 1)
+    shared_invsqrts[unit] = fp_invsqrt;
+  return fp_invsqrt;
+}
+
+bool ReadConfig::JoinPools(const std::string& unit_string, const SharedUnitParams& params)
+{
+  int first_tm = (int)current_core->core_id / params.tms_per_pool * params.tms_per_pool;
+  std::map<int, PoolGroup>& groups = pool_groups[unit_string];
+  std::map<int, PoolGroup>::iterator it = groups.find(first_tm);
+  if (it == groups.end())
+    return false;
+
+  for (size_t i = 0; i < it->second.pools.size(); i++) {
+    current_core->modules.push_back(it->second.pools[i]);
+    current_core->functional_units.push_back(it->second.pools[i]);
+    current_core->module_names.push_back(it->second.names[i]);
+  }
+  return true;
+}
+
+void ReadConfig::MakePools(const std::string& unit_string, const SharedUnitParams& params,
+			   size_t first_unit, int issue_width)
+{
+  std::vector<FunctionalUnit*>& units = current_core->functional_units;
+  std::vector<HardwareModule*>& modules = current_core->modules;
+  std::vector<std::string>& names = current_core->module_names;
+  int first_tm = (int)current_core->core_id / params.tms_per_pool * params.tms_per_pool;
+  PoolGroup& group = pool_groups[unit_string][first_tm];
+
+  size_t num_units = units.size() - first_unit;
+  for (size_t i = first_unit; i < units.size(); i++) {
+    FunctionalUnit* unit = units[i];
+    const char* name = unit_string.c_str();
+    if (dynamic_cast<FPDiv*>(unit))
+      name = "FPDIV";
+    else if (dynamic_cast<FPInvSqrt*>(unit))
+      name = "FPINVSQRT";
+    SharedUnitPool* pool = new SharedUnitPool(name, unit, issue_width, params, first_tm);
+
+    // the pool takes the unit's place
+    units[i] = pool;
+    for (size_t j = 0; j < modules.size(); j++)
+      if (modules[j] == unit)
+	modules[j] = pool;
+    group.pools.push_back(pool);
+    group.names.push_back(names[names.size() - num_units + (i - first_unit)]);
+    unit_pools.push_back(pool);
+  }
+}
+
 
 int ReadCacheParams(const char* file, int capacityBytes, int numBanks, int lineSizeBytes, float& area, float& energy, bool is_data_cache)
 {
@@ -416,3 +800,67 @@ int ReadCacheParams(const char* file, int capacityBytes, int numBanks, int lineS
   energy = 0;
   return 0;
 }
+
+// how many times bigger or smaller a is than b, in powers of 2
+static double SizeDistance(int a, int b)
+{
+  return fabs(log((double)a / b) / log(2.));
+}
+
+int ReadNearestCacheParams(const char* file, int capacityBytes, int numBanks, int lineSizeBytes, float& area, float& energy,
+			   int& rowCapacity, int& rowBanks, int& rowLineSize)
+{
+  area = 0;
+  energy = 0;
+  rowCapacity = 0;
+  rowBanks = 0;
+  rowLineSize = 0;
+  if (capacityBytes <= 0 || numBanks <= 0 || lineSizeBytes <= 0)
+    return 0;
+  FILE* input = fopen(file, "r");
+  if(!input)
+    return 0;
+
+  // closest capacity first, then banks, then line size
+  double best[3] = {0, 0, 0};
+  char line[1000];
+  while(fgets(line, 1000, input))
+    {
+      int capacity = 0;
+      int banks = 0;
+      int linesize = 0;
+      float a = 0;
+      float e = 0;
+      if (sscanf(line, "%d\t%d\t%d\t%f\t%f", &capacity, &banks, &linesize, &a, &e) != 5 ||
+	  capacity <= 0 || banks <= 0 || linesize <= 0)
+	continue;
+
+      double distance[3] = {SizeDistance(capacity, capacityBytes), SizeDistance(banks, numBanks),
+			    SizeDistance(linesize, lineSizeBytes)};
+      bool closer = rowCapacity == 0;
+      for (int i = 0; i < 3 && rowCapacity != 0; i++)
+	{
+	  if (distance[i] != best[i])
+	    {
+	      closer = distance[i] < best[i];
+	      break;
+	    }
+	}
+      if (!closer)
+	continue;
+      for (int i = 0; i < 3; i++)
+	best[i] = distance[i];
+      rowCapacity = capacity;
+      rowBanks = banks;
+      rowLineSize = linesize;
+      area = a;
+      energy = e;
+    }
+  fclose(input);
+  if (rowCapacity == 0)
+    return 0;
+
+  // the storage arrays dominate the area, energy per access is kept
+  area *= (float)capacityBytes / rowCapacity;
+  return 1;
+}
@@ -1,14 +1,22 @@
 #ifndef __SIMHWRT_READ_CONFIG_H__
 #define __SIMHWRT_READ_CONFIG_H__
 
+#include <map>
 #include <vector>
 #include <string>
+#include "GlobalRegisterFile.h"
+#include "RandomGenerator.h"
+#include "SharedUnitPool.h"
+#include "UnitLanes.h"
 
 class HardwareModule;
 class FunctionalUnit;
 class TraxCore;
 class L2Cache;
 class MainMemory;
+class StreamMemory;
+class FPDiv;
+class FPInvSqrt;
 
 class ReadConfig {
 public:
@@ -25,8 +33,53 @@ public:
   TraxCore* current_core;
   bool memory_trace;
   bool l1_off, l2_off, l1_read_copy;
+  // chip-wide, NULL without a STREAM line
+  StreamMemory* stream_memory;
+  // the GLOBALS line, for main's GlobalRegisterFile
+  GlobalRegisterParams global_params;
+  // the WORKQUEUE line, for main's GlobalRegisterFile
+  WorkQueueParams work_queue;
+  // the SYNCWAKE line, for main's GlobalRegisterFile
+  SyncWakeParams sync_wake;
+  // the RNG line, for every TM's FPADD unit
+  RandParams rand_params;
+  // INTERVAL lines, and the lanes of every unit they apply to
+  UnitLaneParams div_lanes;
+  UnitLaneParams invsqrt_lanes;
+  std::vector<UnitLanes*> unit_lanes;
+  // SHARE lines by unit name, and every pool they made
+  std::map<std::string, SharedUnitParams> shared_units;
+  std::vector<SharedUnitPool*> unit_pools;
+
+private:
+  // The current core's units, shared with other TMs when an INTERVAL line says so
+  FPDiv* DivUnit(int latency, int issue_width);
+  FPInvSqrt* InvSqrtUnit(int latency, int issue_width);
+  // Give the current core its TM group's pools of a shared unit, false if
+  // they haven't been made yet
+  bool JoinPools(const std::string& unit_string, const SharedUnitParams& params);
+  // Put the current core's units from first_unit on in pools for its TM group
+  void MakePools(const std::string& unit_string, const SharedUnitParams& params,
+		 size_t first_unit, int issue_width);
+
+  // the pools of a TM group, and their module names
+  struct PoolGroup {
+    std::vector<SharedUnitPool*> pools;
+    std::vector<std::string> names;
+  };
+
+  // the shared units, by the first TM using them
+  std::map<int, FPDiv*> shared_divs;
+  std::map<int, FPInvSqrt*> shared_invsqrts;
+  // by unit name and the first TM in the group
+  std::map<std::string, std::map<int, PoolGroup> > pool_groups;
 };
 
 int ReadCacheParams(const char* file, int capacityBytes, int numBanks, int lineSizeBytes, float& area, float& energy, bool is_data_cache);
+// For caches with no entry of their own: the area and energy of the entry
+// closest in capacity, then banks, then line size (returned in row*), with
+// the area scaled to capacityBytes. Returns 0 if the file has no entries.
+int ReadNearestCacheParams(const char* file, int capacityBytes, int numBanks, int lineSizeBytes, float& area, float& energy,
+			   int& rowCapacity, int& rowBanks, int& rowLineSize);
 
 #endif // __SIMHWRT_READ_CONFIG_H__
@@ -0,0 +1,124 @@
+#include "RegisterBanks.h"
+#include "Instruction.h"
+#include "SimpleRegisterFile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+RegisterBanks::RegisterBanks(const RegisterBankParams& params) :
+  num_banks(params.num_banks), read_ports(params.read_ports),
+  write_ports(params.write_ports), energy(params.energy)
+{
+  if (num_banks < 1 || read_ports < 1 || write_ports < 1) {
+    printf("ERROR: RFBANKS needs at least 1 bank with 1 read and 1 write port (%d banks, %d read, %d write)\n",
+	   num_banks, read_ports, write_ports);
+    exit(1);
+  }
+  if (energy <= 0)
+    energy = RF_ENERGY;
+
+  write_cycle = new long long int[num_banks];
+  writes_in_cycle = new int[num_banks];
+  busy_until = new long long int[num_banks];
+  bank_reads = new int[num_banks];
+  Reset();
+}
+
+RegisterBanks::~RegisterBanks()
+{
+  delete [] write_cycle;
+  delete [] writes_in_cycle;
+  delete [] busy_until;
+  delete [] bank_reads;
+}
+
+void RegisterBanks::Reset()
+{
+  collecting = NULL;
+  collecting_thread = NULL;
+  collect_done = 0;
+  for (int i = 0; i < num_banks; i++) {
+    write_cycle[i] = -1;
+    writes_in_cycle[i] = 0;
+    busy_until[i] = -1;
+  }
+  reads = 0;
+  writes = 0;
+  read_conflict_cycles = 0;
+  write_conflicts = 0;
+}
+
+void RegisterBanks::AddStats(RegisterBanks* other)
+{
+  reads += other->reads;
+  writes += other->writes;
+  read_conflict_cycles += other->read_conflict_cycles;
+  write_conflicts += other->write_conflicts;
+}
+
+bool RegisterBanks::Collect(const Instruction* ins, const ThreadState* thread, long long int cycle)
+{
+  if (ins != collecting || thread != collecting_thread) {
+    collecting = ins;
+    collecting_thread = thread;
+    collect_done = cycle;
+
+    // ops without a decoded source list (SPHERE_TEST) read in one cycle
+    for (int i = 0; i < num_banks; i++)
+      bank_reads[i] = 0;
+    for (int i = 0; i < ins->num_source_regs; i++) {
+      // a register named twice is read once
+      bool repeat = false;
+      for (int j = 0; j < i; j++)
+	if (ins->source_regs[j] == ins->source_regs[i])
+	  repeat = true;
+      if (repeat)
+	continue;
+      bank_reads[ins->source_regs[i] % num_banks]++;
+      reads++;
+    }
+
+    for (int i = 0; i < num_banks; i++) {
+      if (bank_reads[i] == 0)
+	continue;
+      long long int start = cycle;
+      if (busy_until[i] >= start)
+	start = busy_until[i] + 1;
+      long long int done = start + (bank_reads[i] + read_ports - 1) / read_ports - 1;
+      if (done > collect_done)
+	collect_done = done;
+    }
+  }
+
+  if (cycle < collect_done) {
+    read_conflict_cycles++;
+    return false;
+  }
+  return true;
+}
+
+void RegisterBanks::Issued()
+{
+  collecting = NULL;
+  collecting_thread = NULL;
+}
+
+void RegisterBanks::Write(int reg, long long int cycle)
+{
+  int bank = reg % num_banks;
+  writes++;
+  if (write_cycle[bank] < cycle) {
+    write_cycle[bank] = cycle;
+    writes_in_cycle[bank] = 0;
+  }
+  // the cycle's ports are taken, spill into the next
+  if (writes_in_cycle[bank] == write_ports) {
+    write_cycle[bank]++;
+    writes_in_cycle[bank] = 0;
+  }
+  writes_in_cycle[bank]++;
+  if (write_cycle[bank] > cycle) {
+    write_conflicts++;
+    busy_until[bank] = write_cycle[bank];
+  }
+}
@@ -0,0 +1,80 @@
+#ifndef _SIMHWRT_REGISTER_BANKS_H_
+#define _SIMHWRT_REGISTER_BANKS_H_
+
+// A banked register file with an operand collector, one per thread
+// processor. Enabled by an RFBANKS line in the config file:
+//
+//   RFBANKS <banks> <read ports per bank> <write ports per bank> <energy per access nJ (optional)>
+//
+// Register r lives in bank r % banks. Once an instruction's operands are
+// ready, the collector reads them over as many cycles as the busiest bank
+// needs, and the instruction can't issue before they are all in. Results
+// are written back when they are ready; writes past a bank's write ports
+// spill into the following cycles, and reads from that bank wait until
+// the spilled writes are done.
+//
+// Without RFBANKS the register file reads every operand in one cycle, and
+// its energy is estimated as 3 accesses per instruction.
+
+class Instruction;
+class ThreadState;
+
+// RFBANKS config line parameters, stored on the TraxCore until the
+// IssueUnit is created
+struct RegisterBankParams {
+  bool enabled;
+  int num_banks;
+  int read_ports;
+  int write_ports;
+  float energy;        // nJ per bank access, <= 0 for the unbanked number
+
+  RegisterBankParams() :
+    enabled(false), num_banks(1), read_ports(1), write_ports(1), energy(0)
+  {}
+};
+
+class RegisterBanks {
+public:
+  RegisterBanks(const RegisterBankParams& params);
+  ~RegisterBanks();
+
+  // Gather ins's source operands for thread, true once they have all been
+  // read. Called every cycle the instruction tries to issue.
+  bool Collect(const Instruction* ins, const ThreadState* thread, long long int cycle);
+  // The collected instruction issued, the collector is free
+  void Issued();
+  // A result written back to reg on cycle
+  void Write(int reg, long long int cycle);
+
+  void Reset();
+  void AddStats(RegisterBanks* other);
+
+  int num_banks;
+  int read_ports;
+  int write_ports;
+  // nJ per access
+  float energy;
+
+  long long int reads;
+  long long int writes;
+  // cycles instructions waited in the collector past the first
+  long long int read_conflict_cycles;
+  // writes pushed to a later cycle
+  long long int write_conflicts;
+
+private:
+  // the instruction being collected and the cycle its last operand arrives
+  const Instruction* collecting;
+  const ThreadState* collecting_thread;
+  long long int collect_done;
+
+  // per bank: the cycle writes are going to and how many it has, and the
+  // last cycle a spilled write holds the bank
+  long long int* write_cycle;
+  int* writes_in_cycle;
+  long long int* busy_until;
+  // scratch for Collect()
+  int* bank_reads;
+};
+
+#endif // _SIMHWRT_REGISTER_BANKS_H_
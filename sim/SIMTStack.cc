@@ -0,0 +1,348 @@
+#include "SIMTStack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// How an instruction changes the program counter, following BranchUnit
+struct BranchInfo {
+  enum Kind {
+    NONE,
+    IMMEDIATE,  // the next instruction is the target
+    DELAYED     // the instruction after the delay slot is the target
+  };
+  Kind kind;
+  bool conditional;
+  bool call;
+  int target;   // -1 when it comes from a register
+};
+
+static BranchInfo Classify(const Instruction* ins)
+{
+  BranchInfo info;
+  info.kind = BranchInfo::DELAYED;
+  info.conditional = false;
+  info.call = false;
+  info.target = -1;
+
+  switch (ins->op) {
+    case Instruction::JMP:
+      info.kind = BranchInfo::IMMEDIATE;
+      info.target = ins->args[2];
+      break;
+    case Instruction::JAL:
+      info.kind = BranchInfo::IMMEDIATE;
+      info.call = true;
+      info.target = ins->args[2];
+      break;
+    case Instruction::BNZ:
+      info.kind = BranchInfo::IMMEDIATE;
+      info.conditional = true;
+      info.target = ins->args[2];
+      break;
+
+    case Instruction::beq:
+    case Instruction::bne:
+    case Instruction::BLT:
+    case Instruction::BET:
+      info.conditional = true;
+      info.target = ins->args[2];
+      break;
+    case Instruction::bgez:
+    case Instruction::beqz:
+    case Instruction::bnez:
+    case Instruction::bgtz:
+    case Instruction::blez:
+    case Instruction::bltz:
+    case Instruction::beqid:
+    case Instruction::bgeid:
+    case Instruction::bgtid:
+    case Instruction::bleid:
+    case Instruction::bltid:
+    case Instruction::bneid:
+      info.conditional = true;
+      info.target = ins->args[1];
+      break;
+    case Instruction::bc1f:
+    case Instruction::bc1t:
+      info.conditional = true;
+      info.target = ins->args[0];
+      break;
+    case Instruction::beqd:
+    case Instruction::bged:
+    case Instruction::bgtd:
+    case Instruction::bled:
+    case Instruction::bltd:
+    case Instruction::bned:
+      info.conditional = true;
+      break;
+
+    case Instruction::j:
+    case Instruction::brid:
+      info.target = ins->args[0];
+      break;
+    case Instruction::braid:
+      info.target = ins->args[1];
+      break;
+    case Instruction::JMPREG:
+    case Instruction::brad:
+    case Instruction::brk:
+    case Instruction::brd:
+    case Instruction::jr:
+    case Instruction::rtsd:
+      break;
+
+    case Instruction::jal:
+      info.call = true;
+      info.target = ins->args[0];
+      break;
+    case Instruction::bal:
+    case Instruction::brlid:
+    case Instruction::bralid:
+    case Instruction::brki:
+      info.call = true;
+      info.target = ins->args[1];
+      break;
+    case Instruction::brld:
+    case Instruction::brald:
+      info.call = true;
+      break;
+
+    default:
+      info.kind = BranchInfo::NONE;
+      break;
+  }
+  return info;
+}
+
+void ReconvergenceTable::Successors(const std::vector<Instruction*>& instructions, int pc,
+                                    std::vector<int>& successors)
+{
+  int exit_node = (int)instructions.size();
+  successors.clear();
+  if (instructions[pc]->op == Instruction::HALT) {
+    successors.push_back(exit_node);
+    return;
+  }
+
+  BranchInfo info = Classify(instructions[pc]);
+  if (info.kind == BranchInfo::DELAYED) {
+    // the delay slot runs first, it is where the paths split
+    successors.push_back(pc + 1);
+    return;
+  }
+  if (info.kind == BranchInfo::NONE && pc > 0) {
+    // a delay slot leads where its branch does
+    info = Classify(instructions[pc - 1]);
+    if (info.kind != BranchInfo::DELAYED)
+      info.kind = BranchInfo::NONE;
+  }
+
+  if (info.kind == BranchInfo::NONE || info.call) {
+    // calls come back after the delay slot
+    successors.push_back(pc + 1);
+  }
+  else {
+    if (info.target < 0 || info.target >= exit_node)
+      successors.push_back(exit_node);
+    else
+      successors.push_back(info.target);
+    if (info.conditional && info.target != pc + 1)
+      successors.push_back(pc + 1);
+  }
+
+  for (size_t i = 0; i < successors.size(); i++)
+    if (successors[i] > exit_node)
+      successors[i] = exit_node;
+}
+
+ReconvergenceTable::ReconvergenceTable(const std::vector<Instruction*>& instructions)
+{
+  int num_nodes = (int)instructions.size() + 1;
+  int exit_node = num_nodes - 1;
+
+  std::vector< std::vector<int> > successors(num_nodes);
+  std::vector< std::vector<int> > predecessors(num_nodes);
+  num_branches = 0;
+  for (int pc = 0; pc < exit_node; pc++) {
+    Successors(instructions, pc, successors[pc]);
+    for (size_t i = 0; i < successors[pc].size(); i++)
+      predecessors[successors[pc][i]].push_back(pc);
+    if (successors[pc].size() > 1)
+      num_branches++;
+  }
+
+  // Post-dominators are the dominators of the reversed CFG rooted at the
+  // exit (Cooper, Harvey and Kennedy's iterative algorithm). First number
+  // the nodes in postorder of a walk up the predecessors from the exit.
+  std::vector<int> postorder(num_nodes, -1);
+  std::vector<int> order;
+  std::vector<int> visit_stack;
+  std::vector<size_t> next_pred;
+  std::vector<bool> visited(num_nodes, false);
+  visit_stack.push_back(exit_node);
+  next_pred.push_back(0);
+  visited[exit_node] = true;
+  while (!visit_stack.empty()) {
+    int node = visit_stack.back();
+    if (next_pred.back() < predecessors[node].size()) {
+      int pred = predecessors[node][next_pred.back()++];
+      if (!visited[pred]) {
+        visited[pred] = true;
+        visit_stack.push_back(pred);
+        next_pred.push_back(0);
+      }
+      continue;
+    }
+    postorder[node] = (int)order.size();
+    order.push_back(node);
+    visit_stack.pop_back();
+    next_pred.pop_back();
+  }
+
+  std::vector<int> idom(num_nodes, -1);
+  idom[exit_node] = exit_node;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    // reverse postorder, skipping the exit
+    for (int k = (int)order.size() - 2; k >= 0; k--) {
+      int node = order[k];
+      int new_idom = -1;
+      for (size_t i = 0; i < successors[node].size(); i++) {
+        int succ = successors[node][i];
+        if (idom[succ] < 0)
+          continue;
+        if (new_idom < 0) {
+          new_idom = succ;
+          continue;
+        }
+        int a = succ, b = new_idom;
+        while (a != b) {
+          while (postorder[a] < postorder[b])
+            a = idom[a];
+          while (postorder[b] < postorder[a])
+            b = idom[b];
+        }
+        new_idom = a;
+      }
+      if (idom[node] != new_idom) {
+        idom[node] = new_idom;
+        changed = true;
+      }
+    }
+  }
+
+  // Instructions that can't reach HALT (infinite loops) never reconverge
+  ipdom.resize(exit_node);
+  num_reconverging = 0;
+  for (int pc = 0; pc < exit_node; pc++) {
+    ipdom[pc] = idom[pc] == exit_node ? -1 : idom[pc];
+    if (successors[pc].size() > 1 && ipdom[pc] >= 0)
+      num_reconverging++;
+  }
+}
+
+long long int ReconvergenceTable::ReconvergencePC(long long int pc) const
+{
+  if (pc < 0 || pc >= (long long int)ipdom.size())
+    return -1;
+  return ipdom[pc];
+}
+
+SIMTWarp::SIMTWarp()
+{
+  Reset(0);
+}
+
+void SIMTWarp::Reset(int width)
+{
+  stack.clear();
+  pending = 0;
+  halting = 0;
+  exited = 0;
+  fetched_pc = -1;
+  if (width > 0) {
+    // every thread starts at the first instruction
+    Entry start;
+    start.pc = 0;
+    start.reconverge_pc = -1;
+    start.mask = width == 64 ? ~0ULL : (1ULL << width) - 1;
+    stack.push_back(start);
+  }
+
+  instructions = 0;
+  active_lanes = 0;
+  divergences = 0;
+  max_depth = stack.size();
+}
+
+void SIMTWarp::Advance(long long int pc, const long long int* next_pc, const ReconvergenceTable* table)
+{
+  Entry& top = stack.back();
+  unsigned long long int running = top.mask & ~halting;
+
+  // group the lanes by where they go next
+  long long int group_pc[MAX_SIMT_WIDTH];
+  unsigned long long int group_mask[MAX_SIMT_WIDTH];
+  int num_groups = 0;
+  for (int lane = 0; lane < MAX_SIMT_WIDTH; lane++) {
+    if (!(running & (1ULL << lane)))
+      continue;
+    int group = 0;
+    while (group < num_groups && group_pc[group] != next_pc[lane])
+      group++;
+    if (group == num_groups) {
+      group_pc[group] = next_pc[lane];
+      group_mask[group] = 0;
+      num_groups++;
+    }
+    group_mask[group] |= 1ULL << lane;
+  }
+
+  if (num_groups == 1)
+    top.pc = group_pc[0];
+  else if (num_groups > 1) {
+    divergences++;
+    long long int reconverge_pc = table->ReconvergencePC(pc);
+    if (reconverge_pc < 0) {
+      // no meeting point below the enclosing one, the sides replace this entry
+      reconverge_pc = top.reconverge_pc;
+      stack.pop_back();
+    }
+    else
+      top.pc = reconverge_pc;
+
+    // push the highest pc first so the lowest runs first
+    for (int pushed = 0; pushed < num_groups; pushed++) {
+      int highest = -1;
+      for (int group = 0; group < num_groups; group++)
+        if (group_mask[group] != 0 && (highest < 0 || group_pc[group] > group_pc[highest]))
+          highest = group;
+      if (group_pc[highest] != reconverge_pc) {
+        Entry side;
+        side.pc = group_pc[highest];
+        side.reconverge_pc = reconverge_pc;
+        side.mask = group_mask[highest];
+        stack.push_back(side);
+      }
+      group_mask[highest] = 0;
+    }
+    if (stack.size() > max_depth)
+      max_depth = stack.size();
+  }
+
+  if (halting) {
+    exited |= halting;
+    for (size_t i = 0; i < stack.size(); i++)
+      stack[i].mask &= ~halting;
+    halting = 0;
+  }
+  Pop();
+}
+
+void SIMTWarp::Pop()
+{
+  while (!stack.empty() &&
+         (stack.back().mask == 0 || stack.back().pc == stack.back().reconverge_pc))
+    stack.pop_back();
+}
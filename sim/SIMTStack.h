@@ -0,0 +1,77 @@
+#ifndef _SIMHWRT_SIMT_STACK_H_
+#define _SIMHWRT_SIMT_STACK_H_
+
+// SIMT issue (--simt-width): the thread processors of a TM are grouped into
+// warps that fetch and issue one instruction for all their active lanes at
+// a time. When the lanes of a warp branch different ways, the warp runs
+// each side in turn with only those lanes active, and they all continue
+// together again at the branch's immediate post-dominator.
+//
+// The post-dominators come from the CFG of the assembled program. Calls
+// are assumed to return to the instruction after their delay slot, and
+// jumps through a register (returns, jump tables) to leave the CFG, so
+// lanes that diverge on one of those only rejoin at an enclosing
+// reconvergence point, or not at all.
+
+#include "Instruction.h"
+#include <vector>
+
+#define MAX_SIMT_WIDTH 64
+
+class ReconvergenceTable {
+public:
+  ReconvergenceTable(const std::vector<Instruction*>& instructions);
+
+  // Where lanes that leave pc on different paths meet again, -1 if they don't
+  long long int ReconvergencePC(long long int pc) const;
+
+  int num_branches;
+  int num_reconverging;
+
+private:
+  // Successors of pc in the CFG, exit is the node after the last instruction
+  void Successors(const std::vector<Instruction*>& instructions, int pc,
+                  std::vector<int>& successors);
+
+  std::vector<int> ipdom;
+};
+
+class SIMTWarp {
+public:
+  struct Entry {
+    long long int pc;
+    long long int reconverge_pc;
+    unsigned long long int mask;
+  };
+
+  SIMTWarp();
+
+  void Reset(int width);
+  bool Done() const { return stack.empty(); }
+  long long int PC() const { return stack.back().pc; }
+  unsigned long long int ActiveMask() const { return stack.back().mask; }
+
+  // Every active lane has issued the instruction at pc or stopped at HALT.
+  // next_pc[lane] is each lane's program counter now.
+  void Advance(long long int pc, const long long int* next_pc, const ReconvergenceTable* table);
+
+  // the reconvergence stack, the top is the entry executing
+  std::vector<Entry> stack;
+  // active lanes that haven't issued the instruction fetched for them yet
+  unsigned long long int pending;
+  // lanes that stopped at HALT on this instruction, and on earlier ones
+  unsigned long long int halting;
+  unsigned long long int exited;
+  long long int fetched_pc;
+
+  long long int instructions;
+  long long int active_lanes;
+  long long int divergences;
+  size_t max_depth;
+
+private:
+  // Drop finished entries and the ones that reached their reconvergence point
+  void Pop();
+};
+
+#endif // _SIMHWRT_SIMT_STACK_H_
@@ -0,0 +1,192 @@
+#include "SharedUnitPool.h"
+#include "IssueUnit.h"
+#include "ThreadState.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+extern pthread_mutex_t global_mutex;
+
+// a TM that hasn't asked or been granted
+#define NO_CYCLE -2
+
+SharedUnitPool::SharedUnitPool(const char* _name, FunctionalUnit* _unit, int _width,
+                               const SharedUnitParams& params, int _first_tm) :
+  FunctionalUnit(_unit->GetLatency()), name(_name), unit(_unit), width(_width),
+  tms_per_pool(params.tms_per_pool), arbitration(params.arbitration), first_tm(_first_tm)
+{
+  if (width < 1 || tms_per_pool < 1) {
+    printf("ERROR: SHARE %s needs a width of at least 1 and at least 1 TM per pool (%d, %d)\n",
+           name.c_str(), width, tms_per_pool);
+    exit(1);
+  }
+  stalls = new long long int[tms_per_pool];
+  tm_ops = new long long int[tms_per_pool];
+  grant_cycle = new long long int[tms_per_pool];
+  request_cycle = new long long int[tms_per_pool];
+  request_since = new long long int[tms_per_pool];
+  area = unit->area;
+  energy = unit->energy;
+  Reset();
+}
+
+SharedUnitPool::~SharedUnitPool()
+{
+  delete [] stalls;
+  delete [] tm_ops;
+  delete [] grant_cycle;
+  delete [] request_cycle;
+  delete [] request_since;
+}
+
+void SharedUnitPool::Reset()
+{
+  current_cycle = -1;
+  next_tm = 0;
+  ops = 0;
+  grants = 0;
+  for (int i = 0; i < tms_per_pool; i++) {
+    stalls[i] = 0;
+    tm_ops[i] = 0;
+    grant_cycle[i] = NO_CYCLE;
+    request_cycle[i] = NO_CYCLE;
+    request_since[i] = NO_CYCLE;
+  }
+}
+
+bool SharedUnitPool::SupportsOp(Instruction::Opcode op) const
+{
+  return unit->SupportsOp(op);
+}
+
+void SharedUnitPool::Arbitrate(long long int cycle)
+{
+  int granted = 0;
+  if (arbitration == SharedUnitParams::ROUND_ROBIN) {
+    int last = -1;
+    for (int i = 0; i < tms_per_pool && granted < width; i++) {
+      int tm = (next_tm + i) % tms_per_pool;
+      if (request_cycle[tm] != cycle - 1)
+        continue;
+      grant_cycle[tm] = cycle;
+      request_cycle[tm] = NO_CYCLE;
+      granted++;
+      last = tm;
+    }
+    if (last >= 0)
+      next_tm = (last + 1) % tms_per_pool;
+  }
+  else {
+    while (granted < width) {
+      int oldest = -1;
+      for (int tm = 0; tm < tms_per_pool; tm++)
+        if (request_cycle[tm] == cycle - 1 &&
+            (oldest < 0 || request_since[tm] < request_since[oldest]))
+          oldest = tm;
+      if (oldest < 0)
+        break;
+      grant_cycle[oldest] = cycle;
+      request_cycle[oldest] = NO_CYCLE;
+      granted++;
+    }
+  }
+  grants += granted;
+}
+
+bool SharedUnitPool::AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState* thread)
+{
+  long long int cycle = issuer->current_cycle;
+  int tm = (int)thread->core_id - first_tm;
+
+  pthread_mutex_lock(&global_mutex);
+  if (cycle > current_cycle) {
+    // the first TM here this cycle clocks the unit for all of them
+    current_cycle = cycle;
+    unit->ClockRise();
+    Arbitrate(cycle);
+  }
+
+  if (grant_cycle[tm] != cycle) {
+    // ask for next cycle
+    if (request_cycle[tm] != cycle && request_cycle[tm] != cycle - 1)
+      request_since[tm] = cycle;
+    request_cycle[tm] = cycle;
+    stalls[tm]++;
+    issuer->arbitration_stalls++;
+    pthread_mutex_unlock(&global_mutex);
+    return false;
+  }
+
+  bool accepted = unit->AcceptInstruction(ins, issuer, thread);
+  if (accepted) {
+    // one op per grant
+    grant_cycle[tm] = NO_CYCLE;
+    ops++;
+    tm_ops[tm]++;
+  }
+  pthread_mutex_unlock(&global_mutex);
+  return accepted;
+}
+
+// From HardwareModule
+void SharedUnitPool::ClockRise()
+{
+  // every TM sharing the pool clocks it, so the unit is clocked on the
+  // first access of each cycle instead
+}
+
+void SharedUnitPool::ClockFall()
+{
+}
+
+void SharedUnitPool::print()
+{
+  printf("%s shared by TMs %d-%d", name.c_str(), first_tm, first_tm + tms_per_pool - 1);
+}
+
+void SharedUnitPool::PrintStats(long long int cycles)
+{
+  long long int total_stalls = 0;
+  for (int i = 0; i < tms_per_pool; i++)
+    total_stalls += stalls[i];
+  printf("   TMs %d-%d: %lld ops (%.2f%% of issue slots), %lld grants (%.2f%% used), %lld stall thread*cycles\n",
+         first_tm, first_tm + tms_per_pool - 1, ops, cycles > 0 ? 100. * ops / (cycles * width) : 0.,
+         grants, grants > 0 ? 100. * ops / grants : 0., total_stalls);
+  printf("     ops/stalls per TM:");
+  for (int i = 0; i < tms_per_pool; i++)
+    printf(" %lld/%lld", tm_ops[i], stalls[i]);
+  printf("\n");
+}
+
+void SharedUnitPool::PrintAll(const std::vector<SharedUnitPool*>& pools, long long int cycles)
+{
+  std::vector<bool> printed(pools.size(), false);
+  for (size_t n = 0; n < pools.size(); n++) {
+    if (printed[n])
+      continue;
+
+    SharedUnitPool* first = pools[n];
+    long long int ops = 0, grants = 0, total_stalls = 0;
+    int num_pools = 0;
+    for (size_t i = n; i < pools.size(); i++) {
+      if (pools[i]->name != first->name)
+        continue;
+      ops += pools[i]->ops;
+      grants += pools[i]->grants;
+      for (int j = 0; j < pools[i]->tms_per_pool; j++)
+        total_stalls += pools[i]->stalls[j];
+      num_pools++;
+      printed[i] = true;
+    }
+
+    printf(" %s: %d pool(s) x %d wide, %d TM(s) per pool, %s arbitration\n", first->name.c_str(), num_pools,
+           first->width, first->tms_per_pool,
+           first->arbitration == SharedUnitParams::AGE ? "oldest first" : "round robin");
+    printf("   total: %lld ops, %lld grants, %lld stall thread*cycles (%.2f per op)\n", ops, grants,
+           total_stalls, ops > 0 ? static_cast<double>(total_stalls) / ops : 0.);
+    for (size_t i = n; i < pools.size(); i++)
+      if (pools[i]->name == first->name)
+        pools[i]->PrintStats(cycles);
+  }
+}
@@ -0,0 +1,93 @@
+#ifndef _SIMHWRT_SHARED_UNIT_POOL_H_
+#define _SIMHWRT_SHARED_UNIT_POOL_H_
+
+// A functional unit shared by a group of TMs, set up by a SHARE line in
+// the config file:
+//
+//   SHARE <unit> <TMs per pool> <ROUNDROBIN | AGE (optional)>
+//
+// <unit> is the name of a simple unit line (FPADD, FPMUL, FPINV, INTMUL,
+// ...); FPINV shares both the divide and inverse sqrt units. TMs 0 to n-1
+// share one instance of the unit, n to 2n-1 the next one, and so on.
+//
+// A TM has to be granted the unit before one of its threads can issue to
+// it. A thread without a grant raises its TM's request and stalls; at the
+// start of the next cycle the arbiter grants up to <issue width> of the
+// TMs that requested, one op each, either round robin from the TM after
+// the last one granted or oldest request first (ties to the lowest TM).
+// A grant that isn't used in its cycle is lost. The grants for a cycle
+// only depend on the requests of the cycle before, so unlike the first
+// come, first served sharing of an INTERVAL line (see UnitLanes.h), which
+// TM wins doesn't depend on the order the TMs are simulated in. A unit
+// can't be shared both ways.
+
+#include "FunctionalUnit.h"
+#include <string>
+#include <vector>
+
+// SHARE config line parameters for a unit type
+struct SharedUnitParams {
+  enum Arbitration {
+    ROUND_ROBIN,
+    AGE
+  };
+
+  int tms_per_pool;
+  Arbitration arbitration;
+
+  SharedUnitParams() :
+    tms_per_pool(1), arbitration(ROUND_ROBIN)
+  {}
+};
+
+class SharedUnitPool : public FunctionalUnit {
+ public:
+  // first_tm is the first of the TMs sharing unit
+  SharedUnitPool(const char* name, FunctionalUnit* unit, int width,
+                 const SharedUnitParams& params, int first_tm);
+  ~SharedUnitPool();
+
+  // From FunctionalUnit
+  virtual bool SupportsOp(Instruction::Opcode op) const;
+  virtual bool AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState* thread);
+
+  // From HardwareModule
+  virtual void ClockRise();
+  virtual void ClockFall();
+  virtual void print();
+
+  void Reset();
+  // cycles is the length of the run
+  void PrintStats(long long int cycles);
+
+  // Per unit type: the totals, and each pool on its own
+  static void PrintAll(const std::vector<SharedUnitPool*>& pools, long long int cycles);
+
+  std::string name;
+  FunctionalUnit* unit;
+  int width;
+  int tms_per_pool;
+  SharedUnitParams::Arbitration arbitration;
+  int first_tm;
+
+  long long int ops;
+  long long int grants;
+  // thread*cycles refused for want of a grant, per TM in the pool
+  long long int* stalls;
+  long long int* tm_ops;
+
+ private:
+  // Grant the requests from the cycle before cycle
+  void Arbitrate(long long int cycle);
+
+  long long int current_cycle;
+  // per TM: the cycle it was last granted, the cycle it last asked and the
+  // first of the cycles it has asked in a row
+  long long int* grant_cycle;
+  long long int* request_cycle;
+  long long int* request_since;
+  // round robin starts from this TM
+  int next_tm;
+};
+
+#endif // _SIMHWRT_SHARED_UNIT_POOL_H_
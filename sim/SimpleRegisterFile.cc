@@ -518,6 +518,12 @@ void SimpleRegisterFile::ClockFall()
   current_cycle++;
 }
 
+void SimpleRegisterFile::SkipCycles(long long int num_cycles)
+{
+  issued_this_cycle = 0;
+  current_cycle += num_cycles;
+}
+
 void SimpleRegisterFile::print()
 {
   // print 8 regs per line?
@@ -50,6 +50,7 @@ class SimpleRegisterFile : public FunctionalUnit {
   virtual void ClockRise();
   virtual void ClockFall();
   virtual void print();
+  virtual void SkipCycles(long long int num_cycles);
 
   // for register trace
   DiskBuffer<RegisterTrace, unsigned> *buffer;
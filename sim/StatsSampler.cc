@@ -0,0 +1,184 @@
+#include "StatsSampler.h"
+#include "IssueUnit.h"
+#include "L1Cache.h"
+#include "L2Cache.h"
+#include "ThreadProcessor.h"
+#include "TraxCore.h"
+#include "memory_controller.h"
+#include "params.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+StatsSampler::StatsSampler(const char* filename, long long int _period, const char* counters,
+			   std::vector<TraxCore*>* _cores, L2Cache** _L2s, int _num_L2s,
+			   bool _disable_usimm)
+  :period(_period), cores(_cores), L2s(_L2s), num_L2s(_num_L2s), disable_usimm(_disable_usimm)
+{
+  sample_issue = false;
+  sample_cache = false;
+  sample_dram = false;
+  sample_threads = false;
+
+  // parse the comma separated counter groups
+  char* list = strdup(counters);
+  for(char* group = strtok(list, ","); group != NULL; group = strtok(NULL, ",")) {
+    if(strcmp(group, "all") == 0)
+      sample_issue = sample_cache = sample_dram = sample_threads = true;
+    else if(strcmp(group, "issue") == 0)
+      sample_issue = true;
+    else if(strcmp(group, "cache") == 0)
+      sample_cache = true;
+    else if(strcmp(group, "dram") == 0)
+      sample_dram = true;
+    else if(strcmp(group, "threads") == 0)
+      sample_threads = true;
+    else {
+      printf("ERROR: unknown stats sample counter group \"%s\" (expected issue, cache, dram, threads or all)\n", group);
+      exit(1);
+    }
+  }
+  free(list);
+
+  if(period <= 0) {
+    printf("ERROR: stats sample period must be positive\n");
+    exit(1);
+  }
+
+  output = fopen(filename, "w");
+  if(output == NULL) {
+    printf("ERROR: cannot open stats sample file %s\n", filename);
+    exit(1);
+  }
+
+  cycle_num = 0;
+  last_sample_cycle = 0;
+  cycles_until_sample = period;
+
+  last_issued = new long long int[cores->size()];
+  for(size_t i = 0; i < cores->size(); i++)
+    last_issued[i] = 0;
+  last_L1_hits = last_L1_accesses = 0;
+  last_L2_hits = last_L2_accesses = 0;
+  last_dram_lines = 0;
+
+  WriteHeader();
+}
+
+StatsSampler::~StatsSampler()
+{
+  if(output)
+    fclose(output);
+  delete[] last_issued;
+}
+
+void StatsSampler::WriteHeader()
+{
+  fprintf(output, "# simtrax stats samples, period %lld cycles\n", period);
+  fprintf(output, "cycle");
+  if(sample_issue)
+    for(size_t i = 0; i < cores->size(); i++)
+      fprintf(output, " issue_tm%d", (int)i);
+  if(sample_cache)
+    fprintf(output, " l1_hit l2_hit");
+  if(sample_dram)
+    fprintf(output, " dram_gbps dram_rq dram_wq");
+  if(sample_threads)
+    fprintf(output, " threads");
+  fprintf(output, "\n");
+}
+
+void StatsSampler::Sample()
+{
+  cycles_until_sample = period;
+  long long int window = cycle_num - last_sample_cycle;
+  if(window <= 0)
+    return;
+  last_sample_cycle = cycle_num;
+
+  fprintf(output, "%lld", cycle_num);
+
+  if(sample_issue) {
+    for(size_t i = 0; i < cores->size(); i++) {
+      IssueUnit* issuer = (*cores)[i]->issuer;
+      long long int issued = issuer->instructions_issued;
+      fprintf(output, " %.4f", (issued - last_issued[i]) / (double)(window * issuer->thread_procs.size()));
+      last_issued[i] = issued;
+    }
+  }
+
+  if(sample_cache) {
+    long long int L1_hits = 0, L1_accesses = 0;
+    for(size_t i = 0; i < cores->size(); i++) {
+      L1_hits += (*cores)[i]->L1->hits;
+      L1_accesses += (*cores)[i]->L1->accesses;
+    }
+    long long int L2_hits = 0, L2_accesses = 0;
+    for(int i = 0; i < num_L2s; i++) {
+      L2_hits += L2s[i]->hits;
+      L2_accesses += L2s[i]->accesses;
+    }
+    long long int L1_window = L1_accesses - last_L1_accesses;
+    long long int L2_window = L2_accesses - last_L2_accesses;
+    fprintf(output, " %.4f %.4f",
+	    L1_window > 0 ? (L1_hits - last_L1_hits) / (double)L1_window : 0.0,
+	    L2_window > 0 ? (L2_hits - last_L2_hits) / (double)L2_window : 0.0);
+    last_L1_hits = L1_hits;
+    last_L1_accesses = L1_accesses;
+    last_L2_hits = L2_hits;
+    last_L2_accesses = L2_accesses;
+  }
+
+  if(sample_dram) {
+    // Same accounting as the end-of-run "memory to L2 bandwidth"
+    long long int dram_lines = 0;
+    long long int read_queue = 0, write_queue = 0;
+    if(disable_usimm) {
+      for(int i = 0; i < num_L2s; i++)
+	dram_lines += L2s[i]->misses;
+    }
+    else {
+      for(int c = 0; c < NUM_CHANNELS; c++) {
+	dram_lines += stats_reads_completed[c];
+	read_queue += read_queue_length[c];
+	write_queue += write_queue_length[c];
+      }
+    }
+    int L2_line_size = (int)pow(2.f, static_cast<float>(L2s[0]->line_size));
+    double bandwidth = (dram_lines - last_dram_lines) * L2_line_size * 4 / (double)window;
+    fprintf(output, " %.4f %lld %lld", bandwidth, read_queue, write_queue);
+    last_dram_lines = dram_lines;
+  }
+
+  if(sample_threads) {
+    int active = 0;
+    for(size_t i = 0; i < cores->size(); i++) {
+      IssueUnit* issuer = (*cores)[i]->issuer;
+      if(issuer->halted)
+	continue;
+      // every hardware thread, not just the one each processor has scheduled
+      for(size_t j = 0; j < issuer->thread_procs.size(); j++) {
+	ThreadProcessor* tp = issuer->thread_procs[j];
+	for(size_t k = 0; k < tp->thread_states.size(); k++) {
+	  Instruction* fetched = tp->thread_states[k]->fetched_instruction;
+	  if(fetched == NULL || fetched->op != Instruction::HALT)
+	    active++;
+	}
+      }
+    }
+    fprintf(output, " %d", active);
+  }
+
+  fprintf(output, "\n");
+}
+
+void StatsSampler::Finish()
+{
+  if(output == NULL)
+    return;
+  if(cycle_num > last_sample_cycle)
+    Sample();
+  fclose(output);
+  output = NULL;
+}
@@ -0,0 +1,69 @@
+#ifndef _SIMHWRT_STATS_SAMPLER_H_
+#define _SIMHWRT_STATS_SAMPLER_H_
+
+// Periodically snapshots a set of machine-wide counters and writes them
+// as one row per sample period to a whitespace separated column file.
+// This gives a time series of the simulation (ray phases, DRAM saturation
+// windows, etc) rather than just the end-of-run totals.
+//
+// Counters are selected with a comma separated list of groups:
+//   issue   - issue rate for each TM
+//   cache   - L1 (all TMs) and L2 (all L2s) hit rates
+//   dram    - DRAM bandwidth (GB/s at 1GHz) and read/write queue occupancy
+//   threads - number of hardware threads that have not halted
+//
+// All rates are computed over the sample window, not since the start of time.
+
+#include <stdio.h>
+#include <vector>
+
+class TraxCore;
+class L2Cache;
+
+class StatsSampler {
+public:
+  StatsSampler(const char* filename, long long int _period, const char* counters,
+	       std::vector<TraxCore*>* _cores, L2Cache** _L2s, int _num_L2s,
+	       bool _disable_usimm);
+  ~StatsSampler();
+
+  // Called once per simulated cycle after all TMs and L2s have been clocked.
+  // Only does real work on sample boundaries.
+  void Tick()
+  {
+    cycle_num++;
+    if(--cycles_until_sample == 0)
+      Sample();
+  }
+
+  // Writes out the last (partial) sample window and closes the file
+  void Finish();
+
+  bool sample_issue;
+  bool sample_cache;
+  bool sample_dram;
+  bool sample_threads;
+
+private:
+  void Sample();
+  void WriteHeader();
+
+  FILE* output;
+  long long int period;
+  long long int cycles_until_sample;
+  long long int cycle_num;
+  long long int last_sample_cycle;
+
+  std::vector<TraxCore*>* cores;
+  L2Cache** L2s;
+  int num_L2s;
+  bool disable_usimm;
+
+  // counter values at the previous sample
+  long long int* last_issued;
+  long long int last_L1_hits, last_L1_accesses;
+  long long int last_L2_hits, last_L2_accesses;
+  long long int last_dram_lines;
+};
+
+#endif // _SIMHWRT_STATS_SAMPLER_H_
@@ -0,0 +1,324 @@
+#include "StreamMemory.h"
+#include "IssueUnit.h"
+#include "ThreadState.h"
+#include "WriteRequest.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+extern pthread_mutex_t global_mutex;
+
+StreamMemory::StreamMemory(int _latency, int _capacity, int _num_banks, int _dram_latency, int _burst_words) :
+  FunctionalUnit(_latency), capacity(_capacity), num_banks(_num_banks),
+  dram_latency(_dram_latency), burst_words(_burst_words), access_energy(0)
+{
+  if (latency < 1 || capacity < 0 || num_banks < 1 || dram_latency < 0 || burst_words < 1) {
+    printf("ERROR: STREAM needs a latency of at least 1, at least 1 bank and a DRAM burst of at least 1 word (%d, %d, %d)\n",
+           latency, num_banks, burst_words);
+    exit(1);
+  }
+  bank_cycle = new long long int[num_banks];
+  Reset();
+}
+
+StreamMemory::~StreamMemory()
+{
+  Clear();
+  delete [] bank_cycle;
+}
+
+void StreamMemory::Clear()
+{
+  for (std::map<int, std::deque<Record*> >::iterator it = streams.begin(); it != streams.end(); ++it)
+    for (size_t i = 0; i < it->second.size(); i++)
+      delete it->second[i];
+  streams.clear();
+  for (std::map<ThreadState*, Cursor>::iterator it = cursors.begin(); it != cursors.end(); ++it) {
+    delete it->second.writing;
+    delete it->second.reading;
+  }
+  cursors.clear();
+}
+
+void StreamMemory::Reset()
+{
+  Clear();
+  for (int i = 0; i < num_banks; i++)
+    bank_cycle[i] = -1;
+  next_record_id = 0;
+  occupancy = 0;
+  occupancy_cycle = 0;
+  dram_free_cycle = 0;
+
+  records_written = 0;
+  records_read = 0;
+  words_written = 0;
+  words_read = 0;
+  occupancy_cycles = 0;
+  max_occupancy = 0;
+  spilled_records = 0;
+  dram_bytes_written = 0;
+  dram_bytes_read = 0;
+  bank_stalls = 0;
+  dram_stall_cycles = 0;
+}
+
+bool StreamMemory::SupportsOp(Instruction::Opcode op) const
+{
+  if (op == Instruction::STARTSW ||
+      op == Instruction::STREAMW ||
+      op == Instruction::ENDSW ||
+      op == Instruction::STARTSR ||
+      op == Instruction::STREAMR ||
+      op == Instruction::ENDSR ||
+      op == Instruction::STRSIZE ||
+      op == Instruction::STRSCHED ||
+      op == Instruction::SETSTRID ||
+      op == Instruction::GETSTRID)
+    return true;
+
+  return false;
+}
+
+bool StreamMemory::ClaimBank(Record* record, size_t word, long long int cycle)
+{
+  int bank = static_cast<int>((record->id + word) % num_banks);
+  if (bank_cycle[bank] == cycle) {
+    bank_stalls++;
+    return false;
+  }
+  bank_cycle[bank] = cycle;
+  return true;
+}
+
+void StreamMemory::ChangeOccupancy(int delta, long long int cycle)
+{
+  if (cycle > occupancy_cycle) {
+    occupancy_cycles += occupancy * (cycle - occupancy_cycle);
+    occupancy_cycle = cycle;
+  }
+  occupancy += delta;
+  if (occupancy > max_occupancy)
+    max_occupancy = occupancy;
+}
+
+int StreamMemory::Bursts(size_t words) const
+{
+  return static_cast<int>((words + burst_words - 1) / burst_words);
+}
+
+bool StreamMemory::AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState* thread)
+{
+  long long int cycle = issuer->current_cycle;
+  long long int write_cycle = cycle + latency;
+  reg_value arg;
+  reg_value result;
+  Instruction::Opcode failop = Instruction::NOP;
+
+  // these read their operand (the value or stream id) from args[0]
+  if (ins.op == Instruction::STARTSW || ins.op == Instruction::STREAMW || ins.op == Instruction::SETSTRID) {
+    if (!thread->ReadRegister(ins.args[0], cycle, arg, failop)) {
+      // bad stuff happened
+      printf("StreamMemory: Error in Accepting instruction. Should have passed.\n");
+    }
+  }
+  else if (ins.op == Instruction::STRSIZE || ins.op == Instruction::STRSCHED) {
+    if (!thread->ReadRegister(ins.args[1], cycle, arg, failop)) {
+      // bad stuff happened
+      printf("StreamMemory: Error in Accepting instruction. Should have passed.\n");
+    }
+  }
+
+  pthread_mutex_lock(&global_mutex);
+  Cursor& cursor = cursors[thread];
+
+  switch (ins.op) {
+  case Instruction::STARTSW:
+    if (cursor.writing) {
+      printf("ERROR: STARTSW with a stream record already open (stream %d)\n", cursor.write_stream);
+      exit(1);
+    }
+    cursor.write_stream = arg.idata;
+    cursor.writing = new Record;
+    cursor.writing->id = next_record_id++;
+    cursor.writing->spilled = false;
+    break;
+
+  case Instruction::STREAMW:
+    if (!cursor.writing) {
+      printf("ERROR: STREAMW without STARTSW\n");
+      exit(1);
+    }
+    if (!ClaimBank(cursor.writing, cursor.writing->words.size(), cycle)) {
+      pthread_mutex_unlock(&global_mutex);
+      return false;
+    }
+    cursor.writing->words.push_back(arg);
+    words_written++;
+    break;
+
+  case Instruction::ENDSW: {
+    if (!cursor.writing) {
+      printf("ERROR: ENDSW without STARTSW\n");
+      exit(1);
+    }
+    Record* record = cursor.writing;
+    int size = static_cast<int>(record->words.size());
+    if (occupancy + size > capacity) {
+      // no room on chip, write it out a burst at a time
+      record->spilled = true;
+      spilled_records++;
+      int bursts = Bursts(size);
+      dram_bytes_written += bursts * burst_words * 4;
+      if (dram_free_cycle < cycle)
+        dram_free_cycle = cycle;
+      dram_free_cycle += bursts;
+    }
+    else
+      ChangeOccupancy(size, cycle);
+    streams[cursor.write_stream].push_back(record);
+    cursor.writing = NULL;
+    records_written++;
+    break;
+  }
+
+  case Instruction::STARTSR: {
+    if (cursor.reading) {
+      printf("ERROR: STARTSR with a stream record already open (stream %d)\n", cursor.read_stream);
+      exit(1);
+    }
+    std::deque<Record*>& stream = streams[cursor.read_stream];
+    result.idata = 0;
+    if (!stream.empty()) {
+      Record* record = stream.front();
+      stream.pop_front();
+      if (record->spilled) {
+        // read it back once the port is free
+        int bursts = Bursts(record->words.size());
+        dram_bytes_read += bursts * burst_words * 4;
+        if (dram_free_cycle < cycle)
+          dram_free_cycle = cycle;
+        dram_free_cycle += bursts;
+        long long int ready_cycle = dram_free_cycle + dram_latency;
+        if (ready_cycle > write_cycle) {
+          dram_stall_cycles += ready_cycle - write_cycle;
+          write_cycle = ready_cycle;
+        }
+      }
+      cursor.reading = record;
+      cursor.next_word = 0;
+      records_read++;
+      result.idata = static_cast<int>(record->words.size());
+    }
+    break;
+  }
+
+  case Instruction::STREAMR:
+    if (!cursor.reading || cursor.next_word >= cursor.reading->words.size()) {
+      printf("ERROR: STREAMR past the end of the stream record (stream %d)\n", cursor.read_stream);
+      exit(1);
+    }
+    if (!cursor.reading->spilled && !ClaimBank(cursor.reading, cursor.next_word, cycle)) {
+      pthread_mutex_unlock(&global_mutex);
+      return false;
+    }
+    result = cursor.reading->words[cursor.next_word];
+    break;
+
+  case Instruction::ENDSR:
+    // ending a read of an empty stream is fine
+    if (cursor.reading) {
+      if (!cursor.reading->spilled)
+        ChangeOccupancy(-static_cast<int>(cursor.reading->words.size()), cycle);
+      delete cursor.reading;
+      cursor.reading = NULL;
+    }
+    break;
+
+  case Instruction::STRSIZE: {
+    std::map<int, std::deque<Record*> >::iterator it = streams.find(arg.idata);
+    result.idata = it == streams.end() ? 0 : static_cast<int>(it->second.size());
+    break;
+  }
+
+  case Instruction::STRSCHED: {
+    // the fullest stream, or the one whose head record is oldest
+    result.idata = -1;
+    long long int best = -1;
+    for (std::map<int, std::deque<Record*> >::iterator it = streams.begin(); it != streams.end(); ++it) {
+      if (it->second.empty())
+        continue;
+      long long int score = arg.idata == 1 ? -it->second.front()->id : static_cast<long long int>(it->second.size());
+      if (result.idata == -1 || score > best) {
+        best = score;
+        result.idata = it->first;
+      }
+    }
+    break;
+  }
+
+  case Instruction::SETSTRID:
+    cursor.read_stream = arg.idata;
+    break;
+
+  case Instruction::GETSTRID:
+    result.idata = cursor.read_stream;
+    break;
+
+  default:
+    break;
+  }
+
+  bool writes_result = ins.op == Instruction::STARTSR || ins.op == Instruction::STREAMR ||
+    ins.op == Instruction::STRSIZE || ins.op == Instruction::STRSCHED || ins.op == Instruction::GETSTRID;
+  if (writes_result && !thread->QueueWrite(ins.args[0], result, write_cycle, ins.op, &ins)) {
+    // the stream state has already changed, so this can't be retried
+    printf("ERROR: StreamMemory could not queue the result of %s\n", Instruction::Opnames[ins.op].c_str());
+    exit(1);
+  }
+  if (ins.op == Instruction::STREAMR) {
+    cursor.next_word++;
+    words_read++;
+  }
+
+  pthread_mutex_unlock(&global_mutex);
+  return true;
+}
+
+// From HardwareModule
+void StreamMemory::ClockRise()
+{
+}
+
+void StreamMemory::ClockFall()
+{
+}
+
+void StreamMemory::print()
+{
+  printf("%d words in %d streams", occupancy, (int)streams.size());
+}
+
+double StreamMemory::Energy()
+{
+  return access_energy * (words_written + words_read);
+}
+
+void StreamMemory::PrintStats(long long int cycles)
+{
+  if (occupancy_cycle < cycles)
+    ChangeOccupancy(0, cycles);
+  printf(" STREAM: latency %d, capacity %d words, %d banks, DRAM latency %d, %d word bursts\n",
+         latency, capacity, num_banks, dram_latency, burst_words);
+  printf("   records written: %lld (%lld words), read: %lld (%lld words)\n",
+         records_written, words_written, records_read, words_read);
+  printf("   occupancy: %.2f words average, %d peak (%.2f%% of capacity)\n",
+         cycles > 0 ? static_cast<double>(occupancy_cycles) / cycles : 0.,
+         max_occupancy, capacity > 0 ? 100. * max_occupancy / capacity : 0.);
+  printf("   bank conflict stalls: %lld, DRAM stall cycles: %lld\n", bank_stalls, dram_stall_cycles);
+  printf("   spilled records: %lld, DRAM bytes written: %lld, read: %lld (%.2f per record read)\n",
+         spilled_records, dram_bytes_written, dram_bytes_read,
+         records_read > 0 ? static_cast<double>(dram_bytes_written + dram_bytes_read) / records_read : 0.);
+  printf("   area (mm2): %f, energy (J): %f\n", GetArea(), Energy() / 1000000000.f);
+}
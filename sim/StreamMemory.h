@@ -0,0 +1,116 @@
+#ifndef _SIMHWRT_STREAM_MEMORY_H_
+#define _SIMHWRT_STREAM_MEMORY_H_
+
+// A chip-wide stream buffer for ray streaming (one shared by all TMs, like
+// the global registers), set up by a STREAM line in the config file:
+//
+//   STREAM <latency> <capacity in words> <banks> <DRAM latency> <DRAM burst words> <area mm^2 (optional)> <energy per access nJ (optional)>
+//
+// Streams are FIFOs of records (a ray, say), keyed by an integer stream id
+// (a treelet, say). A thread writes a record with
+//
+//   STARTSW rs     start a record for stream rs
+//   STREAMW rs     append rs to it
+//   ENDSW          make it visible to readers
+//
+// and reads one from the stream picked with SETSTRID rs (GETSTRID rd) with
+//
+//   STARTSR rd     take the oldest record, rd = its size in words (0 if the stream is empty)
+//   STREAMR rd     rd = its next word
+//   ENDSR          done with it
+//
+// STRSIZE rd, rs sets rd to the number of records waiting in stream rs.
+// STRSCHED rd, rs picks a stream to read next: the one with the most
+// records waiting (rs = 0) or with the oldest record (rs = 1), -1 if every
+// stream is empty.
+//
+// Words live in <banks> banks, each of which takes one STREAMW or STREAMR
+// per cycle; the others stall. Records that don't fit in <capacity> when
+// they are ended spill to DRAM in <DRAM burst words> bursts, and the
+// STARTSR that takes one back waits for it (DRAM latency plus a cycle per
+// burst on the buffer's one DRAM port, which spills also occupy).
+
+#include "FunctionalUnit.h"
+#include "SimpleRegisterFile.h"
+#include <deque>
+#include <map>
+#include <vector>
+
+class StreamMemory : public FunctionalUnit {
+ public:
+  StreamMemory(int latency, int capacity, int num_banks, int dram_latency, int burst_words);
+  ~StreamMemory();
+
+  void Reset();
+
+  // From FunctionalUnit
+  virtual bool SupportsOp(Instruction::Opcode op) const;
+  virtual bool AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState* thread);
+
+  // From HardwareModule
+  virtual void ClockRise();
+  virtual void ClockFall();
+  virtual void print();
+
+  // nJ for every word written and read
+  double Energy();
+  // cycles is the length of the run
+  void PrintStats(long long int cycles);
+
+  int capacity;
+  int num_banks;
+  int dram_latency;
+  int burst_words;
+  // nJ per word written or read
+  float access_energy;
+
+  long long int records_written;
+  long long int records_read;
+  long long int words_written;
+  long long int words_read;
+  // words on chip, summed over cycles, and the most at once
+  long long int occupancy_cycles;
+  int max_occupancy;
+  long long int spilled_records;
+  long long int dram_bytes_written;
+  long long int dram_bytes_read;
+  // STREAMW/STREAMR turned away by a busy bank
+  long long int bank_stalls;
+  // cycles STARTSRs waited for spilled records
+  long long int dram_stall_cycles;
+
+ private:
+  struct Record {
+    long long int id;
+    std::vector<reg_value> words;
+    bool spilled;
+  };
+
+  // A thread's open records
+  struct Cursor {
+    Cursor() : write_stream(0), writing(NULL), read_stream(0), reading(NULL), next_word(0) {}
+    int write_stream;
+    Record* writing;
+    int read_stream;
+    Record* reading;
+    size_t next_word;
+  };
+
+  // Claim the bank holding word of record for this cycle
+  bool ClaimBank(Record* record, size_t word, long long int cycle);
+  // Track words on chip, crediting the old count up to cycle
+  void ChangeOccupancy(int delta, long long int cycle);
+  int Bursts(size_t words) const;
+  void Clear();
+
+  std::map<int, std::deque<Record*> > streams;
+  std::map<ThreadState*, Cursor> cursors;
+  long long int* bank_cycle;
+  long long int next_record_id;
+  int occupancy;
+  long long int occupancy_cycle;
+  // first cycle the DRAM port is free
+  long long int dram_free_cycle;
+};
+
+#endif // _SIMHWRT_STREAM_MEMORY_H_
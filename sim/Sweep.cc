@@ -0,0 +1,312 @@
+#include "Sweep.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sstream>
+#include <fstream>
+
+#ifndef WIN32
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+// Options that only affect the hardware model and may vary per point.
+// Anything that changes the scene or the program must be the same for
+// every point, since those are loaded once before forking.
+struct SweepOption {
+  const char* name;
+  bool has_value;
+};
+
+static const SweepOption sweep_options[] = {
+  {"--num-TMs",           true},
+  {"--num-cores",         true},
+  {"--num-l2s",           true},
+  {"--num-thread-procs",  true},
+  {"--threads-per-proc",  true},
+  {"--simd-width",        true},
+  {"--num-icaches",       true},
+  {"--num-icache-banks",  true},
+  {"--scheduling",        true},
+  {"--config-file",       true},
+  {"--dcacheparams",      true},
+  {"--icacheparams",      true},
+  {"--usimm-config",      true},
+  {"--vi-file",           true},
+  {"--stop-cycle",        true},
+  {"--simulation-threads",true},
+  {"--disable-usimm",     false},
+  {"--wait-usimm",        false},
+  {"--l1-off",            false},
+  {"--l2-off",            false},
+  {"--l1-read-copy",      false},
+};
+
+static const SweepOption* FindSweepOption(const std::string& name)
+{
+  for(size_t i = 0; i < sizeof(sweep_options) / sizeof(sweep_options[0]); i++)
+    if(name == sweep_options[i].name)
+      return &sweep_options[i];
+  return NULL;
+}
+
+// the child's end of its result pipe
+static int result_fd = -1;
+
+std::string SweepPoint::Label() const
+{
+  std::string label;
+  for(size_t i = 0; i < args.size(); i++) {
+    if(i > 0)
+      label += " ";
+    label += args[i];
+  }
+  return label;
+}
+
+bool ReadSweepFile(const char* filename, std::vector<SweepPoint>& points)
+{
+  std::ifstream input(filename);
+  if(!input.is_open()) {
+    printf("ERROR: cannot open sweep file %s\n", filename);
+    return false;
+  }
+
+  std::vector<SweepPoint> explicit_points;
+  std::vector<std::string> constant_args;
+  std::vector<std::string> axis_names;
+  std::vector< std::vector<std::string> > axis_values;
+
+  int line_num = 0;
+  std::string line;
+  while(std::getline(input, line)) {
+    line_num++;
+    size_t comment = line.find('#');
+    if(comment != std::string::npos)
+      line = line.substr(0, comment);
+
+    std::istringstream tokens(line);
+    std::vector<std::string> words;
+    std::string word;
+    while(tokens >> word)
+      words.push_back(word);
+    if(words.empty())
+      continue;
+
+    if(words[0] == "point") {
+      SweepPoint point;
+      for(size_t i = 1; i < words.size(); i++) {
+	const SweepOption* option = FindSweepOption(words[i]);
+	if(option == NULL) {
+	  printf("ERROR: sweep file line %d: %s cannot be swept\n", line_num, words[i].c_str());
+	  return false;
+	}
+	point.args.push_back(words[i]);
+	if(option->has_value) {
+	  if(++i >= words.size()) {
+	    printf("ERROR: sweep file line %d: %s needs a value\n", line_num, option->name);
+	    return false;
+	  }
+	  point.args.push_back(words[i]);
+	}
+      }
+      explicit_points.push_back(point);
+      continue;
+    }
+
+    const SweepOption* option = FindSweepOption(words[0]);
+    if(option == NULL) {
+      printf("ERROR: sweep file line %d: %s cannot be swept\n", line_num, words[0].c_str());
+      return false;
+    }
+    if(words.size() == 1) {
+      if(option->has_value) {
+	printf("ERROR: sweep file line %d: %s needs at least one value\n", line_num, option->name);
+	return false;
+      }
+      constant_args.push_back(words[0]);
+    }
+    else {
+      if(!option->has_value) {
+	printf("ERROR: sweep file line %d: %s does not take a value\n", line_num, option->name);
+	return false;
+      }
+      axis_names.push_back(words[0]);
+      axis_values.push_back(std::vector<std::string>(words.begin() + 1, words.end()));
+    }
+  }
+
+  if(explicit_points.empty())
+    explicit_points.push_back(SweepPoint());
+
+  // Cartesian product of the axes, for each explicit point
+  points.clear();
+  for(size_t p = 0; p < explicit_points.size(); p++) {
+    std::vector<size_t> index(axis_names.size(), 0);
+    while(true) {
+      SweepPoint point;
+      point.args = constant_args;
+      point.args.insert(point.args.end(), explicit_points[p].args.begin(), explicit_points[p].args.end());
+      for(size_t a = 0; a < axis_names.size(); a++) {
+	point.args.push_back(axis_names[a]);
+	point.args.push_back(axis_values[a][index[a]]);
+      }
+      points.push_back(point);
+
+      // advance the last axis fastest
+      int a = (int)axis_names.size() - 1;
+      for(; a >= 0; a--) {
+	if(++index[a] < axis_values[a].size())
+	  break;
+	index[a] = 0;
+      }
+      if(a < 0)
+	break;
+    }
+  }
+
+  return true;
+}
+
+#ifdef WIN32
+
+int SweepHostCores()
+{
+  return 1;
+}
+
+int RunSweep(std::vector<SweepPoint>& points, int max_jobs, const char* table_file)
+{
+  printf("ERROR: --sweep requires fork() and is not supported on Windows\n");
+  exit(1);
+}
+
+void WriteSweepResult(long long int cycles, double fps, double issue_rate,
+		      double L1_hit_rate, double L2_hit_rate, double DRAM_bandwidth,
+		      double area, double energy, double power, double wall_seconds)
+{
+}
+
+#else
+
+int SweepHostCores()
+{
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  return cores > 0 ? (int)cores : 1;
+}
+
+int RunSweep(std::vector<SweepPoint>& points, int max_jobs, const char* table_file)
+{
+  if(max_jobs < 1)
+    max_jobs = 1;
+
+  printf("Sweep: %d points, up to %d at a time\n", (int)points.size(), max_jobs);
+  fflush(stdout);
+
+  std::vector<pid_t> pids(points.size(), 0);
+  std::vector<int> fds(points.size(), -1);
+  std::vector<std::string> rows(points.size());
+  size_t next_point = 0;
+  int running = 0;
+
+  while(next_point < points.size() || running > 0) {
+    if(running < max_jobs && next_point < points.size()) {
+      int p = next_point++;
+      int pipe_fds[2];
+      if(pipe(pipe_fds) != 0) {
+	perror("Sweep: unable to create pipe");
+	exit(1);
+      }
+      fflush(stdout);
+      pid_t pid = fork();
+      if(pid < 0) {
+	perror("Sweep: unable to fork");
+	exit(1);
+      }
+      if(pid == 0) {
+	// child: keep only our own pipe and send output to a log file
+	close(pipe_fds[0]);
+	for(size_t i = 0; i < fds.size(); i++)
+	  if(fds[i] >= 0)
+	    close(fds[i]);
+	result_fd = pipe_fds[1];
+	char log_name[512];
+	sprintf(log_name, "%s.p%d.log", table_file, p);
+	if(freopen(log_name, "w", stdout) == NULL)
+	  printf("WARNING: unable to open %s, sweep point output will be mixed\n", log_name);
+	printf("Sweep point %d: %s\n", p, points[p].Label().c_str());
+	return p;
+      }
+      close(pipe_fds[1]);
+      pids[p] = pid;
+      fds[p] = pipe_fds[0];
+      running++;
+      printf("Sweep point %d started: %s\n", p, points[p].Label().c_str());
+      continue;
+    }
+
+    // wait for any point to finish, then collect its row
+    int status;
+    pid_t pid = wait(&status);
+    if(pid < 0) {
+      perror("Sweep: wait failed");
+      exit(1);
+    }
+    for(size_t p = 0; p < pids.size(); p++) {
+      if(pids[p] != pid)
+	continue;
+      char buf[1024];
+      ssize_t bytes;
+      while((bytes = read(fds[p], buf, sizeof(buf) - 1)) > 0) {
+	buf[bytes] = '\0';
+	rows[p] += buf;
+      }
+      close(fds[p]);
+      fds[p] = -1;
+      if(rows[p].empty() || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	rows[p] = "failed\n";
+      printf("Sweep point %d finished: %s", (int)p, rows[p].c_str());
+      running--;
+      break;
+    }
+  }
+
+  FILE* table = fopen(table_file, "w");
+  if(table == NULL)
+    printf("WARNING: unable to open sweep results file %s, results only printed below\n", table_file);
+  const char* header = "point\tcycles\tFPS\tissue_rate\tL1_hit\tL2_hit\tDRAM_GB/s\tarea_mm2\tenergy_J\tpower_W\twall_s\toverrides\n";
+  printf("\nSweep results:\n%s", header);
+  if(table)
+    fprintf(table, "%s", header);
+  for(size_t p = 0; p < points.size(); p++) {
+    std::string row = rows[p].substr(0, rows[p].find('\n'));
+    printf("%d\t%s\t%s\n", (int)p, row.c_str(), points[p].Label().c_str());
+    if(table)
+      fprintf(table, "%d\t%s\t%s\n", (int)p, row.c_str(), points[p].Label().c_str());
+  }
+  if(table) {
+    fclose(table);
+    printf("Sweep results written to %s\n", table_file);
+  }
+  return -1;
+}
+
+void WriteSweepResult(long long int cycles, double fps, double issue_rate,
+		      double L1_hit_rate, double L2_hit_rate, double DRAM_bandwidth,
+		      double area, double energy, double power, double wall_seconds)
+{
+  if(result_fd < 0)
+    return;
+  char row[1024];
+  int length = sprintf(row, "%lld\t%.4f\t%.4f\t%.4f\t%.4f\t%.4f\t%.4f\t%.6f\t%.4f\t%.3f\n",
+		       cycles, fps, issue_rate, L1_hit_rate, L2_hit_rate, DRAM_bandwidth,
+		       area, energy, power, wall_seconds);
+  if(write(result_fd, row, length) != length)
+    perror("Sweep: unable to send result");
+  close(result_fd);
+  result_fd = -1;
+}
+
+#endif // WIN32
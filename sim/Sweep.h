@@ -0,0 +1,49 @@
+#ifndef _SIMHWRT_SWEEP_H_
+#define _SIMHWRT_SWEEP_H_
+
+// Parameter sweep batch mode (--sweep <file>).
+//
+// The scene, BVH and assembled program are loaded once by the parent
+// process. Each sweep point then runs in a forked child (so it shares the
+// loaded memory image copy-on-write) that builds its own hardware from the
+// base command line plus the point's overrides. At most --sweep-jobs
+// children run at once. Each child sends one result row back over a pipe
+// and the parent writes the combined table.
+//
+// Sweep file syntax, '#' starts a comment:
+//   --num-TMs 1 2 4 8          an axis: an option followed by the values to try
+//   --config-file a.config b.config
+//   --disable-usimm            an option with no values applies to every point
+//   point --num-l2s 2 --num-TMs 16
+//                              an explicit point (a list of overrides)
+// The points are every explicit point (or a single empty point if there are
+// none) combined with the cartesian product of all axes.
+
+#include <string>
+#include <vector>
+
+struct SweepPoint {
+  std::vector<std::string> args;
+  std::string Label() const;
+};
+
+// Returns false (after printing an error) on a missing file or an option
+// that cannot be swept.
+bool ReadSweepFile(const char* filename, std::vector<SweepPoint>& points);
+
+// Default --sweep-jobs: the number of host cores
+int SweepHostCores();
+
+// Returns the point index in a child process that should go on to simulate
+// that point, or -1 in the parent once every point has finished and the
+// results table has been written to table_file (and stdout).
+// Child output goes to <table_file>.p<index>.log
+int RunSweep(std::vector<SweepPoint>& points, int max_jobs, const char* table_file);
+
+// Called by a child when its stats are known. Columns match the header
+// written by RunSweep.
+void WriteSweepResult(long long int cycles, double fps, double issue_rate,
+		      double L1_hit_rate, double L2_hit_rate, double DRAM_bandwidth,
+		      double area, double energy, double power, double wall_seconds);
+
+#endif // _SIMHWRT_SWEEP_H_
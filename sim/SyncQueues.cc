@@ -0,0 +1,114 @@
+#include "SyncQueues.h"
+#include "GlobalRegisterFile.h"
+#include "IssueUnit.h"
+#include "ThreadState.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// wake cycle of a thread no release has woken yet
+#define NOT_RELEASED LLONG_MAX
+
+SyncQueues::SyncQueues(GlobalRegisterFile* _globals, const SyncWakeParams& params) :
+  globals(_globals), release_latency(params.release_latency)
+{
+  if (release_latency < 1) {
+    printf("ERROR: SYNCWAKE needs a release latency of at least 1 (%d)\n", release_latency);
+    exit(1);
+  }
+  int num_registers = globals->num_registers;
+  queues.resize(num_registers);
+  blocks.resize(num_registers);
+  wakes.resize(num_registers);
+  handoffs.resize(num_registers);
+  max_waiters.resize(num_registers);
+  wait_cycles.resize(num_registers);
+  wait_histogram.resize(num_registers);
+  Reset();
+}
+
+void SyncQueues::Reset()
+{
+  for (size_t reg = 0; reg < queues.size(); reg++) {
+    queues[reg].clear();
+    blocks[reg] = 0;
+    wakes[reg] = 0;
+    handoffs[reg] = 0;
+    max_waiters[reg] = 0;
+    wait_cycles[reg] = 0;
+    wait_histogram[reg].assign(1, 0);
+  }
+}
+
+void SyncQueues::Block(int reg, Instruction::Opcode op, ThreadState* thread, IssueUnit* issuer, long long int cycle)
+{
+  Waiter waiter;
+  waiter.thread = thread;
+  waiter.op = op;
+  waiter.since = cycle;
+  queues[reg].push_back(waiter);
+  blocks[reg]++;
+  if ((int)queues[reg].size() > max_waiters[reg])
+    max_waiters[reg] = (int)queues[reg].size();
+
+  // the issuer wakes it once a release sets the wake cycle
+  thread->sync_wake_cycle = NOT_RELEASED;
+  thread->Sleep(INT_MAX);
+  issuer->sync_sleepers.push_back(thread);
+}
+
+void SyncQueues::Changed(int reg, long long int cycle)
+{
+  if (queues[reg].empty() || globals->ReadUint(reg) != 0)
+    return;
+
+  long long int wake_cycle = cycle + release_latency;
+  while (!queues[reg].empty()) {
+    Waiter waiter = queues[reg].front();
+    queues[reg].pop_front();
+
+    long long int wait = wake_cycle - waiter.since;
+    wakes[reg]++;
+    wait_cycles[reg] += wait;
+    size_t bucket = 0;
+    while ((1LL << bucket) <= wait)
+      bucket++;
+    if (bucket >= wait_histogram[reg].size())
+      wait_histogram[reg].resize(bucket + 1, 0);
+    wait_histogram[reg][bucket]++;
+
+    waiter.thread->sync_wake_cycle = wake_cycle;
+    if (waiter.op == Instruction::SEM_ACQ) {
+      // the semaphore goes straight to the oldest thread asking for it
+      globals->WriteUint(reg, 1);
+      waiter.thread->sync_granted = true;
+      handoffs[reg]++;
+      break;
+    }
+  }
+}
+
+void SyncQueues::PrintStats()
+{
+  printf(" SYNCWAKE: release latency %d\n", release_latency);
+  for (size_t reg = 0; reg < queues.size(); reg++)
+  {
+    if (blocks[reg] == 0)
+      continue;
+    printf("   register %d: %lld threads put to sleep, %lld woken (%lld handed the semaphore), slept %.2f cycles average, up to %d asleep at once\n",
+           (int)reg, blocks[reg], wakes[reg], handoffs[reg],
+           wakes[reg] > 0 ? static_cast<double>(wait_cycles[reg]) / wakes[reg] : 0., max_waiters[reg]);
+    printf("     cycles slept:");
+    for (size_t i = 0; i < wait_histogram[reg].size(); i++)
+    {
+      if (wait_histogram[reg][i] == 0)
+        continue;
+      if (i < 2)
+        printf(" %d: %lld", (int)i, wait_histogram[reg][i]);
+      else
+        printf(" %lld-%lld: %lld", 1LL << (i - 1), (1LL << i) - 1, wait_histogram[reg][i]);
+    }
+    printf("\n");
+  }
+}
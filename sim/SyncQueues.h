@@ -0,0 +1,75 @@
+#ifndef _SIMHWRT_SYNC_QUEUES_H_
+#define _SIMHWRT_SYNC_QUEUES_H_
+
+// Wait queues for the global register BARRIER and SEM_ACQ ops, set up by a
+// SYNCWAKE line in the config file:
+//
+//   SYNCWAKE <release latency>
+//
+// Without it a thread whose BARRIER finds its register nonzero, or whose
+// SEM_ACQ finds the semaphore taken, tries again every cycle. With it the
+// thread joins its register's queue and sleeps (ThreadState::Sleep) until
+// it is woken, without issuing. A register becoming 0 (SEM_REL, or the
+// ATOMIC_DEC, GLOBAL_STORE, ... that clears a barrier count) is a release:
+// the queue's threads wake <release latency> cycles later, in order, up to
+// the first one waiting on SEM_ACQ, which is handed the semaphore (the
+// register is set to 1 again for it) and issues its SEM_ACQ once awake.
+// A woken BARRIER checks its register again, and sleeps again if it is
+// nonzero by then.
+//
+// Each register keeps a histogram of how long its threads slept.
+
+#include "Instruction.h"
+#include <deque>
+#include <vector>
+
+class GlobalRegisterFile;
+class IssueUnit;
+class ThreadState;
+
+// SYNCWAKE config line parameters
+struct SyncWakeParams {
+  bool enabled;
+  int release_latency;
+
+  SyncWakeParams() :
+    enabled(false), release_latency(1)
+  {}
+};
+
+class SyncQueues {
+public:
+  SyncQueues(GlobalRegisterFile* globals, const SyncWakeParams& params);
+
+  // Put a thread whose BARRIER or SEM_ACQ (op) on reg failed at cycle to sleep
+  void Block(int reg, Instruction::Opcode op, ThreadState* thread, IssueUnit* issuer, long long int cycle);
+  // Wake reg's threads if an op at cycle released it
+  void Changed(int reg, long long int cycle);
+
+  void Reset();
+  void PrintStats();
+
+  GlobalRegisterFile* globals;
+  int release_latency;
+
+  // per register: threads put to sleep and woken, semaphores handed over
+  // on release, the most threads asleep at once, the cycles they slept,
+  // and how many slept 1, 2-3, 4-7, ... cycles
+  std::vector<long long int> blocks;
+  std::vector<long long int> wakes;
+  std::vector<long long int> handoffs;
+  std::vector<int> max_waiters;
+  std::vector<long long int> wait_cycles;
+  std::vector<std::vector<long long int> > wait_histogram;
+
+private:
+  struct Waiter {
+    ThreadState* thread;
+    Instruction::Opcode op;
+    long long int since;
+  };
+
+  std::vector<std::deque<Waiter> > queues;
+};
+
+#endif // _SIMHWRT_SYNC_QUEUES_H_
@@ -1,4 +1,8 @@
 #include "ThreadProcessor.h"
+#include "L1Cache.h"
+#include "L2Cache.h"
+#include "MainMemory.h"
+#include <string.h>
 
 ThreadProcessor::ThreadProcessor(int _num_threads, int num_regs, int _proc_id, SchedulingScheme ss, std::vector<Instruction*>* _instructions, std::vector<HardwareModule*> &modules, std::vector<FunctionalUnit*> *_functional_units, size_t threadprocid, size_t coreid, size_t l2id)
 {
@@ -9,6 +13,15 @@ ThreadProcessor::ThreadProcessor(int _num_threads, int num_regs, int _proc_id, S
   functional_units = _functional_units;
   halted = false;
   num_halted = 0;
+  L1 = NULL;
+  thread_switches = 0;
+  stalls_other_ready = 0;
+  stalls_none_ready = 0;
+
+  // two-level scheduling starts with the first half of the threads active
+  for(int i=0; i<num_threads; i++)
+    pool.push_back(i);
+  active_pool_size = num_threads / 2 > 0 ? num_threads / 2 : 1;
 
   // set up multiple thread states for multi-threading (default is 1 thread per proc)
   for(int i=0; i<num_threads; i++){
@@ -35,6 +48,9 @@ void ThreadProcessor::Reset()
 {
   halted = false;
   num_halted = 0;
+  thread_switches = 0;
+  stalls_other_ready = 0;
+  stalls_none_ready = 0;
   for(int i=0; i < num_threads; i++)
     thread_states[i]->Reset();
 }
@@ -54,7 +70,30 @@ void ThreadProcessor::CompleteInstruction(Instruction* ins){
 
 //TODO: Multithreading does not work with the new HALT system. The entire ThreadProcessor (all multi-threads)
 // will halt as soon as one of them halts.
-void ThreadProcessor::Schedule(Instruction::Opcode last_issued, Instruction::Opcode last_stall){
+const char* ThreadProcessor::SchedulingName(SchedulingScheme ss){
+  switch(ss){
+  case SIMPLE: return "simple";
+  case PRESTALL: return "prestall";
+  case POSTSTALL: return "poststall";
+  case GTO: return "gto";
+  case TWO_LEVEL: return "twolevel";
+  case LRR: return "lrr";
+  default: return "unknown";
+  };
+}
+
+bool ThreadProcessor::ParseScheduling(const char* name, SchedulingScheme& ss){
+  const SchedulingScheme schemes[] = {SIMPLE, PRESTALL, POSTSTALL, GTO, TWO_LEVEL, LRR};
+  for(size_t i=0; i<sizeof(schemes)/sizeof(schemes[0]); i++){
+    if(strcmp(name, SchedulingName(schemes[i]))==0){
+      ss = schemes[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadProcessor::Schedule(Instruction::Opcode last_issued, Instruction::Opcode last_stall, bool last_blocked, long long int cur_cycle){
   // Removed to allow multiple issue. Should be fixed if we want multithreading at the same time
 //   if(last_issued!=Instruction::NOP && last_stall!=Instruction::NOP)
 //     {
@@ -63,11 +102,33 @@ void ThreadProcessor::Schedule(Instruction::Opcode last_issued, Instruction::Opc
 //     }
   if(last_issued!=Instruction::NOP){
     GetActiveThread()->Wake(true); 
+    // it issued this cycle, even if a second instruction couldn't
+    last_blocked = false;
+  }
+  if(num_threads < 2){
+    SwitchThread(last_issued, last_stall, last_blocked, cur_cycle);
+    return;
+  }
+
+  // attribute the active thread's data stall: could the scheduler have
+  // hidden it with another thread?
+  int last_active = active_thread;
+  if(last_stall!=Instruction::NOP){
+    bool other_ready = false;
+    for(int i=0; i<num_threads && !other_ready; i++)
+      if(i != active_thread && ThreadReady(i, cur_cycle))
+	other_ready = true;
+    if(other_ready)
+      stalls_other_ready++;
+    else
+      stalls_none_ready++;
   }
-  SwitchThread(last_issued, last_stall);
+  SwitchThread(last_issued, last_stall, last_blocked, cur_cycle);
+  if(active_thread != last_active)
+    thread_switches++;
 }
 
-void ThreadProcessor::SwitchThread(Instruction::Opcode last_issued, Instruction::Opcode last_stall){
+void ThreadProcessor::SwitchThread(Instruction::Opcode last_issued, Instruction::Opcode last_stall, bool last_blocked, long long int cur_cycle){
   size_t i;
   int stall_length = 0;  
   switch(schedule){
@@ -86,6 +147,9 @@ void ThreadProcessor::SwitchThread(Instruction::Opcode last_issued, Instruction:
       stall_length = 51;
     if(stall_length > 1)
       GetActiveThread()->Sleep(stall_length);
+    // a thread that can't issue (BARRIER, HALT, ...) yields for a cycle
+    else if(last_blocked)
+      GetActiveThread()->Sleep(1);
     PrestallScheduler();
     break;
   case POSTSTALL:
@@ -112,6 +176,15 @@ void ThreadProcessor::SwitchThread(Instruction::Opcode last_issued, Instruction:
       }
     PoststallScheduler();
     break;
+  case GTO:
+    GTOScheduler(last_stall, last_blocked, cur_cycle);
+    break;
+  case TWO_LEVEL:
+    TwoLevelScheduler(last_stall, last_blocked, cur_cycle);
+    break;
+  case LRR:
+    LRRScheduler(last_issued, last_stall);
+    break;
   default:
     SimpleScheduler();
     break;
@@ -155,6 +228,118 @@ void ThreadProcessor::PoststallScheduler(){
   }
 }
 
+// Keep issuing from the active thread until it stalls, then switch to the
+// oldest (lowest numbered) thread that can issue. A thread blocked with its
+// operands ready (e.g. on a BARRIER the others have yet to reach) would
+// look ready again, so it hands over to the next thread in age order
+// instead, and every thread gets a turn.
+void ThreadProcessor::GTOScheduler(Instruction::Opcode last_stall, bool last_blocked, long long int cur_cycle){
+  if(last_blocked){
+    for(int j=1; j<num_threads; j++){
+      int candidate = (active_thread + j) % num_threads;
+      if(ThreadReady(candidate, cur_cycle)){
+	active_thread = candidate;
+	return;
+      }
+    }
+    return;
+  }
+  if(last_stall==Instruction::NOP)
+    return;
+  for(int i=0; i<num_threads; i++){
+    if(ThreadReady(i, cur_cycle)){
+      active_thread = i;
+      return;
+    }
+  }
+}
+
+// Round robin among a small active pool. A thread that stalls on memory,
+// or is blocked with its operands ready (e.g. on a BARRIER waiting for the
+// pending threads), moves to the back of the pending pool and the oldest
+// pending thread takes its place.
+void ThreadProcessor::TwoLevelScheduler(Instruction::Opcode last_stall, bool last_blocked, long long int cur_cycle){
+  int pos = -1;
+  for(int i=0; i<active_pool_size; i++)
+    if(pool[i]==active_thread)
+      pos = i;
+  if(pos >= 0 && (last_stall!=Instruction::NOP || last_blocked) && active_pool_size < num_threads){
+    if(L1 == NULL)
+      FindL1();
+    if(last_blocked || (L1 && L1->SupportsOp(last_stall))){
+      // the promoted thread waits for its turn in the round robin, so the
+      // rest of the active pool isn't starved by threads promoted ahead of it
+      int promoted = pool[active_pool_size];
+      pool.erase(pool.begin() + active_pool_size);
+      pool.push_back(active_thread);
+      pool[pos] = promoted;
+    }
+  }
+  for(int j=1; j<=active_pool_size; j++){
+    int candidate = pool[(pos + j + active_pool_size) % active_pool_size];
+    if(ThreadReady(candidate, cur_cycle)){
+      active_thread = candidate;
+      return;
+    }
+  }
+  if(pos < 0)
+    active_thread = pool[0];
+}
+
+// Poststall scheduling, but a thread stalled on memory sleeps for the
+// predicted memory latency instead of a fixed guess
+void ThreadProcessor::LRRScheduler(Instruction::Opcode last_issued, Instruction::Opcode last_stall){
+  if(last_stall!=Instruction::NOP){
+    int stall_length = StallLength(last_stall);
+    if(stall_length > 1)
+      GetActiveThread()->Sleep(stall_length);
+  }
+  PoststallScheduler();
+}
+
+bool ThreadProcessor::ThreadReady(int thread, long long int cur_cycle){
+  ThreadState* state = thread_states[thread];
+  // asleep until a barrier or semaphore release (SYNCWAKE)
+  if(state->sync_wake_cycle >= 0)
+    return false;
+  if(state->fetched_instruction == NULL)
+    return true;
+  int fail_reg;
+  return state->fetched_instruction->ReadyToIssue(state->register_ready, &fail_reg, cur_cycle);
+}
+
+void ThreadProcessor::FindL1(){
+  for(size_t i=0; i<functional_units->size() && L1 == NULL; i++)
+    L1 = dynamic_cast<L1Cache*>(functional_units->at(i));
+}
+
+int ThreadProcessor::PredictLoadLatency(){
+  if(L1 == NULL)
+    FindL1();
+  // the old fixed guess until there is something to go on
+  if(L1 == NULL || L1->accesses == 0)
+    return 51;
+  double L1_hit_rate = static_cast<double>(L1->hits) / L1->accesses;
+  L2Cache* L2 = L1->L2;
+  double L2_hit_rate = L2->accesses > 0 ? static_cast<double>(L2->hits) / L2->accesses : 0.0;
+  // with usimm the DRAM latency varies, MEMORY's latency is the estimate
+  int memory_latency = L2->mem ? L2->mem->latency : 0;
+  double latency = L1->hit_latency +
+    (1.0 - L1_hit_rate) * (L2->hit_latency + (1.0 - L2_hit_rate) * memory_latency);
+  return static_cast<int>(latency + 0.5);
+}
+
+int ThreadProcessor::StallLength(Instruction::Opcode op){
+  if(L1 == NULL)
+    FindL1();
+  if(L1 && L1->SupportsOp(op))
+    return PredictLoadLatency();
+  for(size_t i=0; i<functional_units->size(); i++)
+    if(functional_units->at(i)->SupportsOp(op))
+      return functional_units->at(i)->GetLatency() + 1;
+  return 0;
+}
+
 ThreadState* ThreadProcessor::GetActiveThread(){
   return thread_states.at(active_thread);
 }
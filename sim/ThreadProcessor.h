@@ -5,10 +5,14 @@
 #include <vector>
 
 class IssueUnit;
+class L1Cache;
 
 struct ScheduleData{
   Instruction::Opcode last_issued;
   Instruction::Opcode last_stall;
+  // the active thread's operands were ready but it couldn't issue (busy
+  // unit, BARRIER, SEM_ACQ, asleep until a release, ...)
+  bool last_blocked;
 };
 
 class ThreadProcessor{
@@ -17,14 +21,27 @@ class ThreadProcessor{
   enum SchedulingScheme{
     SIMPLE=0,
     PRESTALL,
-    POSTSTALL
+    POSTSTALL,
+    GTO,        // greedy-then-oldest
+    TWO_LEVEL,  // round robin within a small active pool
+    LRR         // loose round robin, sleeping on predicted latencies
   };
+  static const char* SchedulingName(SchedulingScheme ss);
+  // false if name isn't a scheme
+  static bool ParseScheduling(const char* name, SchedulingScheme& ss);
   SchedulingScheme schedule;
   int active_thread;
   int num_threads;
   int proc_id;
   bool halted;
   int num_halted;
+
+  // Scheduling stats (only meaningful with more than one thread)
+  long long int thread_switches;
+  // thread*cycles the active thread stalled on data while another
+  // thread could have issued, and while none could
+  long long int stalls_other_ready;
+  long long int stalls_none_ready;
   ThreadProcessor(int _num_threads, int num_regs, int _proc_id, SchedulingScheme ss, std::vector<Instruction*>* _instructions, std::vector<HardwareModule*> &modules, std::vector<FunctionalUnit*> *_functional_units, size_t threadprocid, size_t coreid, size_t l2id);
   ~ThreadProcessor();
   void Reset();
@@ -37,9 +54,9 @@ class ThreadProcessor{
   // Begin new write queue stuff
   bool QueueWrite(int which_reg, reg_value val, long long int which_cycle, Instruction::Opcode op);
   
-  void Schedule(Instruction::Opcode last_issued, Instruction::Opcode last_stall);
+  void Schedule(Instruction::Opcode last_issued, Instruction::Opcode last_stall, bool last_blocked, long long int cur_cycle);
   
-  void SwitchThread(Instruction::Opcode last_idssued, Instruction::Opcode last_stall);
+  void SwitchThread(Instruction::Opcode last_idssued, Instruction::Opcode last_stall, bool last_blocked, long long int cur_cycle);
 
   ThreadState* GetActiveThread();
 
@@ -50,6 +67,21 @@ class ThreadProcessor{
   void SimpleScheduler();
   void PrestallScheduler();
   void PoststallScheduler();
+  void GTOScheduler(Instruction::Opcode last_stall, bool last_blocked, long long int cur_cycle);
+  void TwoLevelScheduler(Instruction::Opcode last_stall, bool last_blocked, long long int cur_cycle);
+  void LRRScheduler(Instruction::Opcode last_issued, Instruction::Opcode last_stall);
+
+  // Could the thread issue (or fetch) this cycle
+  bool ThreadReady(int thread, long long int cur_cycle);
+  // Latency of a LOAD predicted from the core's observed L1 and L2 hit rates
+  int PredictLoadLatency();
+  int StallLength(Instruction::Opcode op);
+  void FindL1();
+
+  L1Cache* L1;
+  // TWO_LEVEL: pool[0, active_pool_size) is active, the rest pending in order
+  std::vector<int> pool;
+  int active_pool_size;
   
 };
 
@@ -60,6 +60,10 @@ bool WriteQueue::empty() {
   return head == tail;
 }
 
+bool WriteQueue::HasRoom(int writes) {
+  return size() + writes <= N-1;
+}
+
 bool WriteQueue::update(ThreadState* thread, int which_reg, long long int which_cycle, unsigned int val, long long new_cycle, unsigned int new_val, Instruction::Opcode new_op, Instruction* new_instr)
 {
   int num = size();
@@ -206,6 +210,9 @@ ThreadState::ThreadState(SimpleRegisterFile* regs,
   compare_register = 0;
   halted = false;
   sleep_cycles = 0;
+  sync_wake_cycle = -1;
+  sync_granted = false;
+  rand_state = 0;
   last_issue = 0;
   program_counter = 0;
   next_program_counter = 1;
@@ -213,6 +220,7 @@ ThreadState::ThreadState(SimpleRegisterFile* regs,
   instructions_in_flight = 0;
   instructions_issued = 0;
   end_sleep_cycle = -1;
+  register_banks = NULL;
 
   fetched_instruction = NULL;
   issued_this_cycle = NULL;
@@ -237,6 +245,9 @@ void ThreadState::Reset()
   fetched_instruction = NULL;
   issued_this_cycle = NULL;
   end_sleep_cycle = -1;
+  sync_wake_cycle = -1;
+  sync_granted = false;
+  rand_state = 0;
   write_requests.clear();
   for (int i = 0; i < registers->num_registers; i++) {
     register_ready[i] = 0;
@@ -350,6 +361,8 @@ void ThreadState::ApplyWrites(long long int cur_cycle) {
 	registers->WriteIntMSA(request->which_reg + (registers->num_registers * 2), request->idataMSA[1], request->ready_cycle);
 	registers->WriteIntMSA(request->which_reg + (registers->num_registers * 3), request->idataMSA[2], request->ready_cycle);
       }
+    if (register_banks)
+      register_banks->Write(request->which_reg, request->ready_cycle);
     writes_in_flight[request->which_reg]--;
     write_requests.pop();
     request = write_requests.front();
@@ -7,6 +7,7 @@
 #include "Instruction.h"
 #include "SimpleRegisterFile.h"
 #include "Profiler.h"
+#include "RegisterBanks.h"
 
 
 class Instruction;
@@ -23,6 +24,8 @@ class WriteQueue {
   int size();
   void pop();
   bool empty();
+  // Is there room to push this many more requests
+  bool HasRoom(int writes);
   bool update(ThreadState* thread, int which_reg, long long int which_cycle, unsigned int val, long long new_cycle, unsigned int new_val, Instruction::Opcode new_op, Instruction* new_instr);
   bool updateMSA(ThreadState* thread, int which_reg, long long int which_cycle, reg_value val, long long new_cycle, reg_value new_val, Instruction::Opcode new_op, Instruction* new_instr);
   bool CycleUsed(long long int cycle);
@@ -86,6 +89,9 @@ public:
   int* writes_in_flight;
   // end new write queue
 
+  // the thread processor's register banks (RFBANKS), NULL if not modeled
+  RegisterBanks* register_banks;
+
 
   Instruction* fetched_instruction;
   Instruction* last_issued;
@@ -95,6 +101,12 @@ public:
   
   int instructions_in_flight;
   int sleep_cycles;
+  // blocked on a BARRIER or SEM_ACQ (SYNCWAKE line): the cycle a release
+  // wakes it (-1 when not blocked), and whether it was handed the semaphore
+  long long int sync_wake_cycle;
+  bool sync_granted;
+  // RAND's generator state (RNG line), 0 until the first RAND seeds it
+  unsigned long long rand_state;
   long long int last_issue;
   bool halted;
   
@@ -0,0 +1,426 @@
+#include "TraversalUnit.h"
+#include "IssueUnit.h"
+#include "L1Cache.h"
+#include "L2Cache.h"
+#include "SimpleRegisterFile.h"
+#include "ThreadState.h"
+#include "WriteRequest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// first ray register, see ReadyToIssue
+#define RAY_INPUT_REG 36
+// words per triangle, as BVH::LoadTriangles lays them out
+#define TRIANGLE_WORDS 11
+// fetcher registers: 1 holds the address, lines are loaded into the rest
+#define FETCH_ADDRESS_REG 1
+#define FETCH_FIRST_REG 2
+#define FETCH_REGS 16
+// give up on BVHs that loop
+#define MAX_STEPS (1 << 22)
+
+static std::vector<Instruction*> no_instructions;
+
+TraversalUnit::TraversalUnit(int _rays_in_flight, int _stack_depth, int _node_size,
+                             int _box_latency, int _triangle_latency) :
+  FunctionalUnit(_box_latency), rays_in_flight(_rays_in_flight), stack_depth(_stack_depth),
+  node_size(_node_size), box_latency(_box_latency), triangle_latency(_triangle_latency)
+{
+  if (rays_in_flight < 1 || stack_depth < 1 || node_size < 8 ||
+      box_latency < 1 || triangle_latency < 1) {
+    printf("ERROR: TRAVERSAL needs at least 1 ray in flight, a stack depth of at least 1, a node size of at least 8 and latencies of at least 1 (%d, %d, %d, %d, %d)\n",
+           rays_in_flight, stack_depth, node_size, box_latency, triangle_latency);
+    exit(1);
+  }
+  visit_energy = 0;
+  issuer = NULL;
+  L1 = NULL;
+  line_words = 1;
+  active = 0;
+
+  slots.resize(rays_in_flight);
+  for (int i = 0; i < rays_in_flight; i++) {
+    slots[i].thread = NULL;
+    slots[i].fetcher = new ThreadState(new SimpleRegisterFile(FETCH_REGS, -1), no_instructions, 0, 0);
+  }
+  for (int i = 0; i < FETCH_REGS; i++)
+    loads.push_back(new Instruction(Instruction::LOAD, i, FETCH_ADDRESS_REG, 0, 0));
+  Reset();
+}
+
+TraversalUnit::~TraversalUnit()
+{
+  for (size_t i = 0; i < slots.size(); i++)
+    delete slots[i].fetcher;
+  for (size_t i = 0; i < loads.size(); i++)
+    delete loads[i];
+}
+
+void TraversalUnit::Connect(IssueUnit* _issuer, L1Cache* _L1)
+{
+  issuer = _issuer;
+  L1 = _L1;
+  line_words = 1 << L1->line_size;
+  if ((node_size + line_words - 1) / line_words + 1 > FETCH_REGS - FETCH_FIRST_REG ||
+      (TRIANGLE_WORDS + line_words - 1) / line_words + 1 > FETCH_REGS - FETCH_FIRST_REG) {
+    printf("ERROR: TRAVERSAL nodes or triangles span too many L1 lines\n");
+    exit(1);
+  }
+}
+
+// From FunctionalUnit
+bool TraversalUnit::SupportsOp(Instruction::Opcode op) const
+{
+  return op == Instruction::TRAVERSE;
+}
+
+bool TraversalUnit::AcceptInstruction(Instruction& ins, IssueUnit* _issuer, ThreadState* thread)
+{
+  if (active == rays_in_flight)
+    return false;
+  if (ins.args[0] + 1 >= thread->registers->num_registers) {
+    printf("ERROR: TRAVERSE writes 2 registers from %d, past the last register\n", ins.args[0]);
+    exit(1);
+  }
+
+  // both results are queued or neither is, a ray whose distance is queued
+  // without its triangle would never complete
+  if (!thread->write_requests.HasRoom(2))
+    return false;
+
+  long long int cycle = issuer->current_cycle;
+  Instruction::Opcode failop = Instruction::NOP;
+  reg_value root;
+  float in[7];
+  if (!thread->ReadRegister(ins.args[1], cycle, root, failop))
+    printf("TRAVERSE unit: Error in Accepting instruction. Should have passed.\n");
+  for (int i = 0; i < 7; i++) {
+    reg_value arg;
+    if (!thread->ReadRegister(RAY_INPUT_REG + i, cycle, arg, failop))
+      printf("TRAVERSE unit: Error in Accepting instruction. Should have passed.\n");
+    in[i] = arg.fdata;
+  }
+
+  int slot = 0;
+  while (slots[slot].thread != NULL)
+    slot++;
+  Ray& ray = slots[slot];
+  Traverse(ray, root.idata, in);
+
+  // The results are known now, but not when they are ready, like a load
+  // waiting on DRAM
+  if (!thread->QueueWrite(ins.args[0], ray.distance, UNKNOWN_LATENCY, ins.op, &ins) ||
+      !thread->QueueWrite(ins.args[0] + 1, ray.triangle, UNKNOWN_LATENCY, ins.op, &ins)) {
+    printf("ERROR: TRAVERSE unit could not queue its results after checking for room\n");
+    exit(1);
+  }
+
+  ray.thread = thread;
+  ray.ins = &ins;
+  ray.dst = ins.args[0];
+  ray.start_cycle = cycle;
+  ray.step = 0;
+  ray.next_line = 0;
+  ray.num_lines = -1;
+  ray.testing = false;
+  ray.fetcher->thread_id = thread->thread_id;
+  ray.fetcher->core_id = thread->core_id;
+  active++;
+  return true;
+}
+
+void TraversalUnit::Traverse(Ray& ray, int root, const float* in)
+{
+  const float* org = in;
+  const float* dir = in + 3;
+  float closest = in[6];
+  float inv_dir[3];
+  for (int i = 0; i < 3; i++)
+    inv_dir[i] = dir[i] != 0.f ? 1.f / dir[i] : 1e30f;
+  int hit = -1;
+
+  FourByte* data = L1->data;
+  ray.steps.clear();
+  std::vector<Step> stack;
+  Step entry;
+  entry.address = root;
+  entry.triangle = false;
+  entry.spilled = false;
+  stack.push_back(entry);
+  while (!stack.empty()) {
+    Step node = stack.back();
+    stack.pop_back();
+    if (node.address < 0 || node.address + node_size > L1->num_blocks) {
+      printf("ERROR: TRAVERSE read a node at address %d (not in [0, %d])\n", node.address, L1->num_blocks);
+      exit(1);
+    }
+    ray.steps.push_back(node);
+    node_fetches++;
+    if (ray.steps.size() > MAX_STEPS) {
+      printf("ERROR: TRAVERSE visited more than %d nodes, the BVH at %d must have a cycle\n", MAX_STEPS, root);
+      exit(1);
+    }
+    if (BoxDistance(node.address, org, inv_dir, closest) < 0)
+      continue;
+
+    // the child count shares its word with the split axis or treelet
+    // pointer, its low byte is -1 for interior nodes
+    int num_children = (signed char)(data[node.address + 6].uvalue & 0xff);
+    int child = data[node.address + 7].ivalue;
+    if (num_children >= 0) {
+      // a leaf, child is the address of its first triangle
+      for (int i = 0; i < num_children; i++) {
+	Step tri;
+	tri.address = child + i * TRIANGLE_WORDS;
+	tri.triangle = true;
+	tri.spilled = false;
+	if (tri.address < 0 || tri.address + TRIANGLE_WORDS > L1->num_blocks) {
+	  printf("ERROR: TRAVERSE read a triangle at address %d (not in [0, %d])\n", tri.address, L1->num_blocks);
+	  exit(1);
+	}
+	ray.steps.push_back(tri);
+	triangle_fetches++;
+	float t = TriangleDistance(tri.address, org, dir);
+	if (t > 0 && t < closest) {
+	  closest = t;
+	  hit = tri.address;
+	}
+      }
+      continue;
+    }
+
+    // push the second child first so the first is visited first
+    for (int i = 1; i >= 0; i--) {
+      entry.address = root + (child + i) * node_size;
+      entry.spilled = (int)stack.size() >= stack_depth;
+      if (entry.spilled)
+	stack_spills++;
+      stack.push_back(entry);
+    }
+    if ((long long int)stack.size() > max_stack)
+      max_stack = stack.size();
+  }
+
+  ray.distance.fdata = hit >= 0 ? closest : -1.f;
+  ray.triangle.idata = hit;
+  if (hit >= 0)
+    hits++;
+}
+
+// Slab test against the node's box, -1 if it misses or starts past t_max
+float TraversalUnit::BoxDistance(int address, const float* org, const float* inv_dir, float t_max) const
+{
+  FourByte* data = L1->data;
+  float t_near = 0.f;
+  float t_far = t_max;
+  for (int axis = 0; axis < 3; axis++) {
+    float t0 = (data[address + axis].fvalue - org[axis]) * inv_dir[axis];
+    float t1 = (data[address + 3 + axis].fvalue - org[axis]) * inv_dir[axis];
+    if (t0 > t1) {
+      float temp = t0;
+      t0 = t1;
+      t1 = temp;
+    }
+    if (t0 > t_near)
+      t_near = t0;
+    if (t1 < t_far)
+      t_far = t1;
+  }
+  return t_near > t_far ? -1.f : t_near;
+}
+
+// Moller-Trumbore, -1 on a miss
+float TraversalUnit::TriangleDistance(int address, const float* org, const float* dir) const
+{
+  FourByte* data = L1->data;
+  float p0[3], edge1[3], edge2[3], tvec[3], pvec[3], qvec[3];
+  for (int i = 0; i < 3; i++) {
+    p0[i] = data[address + i].fvalue;
+    edge1[i] = data[address + 3 + i].fvalue - p0[i];
+    edge2[i] = data[address + 6 + i].fvalue - p0[i];
+    tvec[i] = org[i] - p0[i];
+  }
+  pvec[0] = dir[1] * edge2[2] - dir[2] * edge2[1];
+  pvec[1] = dir[2] * edge2[0] - dir[0] * edge2[2];
+  pvec[2] = dir[0] * edge2[1] - dir[1] * edge2[0];
+  float det = edge1[0] * pvec[0] + edge1[1] * pvec[1] + edge1[2] * pvec[2];
+  if (det > -1e-12f && det < 1e-12f)
+    return -1.f;
+  float inv_det = 1.f / det;
+
+  float u = (tvec[0] * pvec[0] + tvec[1] * pvec[1] + tvec[2] * pvec[2]) * inv_det;
+  if (u < 0.f || u > 1.f)
+    return -1.f;
+  qvec[0] = tvec[1] * edge1[2] - tvec[2] * edge1[1];
+  qvec[1] = tvec[2] * edge1[0] - tvec[0] * edge1[2];
+  qvec[2] = tvec[0] * edge1[1] - tvec[1] * edge1[0];
+  float v = (dir[0] * qvec[0] + dir[1] * qvec[1] + dir[2] * qvec[2]) * inv_det;
+  if (v < 0.f || u + v > 1.f)
+    return -1.f;
+  float t = (edge2[0] * qvec[0] + edge2[1] * qvec[1] + edge2[2] * qvec[2]) * inv_det;
+  return t > 0.f ? t : -1.f;
+}
+
+void TraversalUnit::FinishRay(Ray& ray, long long int cycle)
+{
+  ray.thread->UpdateWriteCycle(ray.dst, UNKNOWN_LATENCY, ray.distance.udata, cycle + 1, Instruction::TRAVERSE);
+  ray.thread->UpdateWriteCycle(ray.dst + 1, UNKNOWN_LATENCY, ray.triangle.udata, cycle + 1, Instruction::TRAVERSE);
+  ray.thread->Wake(true);
+  ray.thread = NULL;
+  active--;
+
+  rays++;
+  ray_cycles += cycle + 1 - ray.start_cycle;
+  // the schedulers sleep threads waiting on TRAVERSE for this long
+  latency = (int)(ray_cycles / rays);
+}
+
+long long int TraversalUnit::NextEventCycle()
+{
+  // rays in flight are stepped every cycle
+  return active > 0 ? -1 : NO_EVENT_CYCLE;
+}
+
+void TraversalUnit::SkipCycles(long long int num_cycles)
+{
+  cycles += num_cycles;
+}
+
+// From HardwareModule
+void TraversalUnit::ClockRise()
+{
+}
+
+void TraversalUnit::ClockFall()
+{
+  cycles++;
+  if (active == 0)
+    return;
+  busy_slot_cycles += active;
+
+  long long int cycle = issuer->current_cycle;
+  for (size_t i = 0; i < slots.size(); i++) {
+    Ray& ray = slots[i];
+    if (ray.thread == NULL)
+      continue;
+    ray.fetcher->ApplyWrites(cycle);
+
+    if (ray.testing) {
+      if (cycle < ray.test_done)
+	continue;
+      ray.testing = false;
+      ray.step++;
+      ray.num_lines = -1;
+      if (ray.step == ray.steps.size()) {
+	FinishRay(ray, cycle);
+	continue;
+      }
+    }
+
+    Step& step = ray.steps[ray.step];
+    int words = step.triangle ? TRIANGLE_WORDS : node_size;
+    int first_line = step.address >> L1->line_size;
+    if (ray.num_lines < 0) {
+      ray.num_lines = ((step.address + words - 1) >> L1->line_size) - first_line + 1;
+      ray.next_line = 0;
+    }
+
+    // request the step's lines one a cycle
+    if (ray.next_line < ray.num_lines) {
+      int address = (first_line + ray.next_line) << L1->line_size;
+      if (address < step.address)
+	address = step.address;
+      ray.fetcher->registers->WriteInt(FETCH_ADDRESS_REG, address, cycle);
+      long long int hits_before = L1->hits + L1->nearby_hits;
+      if (L1->Access(*loads[FETCH_FIRST_REG + ray.next_line], issuer, ray.fetcher, false)) {
+	L1_requests++;
+	L1_hits += L1->hits + L1->nearby_hits - hits_before;
+	ray.next_line++;
+      }
+      else
+	L1_stalls++;
+      continue;
+    }
+
+    // test once they are all in
+    bool arrived = true;
+    for (int line = 0; line < ray.num_lines; line++)
+      if (ray.fetcher->register_ready[FETCH_FIRST_REG + line] > cycle)
+	arrived = false;
+    if (!arrived)
+      continue;
+    ray.testing = true;
+    ray.test_done = cycle + (step.triangle ? triangle_latency : box_latency);
+    if (step.spilled)
+      ray.test_done += L1->hit_latency;
+  }
+}
+
+void TraversalUnit::print()
+{
+  printf("%d rays in flight", active);
+}
+
+double TraversalUnit::Utilization()
+{
+  return static_cast<double>(active) / static_cast<double>(rays_in_flight);
+}
+
+double TraversalUnit::Energy()
+{
+  return visit_energy * (node_fetches + triangle_fetches);
+}
+
+void TraversalUnit::Reset()
+{
+  rays = 0;
+  ray_cycles = 0;
+  hits = 0;
+  node_fetches = 0;
+  triangle_fetches = 0;
+  stack_spills = 0;
+  max_stack = 0;
+  L1_requests = 0;
+  L1_hits = 0;
+  L1_stalls = 0;
+  busy_slot_cycles = 0;
+  cycles = 0;
+}
+
+void TraversalUnit::AddStats(TraversalUnit* other)
+{
+  rays += other->rays;
+  ray_cycles += other->ray_cycles;
+  hits += other->hits;
+  node_fetches += other->node_fetches;
+  triangle_fetches += other->triangle_fetches;
+  stack_spills += other->stack_spills;
+  if (other->max_stack > max_stack)
+    max_stack = other->max_stack;
+  L1_requests += other->L1_requests;
+  L1_hits += other->L1_hits;
+  L1_stalls += other->L1_stalls;
+  busy_slot_cycles += other->busy_slot_cycles;
+  cycles += other->cycles;
+}
+
+void TraversalUnit::PrintStats(int num_units, long long int cycle_count)
+{
+  // 1GHz, like the bandwidth numbers
+  double seconds = cycle_count / 1000000000.;
+  printf(" TRAVERSAL: %d rays in flight, stack depth %d, node size %d, box latency %d, triangle latency %d\n",
+         rays_in_flight, stack_depth, node_size, box_latency, triangle_latency);
+  printf("   rays: %lld, hits: %lld (%.2f%%), rays/second: %.0f\n", rays, hits,
+         rays > 0 ? 100. * hits / rays : 0., seconds > 0 ? rays / seconds : 0.);
+  printf("   average cycles per ray: %.2f, rays in flight: %.2f%% of slots\n",
+         rays > 0 ? (double)ray_cycles / rays : 0.,
+         cycles > 0 ? 100. * busy_slot_cycles / ((double)cycles * rays_in_flight) : 0.);
+  printf("   node fetches per ray: %.2f, triangle fetches per ray: %.2f\n",
+         rays > 0 ? (double)node_fetches / rays : 0., rays > 0 ? (double)triangle_fetches / rays : 0.);
+  printf("   stack spills: %lld, deepest stack: %lld\n", stack_spills, max_stack);
+  printf("   L1 line requests: %lld (%.2f per ray), hits: %lld (%.2f%%), bank/L2 stalls: %lld\n",
+         L1_requests, rays > 0 ? (double)L1_requests / rays : 0., L1_hits,
+         L1_requests > 0 ? 100. * L1_hits / L1_requests : 0., L1_stalls);
+  printf("   area (mm2): %f, energy (J): %f\n", GetArea() * num_units, Energy() / 1000000000.f);
+}
@@ -0,0 +1,132 @@
+#ifndef _SIMHWRT_TRAVERSAL_UNIT_H_
+#define _SIMHWRT_TRAVERSAL_UNIT_H_
+
+// A fixed function BVH traversal unit (one per TM), set up by a TRAVERSAL
+// line in the config file:
+//
+//   TRAVERSAL <rays in flight> <stack depth> <node size> <box test latency> <triangle test latency> <area mm^2 (optional)> <energy per node or triangle nJ (optional)>
+//
+// TRAVERSE rd, rs traverses the BVH whose root node is at address rs with
+// the ray in r36-38 (origin), r39-41 (direction) and r42 (max distance).
+// It writes the closest hit distance to rd and the hit triangle's address
+// to rd+1 (both -1 on a miss) once the traversal is done.
+//
+// Nodes are <node size> words apart (8, or 10 with BVH subtrees), as the
+// BVH loader lays them out: box min, box max, the child count (-1 for an
+// interior node) and the first child (a node index for interior nodes, the
+// triangle address for leaves). Triangles are 11 words, p0 p1 p2 first.
+//
+// Each ray visits its nodes and triangles in turn, fetching each one's
+// cache lines through the TM's L1 (competing with the threads' loads for
+// banks) and testing it once they arrive. Up to <rays in flight> rays are
+// traversed at once. Stack entries past <stack depth> spill, and cost an
+// extra L1 hit latency when they are popped.
+//
+// The issuing thread waits on rd like on a load, and the unit's latency
+// (which the thread schedulers use to put stalled threads to sleep) is the
+// average time a ray has taken so far. The thread is woken when its ray is
+// done.
+
+#include "FunctionalUnit.h"
+#include "Instruction.h"
+#include "SimpleRegisterFile.h"
+#include <vector>
+
+class IssueUnit;
+class L1Cache;
+class ThreadState;
+
+class TraversalUnit : public FunctionalUnit {
+ public:
+  TraversalUnit(int rays_in_flight, int stack_depth, int node_size,
+                int box_latency, int triangle_latency);
+  ~TraversalUnit();
+
+  // The TM's issue unit and L1, set once the TM is built
+  void Connect(IssueUnit* issuer, L1Cache* L1);
+
+  // From FunctionalUnit
+  virtual bool SupportsOp(Instruction::Opcode op) const;
+  virtual bool AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState* thread);
+  virtual long long int NextEventCycle();
+  virtual void SkipCycles(long long int num_cycles);
+
+  // From HardwareModule
+  virtual void ClockRise();
+  virtual void ClockFall();
+  virtual void print();
+  virtual double Utilization();
+
+  void Reset();
+  void AddStats(TraversalUnit* other);
+  // nJ for every node and triangle visited
+  double Energy();
+  // num_units is the number of TMs summed into this one
+  void PrintStats(int num_units, long long int cycles);
+
+  int rays_in_flight;
+  int stack_depth;
+  int node_size;
+  int box_latency;
+  int triangle_latency;
+  // nJ per node or triangle visited
+  float visit_energy;
+
+  long long int rays;
+  long long int ray_cycles;
+  long long int hits;
+  long long int node_fetches;
+  long long int triangle_fetches;
+  long long int stack_spills;
+  long long int max_stack;
+  // L1 line requests made, and how many hit
+  long long int L1_requests;
+  long long int L1_hits;
+  // requests the L1 turned away (bank conflict, L2 stall)
+  long long int L1_stalls;
+  // ray slots in use, summed over cycles
+  long long int busy_slot_cycles;
+  long long int cycles;
+
+ private:
+  // A node or triangle a ray visits
+  struct Step {
+    int address;
+    bool triangle;
+    bool spilled;
+  };
+
+  struct Ray {
+    ThreadState* thread;    // NULL if the slot is free
+    Instruction* ins;
+    int dst;
+    reg_value distance;
+    reg_value triangle;
+    long long int start_cycle;
+    std::vector<Step> steps;
+    size_t step;
+    // lines of the current step still to request, and when its test is done
+    int next_line;
+    int num_lines;
+    bool testing;
+    long long int test_done;
+    // fetches go through the L1 as loads from this private register context
+    ThreadState* fetcher;
+  };
+
+  // Run the traversal functionally, filling in ray's steps and results
+  void Traverse(Ray& ray, int root, const float* in);
+  void FinishRay(Ray& ray, long long int cycle);
+  float BoxDistance(int address, const float* org, const float* inv_dir, float t_max) const;
+  float TriangleDistance(int address, const float* org, const float* dir) const;
+
+  IssueUnit* issuer;
+  L1Cache* L1;
+  int line_words;
+  std::vector<Ray> slots;
+  int active;
+  // a LOAD into each of the fetcher registers
+  std::vector<Instruction*> loads;
+};
+
+#endif // _SIMHWRT_TRAVERSAL_UNIT_H_
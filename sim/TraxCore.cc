@@ -1,13 +1,137 @@
 #include <vector>
+#include <typeinfo>
 
+#include "Bitwise.h"
+#include "BranchUnit.h"
+#include "ConversionUnit.h"
+#include "FPAddSub.h"
+#include "FPCompare.h"
+#include "FPDiv.h"
+#include "FPInvSqrt.h"
+#include "FPMinMax.h"
+#include "FPMul.h"
 #include "FunctionalUnit.h"
+#include "IntAddSub.h"
+#include "IntMul.h"
 #include "IssueUnit.h"
 #include "L1Cache.h"
 #include "L2Cache.h"
 #include "SimpleRegisterFile.h"
+#include "Synchronize.h"
 #include "ThreadState.h"
 #include "TraxCore.h"
 
+// Type-batched clocking.
+//
+// Most of a core's modules are functional units whose clock does nothing
+// but clear their issued_this_cycle count (results are computed and queued
+// at issue), plus one register file per thread processor, whose clock also
+// counts the cycle. None of them touches another module on the clock, so
+// instead of two virtual calls per module per cycle, interleaved across
+// types, they are collected by concrete type and clocked one type at a
+// time with the call bound at compile time. A functional unit nothing
+// issued to is not clocked at all.
+//
+// Everything else (L1, issue unit, the global register file shared by all
+// cores, and any type not listed in ModuleGroups) is clocked through
+// HardwareModule in its original order, after the groups. The issue unit
+// stays last on both edges, so as before every unit has been cleared by
+// the time it issues.
+
+// Whether a grouped module has anything to do on the clock
+template <class Unit>
+inline bool ModuleBusy(Unit* unit) { return unit->issued_this_cycle != 0; }
+template <>
+inline bool ModuleBusy(SimpleRegisterFile* unit) { return true; }
+template <>
+inline bool ModuleBusy(DebugUnit* unit) { return false; }
+
+template <class Unit>
+struct ModuleGroup {
+  std::vector<Unit*> units;
+
+  // Takes modules of exactly this type (not subclasses)
+  bool Claim(HardwareModule* module) {
+    if (typeid(*module) != typeid(Unit))
+      return false;
+    units.push_back(static_cast<Unit*>(module));
+    return true;
+  }
+  inline void ClockRise() {
+    for (size_t i = 0; i < units.size(); i++)
+      if (ModuleBusy(units[i]))
+	units[i]->Unit::ClockRise();
+  }
+  inline void ClockFall() {
+    for (size_t i = 0; i < units.size(); i++)
+      if (ModuleBusy(units[i]))
+	units[i]->Unit::ClockFall();
+  }
+};
+
+struct ModuleGroups {
+  ModuleGroup<FPAddSub> fp_addsub;
+  ModuleGroup<FPMinMax> fp_minmax;
+  ModuleGroup<FPCompare> fp_compare;
+  ModuleGroup<IntAddSub> int_addsub;
+  ModuleGroup<FPMul> fp_mul;
+  ModuleGroup<FPInvSqrt> fp_invsqrt;
+  ModuleGroup<FPDiv> fp_div;
+  ModuleGroup<IntMul> int_mul;
+  ModuleGroup<ConversionUnit> converter;
+  ModuleGroup<BranchUnit> branch;
+  ModuleGroup<Bitwise> bitwise;
+  ModuleGroup<DebugUnit> debug;
+  ModuleGroup<Synchronize> sync;
+  ModuleGroup<LocalStore> local_store;
+  ModuleGroup<SimpleRegisterFile> register_files;
+
+  bool Claim(HardwareModule* module) {
+    return fp_addsub.Claim(module) || fp_minmax.Claim(module) ||
+      fp_compare.Claim(module) || int_addsub.Claim(module) ||
+      fp_mul.Claim(module) || fp_invsqrt.Claim(module) ||
+      fp_div.Claim(module) || int_mul.Claim(module) ||
+      converter.Claim(module) || branch.Claim(module) ||
+      bitwise.Claim(module) || debug.Claim(module) ||
+      sync.Claim(module) || local_store.Claim(module) ||
+      register_files.Claim(module);
+  }
+  void ClockRise() {
+    fp_addsub.ClockRise();
+    fp_minmax.ClockRise();
+    fp_compare.ClockRise();
+    int_addsub.ClockRise();
+    fp_mul.ClockRise();
+    fp_invsqrt.ClockRise();
+    fp_div.ClockRise();
+    int_mul.ClockRise();
+    converter.ClockRise();
+    branch.ClockRise();
+    bitwise.ClockRise();
+    debug.ClockRise();
+    sync.ClockRise();
+    local_store.ClockRise();
+    register_files.ClockRise();
+  }
+  void ClockFall() {
+    fp_addsub.ClockFall();
+    fp_minmax.ClockFall();
+    fp_compare.ClockFall();
+    int_addsub.ClockFall();
+    fp_mul.ClockFall();
+    fp_invsqrt.ClockFall();
+    fp_div.ClockFall();
+    int_mul.ClockFall();
+    converter.ClockFall();
+    branch.ClockFall();
+    bitwise.ClockFall();
+    debug.ClockFall();
+    sync.ClockFall();
+    local_store.ClockFall();
+    register_files.ClockFall();
+  }
+};
+
 TraxCore::TraxCore(int _num_thread_procs, int _threads_per_proc, int _num_regs,
 		   ThreadProcessor::SchedulingScheme ss, std::vector<Instruction*>* _instructions, 
 		   L2Cache* _L2, size_t coreid, size_t l2id, bool _enable_profiling, 
@@ -23,10 +147,13 @@ TraxCore::TraxCore(int _num_thread_procs, int _threads_per_proc, int _num_regs,
   schedule = ss;
   core_id = coreid;
   l2_id = l2id;
+  module_groups = NULL;
+  traversal_unit = NULL;
 }
 
 TraxCore::~TraxCore(){
   size_t i;
+  delete module_groups;
   delete issuer;
   for(i=0; i<thread_procs.size(); i++){
     delete thread_procs[i];
@@ -48,6 +175,16 @@ void TraxCore::initialize(const char* icache_params_file, int issue_verbosity,
 
   functional_units.push_back(dynamic_cast<FunctionalUnit*>(L1));
   issuer = new IssueUnit(icache_params_file, thread_procs, functional_units, issue_verbosity, num_icaches, icache_banks, simd_width, enable_profiling, profiler, debugger);
+  if (icache_params.enabled)
+    issuer->EnableICacheModel(icache_params, icache_params_file);
+  if (issue_params.enabled)
+    issuer->EnableIssueRules(issue_params);
+  if (register_bank_params.enabled)
+    issuer->EnableRegisterBanks(register_bank_params);
+  if (treelet_params.enabled)
+    issuer->EnableTreeletScheduler(treelet_params, L2->mem);
+  if (traversal_unit)
+    traversal_unit->Connect(issuer, L1);
   modules.push_back(issuer);
   module_names.push_back(std::string("IssueLogic"));
 
@@ -73,6 +210,7 @@ void TraxCore::initialize(const char* icache_params_file, int issue_verbosity,
     utilizations.push_back(0.0);
   }
 
+  GroupModules();
   cycle_num = 0;
 
 }
@@ -85,6 +223,10 @@ void TraxCore::Reset()
     thread_procs[i]->Reset();
   issuer->Reset();
   L1->Reset();
+  for (size_t i = 0; i < intersection_units.size(); i++)
+    intersection_units[i]->Reset();
+  if (traversal_unit)
+    traversal_unit->Reset();
 }
 
 
@@ -110,6 +252,47 @@ long long int TraxCore::CountStalls() {
   return stall_cycles;
 }
 
+void TraxCore::GroupModules() {
+  delete module_groups;
+  module_groups = new ModuleGroups;
+  ungrouped_modules.clear();
+  for (size_t i = 0; i < modules.size(); i++)
+    if (!module_groups->Claim(modules[i]))
+      ungrouped_modules.push_back(modules[i]);
+}
+
+void TraxCore::ClockRise() {
+  module_groups->ClockRise();
+  for (size_t i = 0; i < ungrouped_modules.size(); i++)
+    ungrouped_modules[i]->ClockRise();
+}
+
+void TraxCore::ClockFall() {
+  module_groups->ClockFall();
+  for (size_t i = 0; i < ungrouped_modules.size(); i++)
+    ungrouped_modules[i]->ClockFall();
+}
+
+long long int TraxCore::NextEventCycle() {
+  long long int next_cycle = NO_EVENT_CYCLE;
+  for (size_t i = 0; i < modules.size(); i++) {
+    long long int module_next = modules[i]->NextEventCycle();
+    if (module_next < 0)
+      return -1;
+    if (module_next < next_cycle)
+      next_cycle = module_next;
+  }
+  return next_cycle;
+}
+
+void TraxCore::SkipCycles(long long int num_cycles) {
+  for (size_t i = 0; i < modules.size(); i++) {
+    modules[i]->SkipCycles(num_cycles);
+    utilizations[i] += num_cycles * modules[i]->Utilization();
+  }
+  cycle_num += num_cycles;
+}
+
 // This function is for stats-tracking only.
 // We will use one core to hold the sums of all other cores' stats
 void TraxCore::AddStats(TraxCore* otherCore)
@@ -124,4 +307,10 @@ void TraxCore::AddStats(TraxCore* otherCore)
   // L1 cache stats
   L1->AddStats(otherCore->L1);
 
+  // Intersection pipeline stats
+  for (size_t i = 0; i < intersection_units.size(); i++)
+    intersection_units[i]->AddStats(otherCore->intersection_units[i]);
+  if (traversal_unit)
+    traversal_unit->AddStats(otherCore->traversal_unit);
+
 }
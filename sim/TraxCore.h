@@ -10,6 +10,12 @@
 #include "LocalStore.h"
 #include "Profiler.h"
 #include "Debugger.h"
+#include "InstructionCache.h"
+#include "IntersectionUnit.h"
+#include "IssueRules.h"
+#include "RegisterBanks.h"
+#include "TraversalUnit.h"
+#include "TreeletScheduler.h"
 #include <pthread.h>
 
 class Instruction;
@@ -19,6 +25,7 @@ class IssueUnit;
 class OldIssueUnit;
 class L2Cache;
 class L1Cache;
+struct ModuleGroups;
 
 // A single Trax core
 class TraxCore {
@@ -39,9 +46,23 @@ public:
   void SetSymbols(std::vector<symbol*> *regs);
   void AddStats(TraxCore* otherCore);
 
+  // Sort the modules into groups by concrete type, called by initialize()
+  // once every module has been added
+  void GroupModules();
+  // Clock every module for one cycle, same as calling ClockRise (then
+  // ClockFall) on each of modules in order
+  void ClockRise();
+  void ClockFall();
+
   // count thread stalls for fairness
   long long int CountStalls();
 
+  // Cycle skipping: the earliest cycle any module can change state, and
+  // advancing every module (and the stats tracked per cycle) over cycles
+  // before that in one step
+  long long int NextEventCycle();
+  void SkipCycles(long long int num_cycles);
+
   //data members...
   bool enable_profiling;
   Profiler* profiler;
@@ -73,6 +94,23 @@ public:
   std::vector<double> utilizations;
   std::vector<std::string> module_names;
   std::vector<FunctionalUnit*> functional_units;
+  // BOXPIPE and TRIPIPE units, also in functional_units
+  std::vector<IntersectionUnit*> intersection_units;
+  // the TRAVERSAL unit, NULL if there isn't one
+  TraversalUnit* traversal_unit;
+
+  // modules not in a type group, clocked through HardwareModule in order
+  std::vector<HardwareModule*> ungrouped_modules;
+  ModuleGroups* module_groups;
+
+  // from an ICACHE line in the config, passed on to the IssueUnit
+  InstructionCacheParams icache_params;
+  // from ISSUE and PAIR lines
+  IssueParams issue_params;
+  // from an RFBANKS line
+  RegisterBankParams register_bank_params;
+  // from a TREELETS line
+  TreeletParams treelet_params;
 
   // memory is going to be a little tricky
   MemoryBase* memory;
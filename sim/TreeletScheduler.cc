@@ -0,0 +1,209 @@
+#include "TreeletScheduler.h"
+#include "Instruction.h"
+#include "MainMemory.h"
+#include "ThreadState.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+
+TreeletScheduler::TreeletScheduler(const TreeletParams& params, MainMemory* _memory) :
+  active_treelets(params.active_treelets), idle_cycles(params.idle_cycles),
+  treelet_words(params.treelet_words), memory(_memory), found_nodes(false)
+{
+  if (active_treelets < 1 || idle_cycles < 1 || treelet_words < 0) {
+    printf("ERROR: TREELETS needs at least 1 active treelet and at least 1 idle cycle (%d, %d)\n",
+           active_treelets, idle_cycles);
+    exit(1);
+  }
+  Reset();
+}
+
+void TreeletScheduler::FindNodes()
+{
+  // see the header LoadMemory writes
+  FourByte* data = memory->getData();
+  start_nodes = data[8].ivalue;
+  num_nodes = data[21].ivalue;
+  int num_subtrees = data[34].ivalue;
+  use_subtrees = treelet_words == 0;
+  // nodes carry their parent and subtree when there are subtrees
+  node_size = num_subtrees > 0 ? 10 : 8;
+  if (num_nodes > 0 && use_subtrees && num_subtrees <= 0) {
+    printf("ERROR: TREELETS without a treelet size needs a BVH built with --subtree-size\n");
+    exit(1);
+  }
+  found_nodes = true;
+}
+
+int TreeletScheduler::NodeTreelet(int node)
+{
+  if (use_subtrees)
+    return memory->getData()[start_nodes + node * node_size + 9].ivalue;
+  return node * node_size / treelet_words;
+}
+
+bool TreeletScheduler::IsActive(int treelet)
+{
+  return std::find(active.begin(), active.end(), treelet) != active.end();
+}
+
+void TreeletScheduler::Park(ThreadTreelet& state, int treelet, long long int cycle)
+{
+  // leaving the treelet it was in
+  if (state.treelet >= 0)
+    residents[state.treelet]--;
+  state.treelet = -1;
+  state.parked = treelet;
+  state.park_cycle = cycle;
+  int depth = ++queued[treelet];
+  parks[treelet]++;
+  if (depth > max_depth[treelet])
+    max_depth[treelet] = depth;
+}
+
+void TreeletScheduler::Unpark(ThreadTreelet& state, long long int cycle)
+{
+  queued[state.parked]--;
+  parked_cycles += cycle - state.park_cycle;
+  state.parked = -1;
+}
+
+void TreeletScheduler::Join(ThreadTreelet& state, int treelet)
+{
+  if (state.treelet == treelet)
+    return;
+  if (state.treelet >= 0)
+    residents[state.treelet]--;
+  residents[treelet]++;
+  state.treelet = treelet;
+}
+
+void TreeletScheduler::UpdateActive(long long int cycle)
+{
+  for (size_t i = 0; i < active.size(); ) {
+    int treelet = active[i];
+    if ((residents[treelet] <= 0 && queued[treelet] <= 0) ||
+        cycle - last_use[treelet] > idle_cycles)
+      active.erase(active.begin() + i);
+    else
+      i++;
+  }
+
+  while ((int)active.size() < active_treelets) {
+    int deepest = -1;
+    for (std::map<int, int>::iterator it = queued.begin(); it != queued.end(); ++it)
+      if (it->second > 0 && !IsActive(it->first) &&
+          (deepest < 0 || it->second > queued[deepest]))
+        deepest = it->first;
+    if (deepest < 0)
+      break;
+    active.push_back(deepest);
+    last_use[deepest] = cycle;
+    activations++;
+  }
+}
+
+bool TreeletScheduler::MayIssue(ThreadState* thread, Instruction* ins, long long int cycle)
+{
+  if (ins->op != Instruction::LOAD)
+    return true;
+  if (!found_nodes)
+    FindNodes();
+
+  // the operands are ready by now
+  reg_value arg;
+  Instruction::Opcode failop = Instruction::NOP;
+  thread->ReadRegister(ins->args[1], cycle, arg, failop);
+  int address = arg.idata + ins->args[2];
+  if (num_nodes <= 0 || address < start_nodes || address >= start_nodes + num_nodes * node_size)
+    return true;
+  int node = (address - start_nodes) / node_size;
+  int treelet = NodeTreelet(node);
+
+  ThreadTreelet& state = threads[thread];
+  if (!IsActive(treelet)) {
+    if (state.parked != treelet)
+      Park(state, treelet, cycle);
+    UpdateActive(cycle);
+    if (!IsActive(treelet))
+      return false;
+  }
+
+  if (state.parked == treelet)
+    Unpark(state, cycle);
+  Join(state, treelet);
+  last_use[treelet] = cycle;
+  state.admitted = ins;
+  state.admitted_node = node;
+  return true;
+}
+
+void TreeletScheduler::Issued(ThreadState* thread, Instruction* ins)
+{
+  std::map<ThreadState*, ThreadTreelet>::iterator it = threads.find(thread);
+  if (it == threads.end() || it->second.admitted != ins)
+    return;
+  ThreadTreelet& state = it->second;
+  node_loads++;
+  if (state.admitted_node == 0 && state.node != 0)
+    rays++;
+  state.node = state.admitted_node;
+  state.admitted = NULL;
+}
+
+void TreeletScheduler::Reset()
+{
+  threads.clear();
+  active.clear();
+  last_use.clear();
+  residents.clear();
+  queued.clear();
+  parks.clear();
+  max_depth.clear();
+  rays = 0;
+  node_loads = 0;
+  activations = 0;
+  parked_cycles = 0;
+}
+
+void TreeletScheduler::AddStats(TreeletScheduler* other)
+{
+  rays += other->rays;
+  node_loads += other->node_loads;
+  activations += other->activations;
+  parked_cycles += other->parked_cycles;
+  for (std::map<int, long long int>::iterator it = other->parks.begin(); it != other->parks.end(); ++it)
+    parks[it->first] += it->second;
+  for (std::map<int, int>::iterator it = other->max_depth.begin(); it != other->max_depth.end(); ++it)
+    if (it->second > max_depth[it->first])
+      max_depth[it->first] = it->second;
+}
+
+void TreeletScheduler::Print(long long int cycles)
+{
+  printf(" TREELETS: %d active, retired after %d idle cycles, ", active_treelets, idle_cycles);
+  if (treelet_words > 0)
+    printf("%d word treelets\n", treelet_words);
+  else
+    printf("BVH subtrees\n");
+  printf("   rays: %lld, node loads: %lld (%.2f per ray), treelet activations: %lld\n",
+         rays, node_loads, rays > 0 ? static_cast<double>(node_loads) / rays : 0., activations);
+  printf("   thread*cycles parked: %lld (%.2f threads per cycle)\n", parked_cycles,
+         cycles > 0 ? static_cast<double>(parked_cycles) / cycles : 0.);
+
+  // the treelets whose queues got deepest
+  std::vector<std::pair<int, int> > deepest;
+  for (std::map<int, int>::iterator it = max_depth.begin(); it != max_depth.end(); ++it)
+    if (it->second > 0)
+      deepest.push_back(std::make_pair(-it->second, it->first));
+  std::sort(deepest.begin(), deepest.end());
+  long long int total_parks = 0;
+  for (std::map<int, long long int>::iterator it = parks.begin(); it != parks.end(); ++it)
+    total_parks += it->second;
+  printf("   treelets parked on: %d, parks: %lld (%.2f per treelet)\n", (int)deepest.size(), total_parks,
+         deepest.empty() ? 0. : static_cast<double>(total_parks) / deepest.size());
+  for (size_t i = 0; i < deepest.size() && i < 5; i++)
+    printf("   treelet %d: queue depth up to %d, %lld parks\n", deepest[i].second,
+           -deepest[i].first, parks[deepest[i].second]);
+}
@@ -0,0 +1,107 @@
+#ifndef _SIMHWRT_TREELET_SCHEDULER_H_
+#define _SIMHWRT_TREELET_SCHEDULER_H_
+
+// Treelet-aware thread scheduling, one per TM. Enabled by a TREELETS line
+// in the config file:
+//
+//   TREELETS <active treelets> <idle cycles> <treelet size in words (optional)>
+//
+// The BVH nodes are split into treelets: the subtrees the BVH was built
+// with (--subtree-size), or with a treelet size, blocks of that many words
+// of the node array. A thread whose next instruction is a LOAD from a
+// node in a treelet that isn't active is parked in that treelet's queue
+// and can't issue. Up to <active treelets> treelets are active at once,
+// so the threads working in them share the cached nodes. An active
+// treelet is retired once no thread is in it or waiting for it, or when
+// none of its nodes have been loaded for <idle cycles>, and the treelet
+// with the most threads parked takes its place.
+//
+// A thread is in the treelet it last loaded a node from until it parks
+// on another one. Each time a thread comes back to the root node (the
+// first one in the array) is counted as a new ray.
+
+#include <map>
+#include <stddef.h>
+#include <vector>
+
+class Instruction;
+class MainMemory;
+class ThreadState;
+
+// TREELETS config line parameters, stored on the TraxCore until the
+// IssueUnit is created
+struct TreeletParams {
+  bool enabled;
+  int active_treelets;
+  int idle_cycles;
+  int treelet_words;   // 0 to use the BVH's subtrees
+
+  TreeletParams() :
+    enabled(false), active_treelets(1), idle_cycles(1000), treelet_words(0)
+  {}
+};
+
+class TreeletScheduler {
+public:
+  TreeletScheduler(const TreeletParams& params, MainMemory* memory);
+
+  // False if thread has to stay parked instead of issuing ins
+  bool MayIssue(ThreadState* thread, Instruction* ins, long long int cycle);
+  // ins, which MayIssue let through, was issued
+  void Issued(ThreadState* thread, Instruction* ins);
+
+  void Reset();
+  void AddStats(TreeletScheduler* other);
+  // cycles is the length of the run, for the average queue depth
+  void Print(long long int cycles);
+
+  int active_treelets;
+  int idle_cycles;
+  int treelet_words;
+
+  long long int rays;
+  long long int node_loads;
+  long long int activations;
+  // thread*cycles spent parked
+  long long int parked_cycles;
+  // per treelet: threads parked, and the longest its queue got
+  std::map<int, long long int> parks;
+  std::map<int, int> max_depth;
+
+private:
+  struct ThreadTreelet {
+    ThreadTreelet() : treelet(-1), parked(-1), park_cycle(0), admitted(NULL), admitted_node(-1), node(-1) {}
+    int treelet;               // the treelet the thread is in, -1 for none
+    int parked;                // the treelet it is parked on, -1 for none
+    long long int park_cycle;
+    Instruction* admitted;     // the node load MayIssue let through
+    int admitted_node;
+    int node;                  // the last node it loaded from
+  };
+
+  // Find the BVH in memory the first time it is needed
+  void FindNodes();
+  int NodeTreelet(int node);
+  bool IsActive(int treelet);
+  void Park(ThreadTreelet& state, int treelet, long long int cycle);
+  void Unpark(ThreadTreelet& state, long long int cycle);
+  void Join(ThreadTreelet& state, int treelet);
+  // Retire idle treelets and fill free slots with the deepest queues
+  void UpdateActive(long long int cycle);
+
+  MainMemory* memory;
+  bool found_nodes;
+  int start_nodes;
+  int num_nodes;
+  int node_size;
+  bool use_subtrees;
+
+  std::map<ThreadState*, ThreadTreelet> threads;
+  std::vector<int> active;
+  std::map<int, long long int> last_use;
+  // threads in and parked on each treelet
+  std::map<int, int> residents;
+  std::map<int, int> queued;
+};
+
+#endif // _SIMHWRT_TREELET_SCHEDULER_H_
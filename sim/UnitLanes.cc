@@ -0,0 +1,139 @@
+#include "UnitLanes.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+extern pthread_mutex_t global_mutex;
+
+UnitLanes::UnitLanes(const char* _name, int _latency, int _width, const UnitLaneParams& params, int _unit) :
+  name(_name), latency(_latency), width(_width), interval(params.interval), tms_per_unit(params.tms_per_unit), unit(_unit)
+{
+  if (width < 1 || interval < 1 || tms_per_unit < 1) {
+    printf("ERROR: %s needs a width of at least 1, an initiation interval of at least 1 and at least 1 TM per unit (%d, %d, %d)\n",
+           name.c_str(), width, interval, tms_per_unit);
+    exit(1);
+  }
+  next_start = new long long int[width];
+  owner = new int[width];
+  prev_start = new long long int[width];
+  prev_owner = new int[width];
+  Reset();
+}
+
+UnitLanes::~UnitLanes()
+{
+  delete [] next_start;
+  delete [] owner;
+  delete [] prev_start;
+  delete [] prev_owner;
+}
+
+void UnitLanes::Reset()
+{
+  for (int i = 0; i < width; i++) {
+    next_start[i] = 0;
+    owner[i] = -1;
+  }
+  ops = 0;
+  busy_cycles = 0;
+  stalls = 0;
+  contention_stalls = 0;
+}
+
+int UnitLanes::Reserve(long long int cycle, int core)
+{
+  // the TMs sharing a unit are clocked by different host threads
+  if (tms_per_unit > 1)
+    pthread_mutex_lock(&global_mutex);
+
+  int lane = -1;
+  bool contended = false;
+  for (int i = 0; i < width; i++) {
+    if (next_start[i] <= cycle) {
+      lane = i;
+      break;
+    }
+    if (owner[i] != core)
+      contended = true;
+  }
+
+  if (lane < 0) {
+    stalls++;
+    if (contended)
+      contention_stalls++;
+  }
+  else {
+    prev_start[lane] = next_start[lane];
+    prev_owner[lane] = owner[lane];
+    next_start[lane] = cycle + interval;
+    owner[lane] = core;
+    ops++;
+    busy_cycles += interval;
+  }
+
+  if (tms_per_unit > 1)
+    pthread_mutex_unlock(&global_mutex);
+  return lane;
+}
+
+void UnitLanes::Release(int lane)
+{
+  if (tms_per_unit > 1)
+    pthread_mutex_lock(&global_mutex);
+  next_start[lane] = prev_start[lane];
+  owner[lane] = prev_owner[lane];
+  ops--;
+  busy_cycles -= interval;
+  if (tms_per_unit > 1)
+    pthread_mutex_unlock(&global_mutex);
+}
+
+void UnitLanes::AddStats(UnitLanes* other)
+{
+  ops += other->ops;
+  busy_cycles += other->busy_cycles;
+  stalls += other->stalls;
+  contention_stalls += other->contention_stalls;
+}
+
+void UnitLanes::PrintStats(const char* label, long long int cycles, int num_units)
+{
+  long long int lane_cycles = cycles * width * num_units;
+  printf("   %s%lld ops, occupancy %.2f%%, %lld stalls (%lld waiting on another TM)\n", label,
+         ops, lane_cycles > 0 ? 100. * busy_cycles / lane_cycles : 0., stalls, contention_stalls);
+}
+
+void UnitLanes::PrintAll(const std::vector<UnitLanes*>& lanes, long long int cycles)
+{
+  std::vector<bool> printed(lanes.size(), false);
+  for (size_t n = 0; n < lanes.size(); n++) {
+    if (printed[n])
+      continue;
+
+    // sum the units of this type
+    UnitLanes* first = lanes[n];
+    UnitLanes total(first->name.c_str(), first->latency, first->width, UnitLaneParams(), 0);
+    int num_units = 0;
+    for (size_t i = n; i < lanes.size(); i++) {
+      if (lanes[i]->name != first->name)
+        continue;
+      total.AddStats(lanes[i]);
+      num_units++;
+      printed[i] = true;
+    }
+
+    printf(" %s: %d unit(s) x %d wide, latency %d, initiation interval %d, %d TM(s) per unit\n",
+           first->name.c_str(), num_units, first->width, first->latency, first->interval, first->tms_per_unit);
+    total.PrintStats("total: ", cycles, num_units);
+    if (first->tms_per_unit == 1)
+      continue;
+    for (size_t i = n; i < lanes.size(); i++) {
+      if (lanes[i]->name != first->name)
+        continue;
+      char label[64];
+      sprintf(label, "TMs %d-%d: ", lanes[i]->unit, lanes[i]->unit + lanes[i]->tms_per_unit - 1);
+      lanes[i]->PrintStats(label, cycles, 1);
+    }
+  }
+}
@@ -0,0 +1,75 @@
+#ifndef _SIMHWRT_UNIT_LANES_H_
+#define _SIMHWRT_UNIT_LANES_H_
+
+// The issue lanes of a long latency unit (FPDiv, FPInvSqrt), set up by an
+// INTERVAL line in the config file:
+//
+//   INTERVAL <FPDIV | FPINVSQRT> <initiation interval> <TMs per unit (optional)>
+//
+// Each of the unit's <issue width> lanes starts an op, then can't start
+// another until <initiation interval> cycles later (1 is fully pipelined,
+// <latency> is not pipelined at all). The result is still written
+// <latency> cycles after the op starts.
+//
+// With <TMs per unit> above 1, TMs 0 to n-1 share one unit, n to 2n-1 the
+// next one, and so on. Lanes go to the TMs first come, first served: a
+// thread that finds every lane busy stalls and tries again next cycle.
+// Stalls while another TM holds a lane are counted as contention.
+
+#include <string>
+#include <vector>
+
+// INTERVAL config line parameters for a unit type
+struct UnitLaneParams {
+  bool enabled;
+  int interval;
+  int tms_per_unit;
+
+  UnitLaneParams() :
+    enabled(false), interval(1), tms_per_unit(1)
+  {}
+};
+
+class UnitLanes {
+public:
+  // unit is the first TM using the lanes
+  UnitLanes(const char* name, int latency, int width, const UnitLaneParams& params, int unit);
+  ~UnitLanes();
+
+  // Claim a free lane at cycle for a thread in TM core, -1 if every lane is busy
+  int Reserve(long long int cycle, int core);
+  // Give back a lane Reserve returned when the op couldn't issue after all
+  void Release(int lane);
+
+  void Reset();
+  void AddStats(UnitLanes* other);
+  // cycles is the length of the run, num_units the number summed into this one
+  void PrintStats(const char* label, long long int cycles, int num_units);
+
+  // Per unit type: the totals, and each shared unit on its own
+  static void PrintAll(const std::vector<UnitLanes*>& lanes, long long int cycles);
+
+  std::string name;
+  int latency;
+  int width;
+  int interval;
+  int tms_per_unit;
+  int unit;
+
+  long long int ops;
+  // lane*cycles spent unable to start an op
+  long long int busy_cycles;
+  // refused ops, and those refused while another TM held a lane
+  long long int stalls;
+  long long int contention_stalls;
+
+private:
+  // per lane: when it can start the next op and the TM that last started one
+  long long int* next_start;
+  int* owner;
+  // per lane, what Reserve replaced, to undo it
+  long long int* prev_start;
+  int* prev_owner;
+};
+
+#endif // _SIMHWRT_UNIT_LANES_H_
@@ -0,0 +1,166 @@
+#include "WorkDistributor.h"
+#include "GlobalRegisterFile.h"
+#include "IssueUnit.h"
+#include "ThreadState.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+WorkDistributor::WorkDistributor(GlobalRegisterFile* _globals, const WorkQueueParams& params, int _num_tms) :
+  globals(_globals), reg(params.reg), chunk_size(params.chunk_size), refill_latency(params.refill_latency),
+  refill_threshold(params.refill_threshold), num_tms(_num_tms)
+{
+  if (reg < 0 || reg >= globals->num_registers || chunk_size < 1 || refill_latency < 1 ||
+      refill_threshold < 0 || refill_threshold >= chunk_size) {
+    printf("ERROR: WORKQUEUE needs a global register below %d, a chunk size of at least 1, a refill latency of at least 1 and a refill threshold below the chunk size (%d, %d, %d, %d)\n",
+           globals->num_registers, reg, chunk_size, refill_latency, refill_threshold);
+    exit(1);
+  }
+  queues.resize(num_tms);
+  items_left.resize(num_tms);
+  last_cycle.resize(num_tms);
+  waiting_since.resize(num_tms);
+  refill_requests.resize(num_tms);
+  Reset();
+}
+
+void WorkDistributor::Reset()
+{
+  for (int i = 0; i < num_tms; i++) {
+    queues[i].clear();
+    items_left[i] = 0;
+    last_cycle[i] = -1;
+    waiting_since[i] = -1;
+    refill_requests[i].clear();
+  }
+  port_free_cycle = 0;
+  items = 0;
+  refills = 0;
+  port_wait_cycles = 0;
+  refill_wait_cycles = 0;
+  max_refill_wait = 0;
+}
+
+bool WorkDistributor::Handles(Instruction& ins, long long int cycle, ThreadState* thread)
+{
+  if (ins.op != Instruction::ATOMIC_INC)
+    return false;
+  reg_value arg1;
+  Instruction::Opcode failop = Instruction::NOP;
+  if (!thread->ReadRegister(ins.args[1], cycle, arg1, failop))
+    return false;
+  return (int)arg1.udata == reg;
+}
+
+void WorkDistributor::Refill(int tm, long long int cycle)
+{
+  // sent with the other TMs' in Service
+  Chunk chunk;
+  chunk.next = 0;
+  chunk.end = 0;
+  chunk.ready_cycle = 0;
+  chunk.requested = cycle;
+  chunk.filled = false;
+  queues[tm].push_back(chunk);
+  refill_requests[tm].push_back(&queues[tm].back());
+  items_left[tm] += chunk_size;
+  refills++;
+}
+
+void WorkDistributor::Service(long long int cycle)
+{
+  // every TM shares the global register and its port
+  for (int tm = 0; tm < num_tms; tm++)
+  {
+    for (size_t i = 0; i < refill_requests[tm].size(); i++)
+    {
+      Chunk* chunk = refill_requests[tm][i];
+      if (globals->batched)
+      {
+        globals->QueueRefill(tm, chunk, cycle);
+        continue;
+      }
+      long long int served = port_free_cycle > cycle ? port_free_cycle : cycle;
+      port_free_cycle = served + 1;
+      unsigned int start = globals->ReadUint(reg);
+      globals->WriteUint(reg, start + chunk_size);
+      Filled(chunk, start, served);
+    }
+    refill_requests[tm].clear();
+  }
+}
+
+void WorkDistributor::Filled(Chunk* chunk, unsigned int start, long long int cycle)
+{
+  chunk->next = start;
+  chunk->end = start + chunk_size;
+  chunk->ready_cycle = cycle + refill_latency;
+  chunk->filled = true;
+  port_wait_cycles += cycle - chunk->requested;
+}
+
+bool WorkDistributor::AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState* thread)
+{
+  // a TM's queue is only touched by the host thread clocking it, and by
+  // Service once every TM has been clocked
+  long long int cycle = issuer->current_cycle;
+  int tm = (int)thread->core_id;
+  if (last_cycle[tm] == cycle)
+    return false;
+
+  if (items_left[tm] == 0)
+    Refill(tm, cycle);
+
+  Chunk& chunk = queues[tm].front();
+  if (!chunk.filled)
+  {
+    // its refill hasn't been served yet
+    if (waiting_since[tm] < 0)
+      waiting_since[tm] = cycle;
+    return false;
+  }
+  reg_value result;
+  result.udata = chunk.next;
+  long long int write_cycle = chunk.ready_cycle > cycle ? chunk.ready_cycle : cycle + 1;
+  if (!thread->QueueWrite(ins.args[0], result, write_cycle, ins.op, &ins))
+  {
+    // pipeline hazzard, the item stays in the queue
+    return false;
+  }
+
+  last_cycle[tm] = cycle;
+  items++;
+  long long int asked = waiting_since[tm] >= 0 ? waiting_since[tm] : cycle;
+  waiting_since[tm] = -1;
+  long long int wait = write_cycle - (asked + 1);
+  refill_wait_cycles += wait;
+  if (wait > max_refill_wait)
+    max_refill_wait = wait;
+
+  chunk.next++;
+  items_left[tm]--;
+  if (chunk.next == chunk.end)
+    queues[tm].pop_front();
+  if (items_left[tm] <= refill_threshold)
+    Refill(tm, cycle);
+  return true;
+}
+
+void WorkDistributor::PrintStats(long long int atominc_conflicts)
+{
+  long long int unused = 0;
+  for (int i = 0; i < num_tms; i++)
+    unused += items_left[i];
+
+  printf(" WORKQUEUE: global register %d, %d TMs, chunks of %d, refill latency %d, refill at %d items left\n",
+         reg, num_tms, chunk_size, refill_latency, refill_threshold);
+  printf("   items handed out: %lld (%lld left in the TMs' queues)\n", items, unused);
+  printf("   global atomics: %lld refills instead of %lld ATOMIC_INCs (%lld avoided, %.2f%%)\n",
+         refills, items, items - refills, items > 0 ? 100. * (items - refills) / items : 0.);
+  printf("   refills waited %lld cycles for the global port (%.2f per refill)\n",
+         port_wait_cycles, refills > 0 ? static_cast<double>(port_wait_cycles) / refills : 0.);
+  printf("   threads waited %lld thread*cycles for their chunk to arrive (%.2f per item, up to %lld)\n",
+         refill_wait_cycles, items > 0 ? static_cast<double>(refill_wait_cycles) / items : 0., max_refill_wait);
+  printf("   ATOMIC_INC issue conflicts: %lld thread*cycles (compare with a run without WORKQUEUE)\n",
+         atominc_conflicts);
+}
@@ -0,0 +1,112 @@
+#ifndef _SIMHWRT_WORK_DISTRIBUTOR_H_
+#define _SIMHWRT_WORK_DISTRIBUTOR_H_
+
+// A hardware work distributor in front of one global register, set up by
+// a WORKQUEUE line in the config file:
+//
+//   WORKQUEUE <global register> <chunk size> <refill latency> <refill threshold (optional)>
+//
+// Kernels fetch work with ATOMIC_INC on a global register, so without it
+// every thread on every TM does a global atomic on the same counter. With
+// it, an ATOMIC_INC on <global register> is served from its TM's local
+// queue instead, one per TM per cycle: the thread gets the next item of
+// the queue's oldest chunk. When the items left (including those of a
+// chunk on its way) drop to <refill threshold> (default 0, empty), the TM
+// takes the next <chunk size> items from the global register with a single
+// atomic add, which arrive <refill latency> cycles after it is served. The
+// adds asked for in a cycle are sent once every TM has been clocked, in TM
+// order (GlobalRegisterFile::Service), so runs don't depend on the
+// --simulation-threads count. The chip has one port for them, so refills
+// made in the same cycle go one after the other, unless the registers are
+// batched (GLOBALS line), where they queue at the register like any other
+// op. A thread given an item from a chunk that hasn't arrived has its
+// result written when it does, like a load.
+//
+// Items are handed out in a different order than with the plain counter,
+// but each one exactly once, so kernels that stop once they get an item
+// past the end need no change. Other ops on the register (GLOBAL_READ,
+// ATOMIC_ADD, ...) go to the global register file as usual and don't see
+// the items the TMs are holding.
+
+#include "Instruction.h"
+#include <deque>
+#include <vector>
+
+class GlobalRegisterFile;
+class IssueUnit;
+class ThreadState;
+
+// WORKQUEUE config line parameters
+struct WorkQueueParams {
+  bool enabled;
+  int reg;
+  int chunk_size;
+  int refill_latency;
+  int refill_threshold;
+
+  WorkQueueParams() :
+    enabled(false), reg(0), chunk_size(1), refill_latency(1), refill_threshold(0)
+  {}
+};
+
+class WorkDistributor {
+public:
+  WorkDistributor(GlobalRegisterFile* globals, const WorkQueueParams& params, int num_tms);
+
+  // True if ins is an ATOMIC_INC on the distributor's register
+  bool Handles(Instruction& ins, long long int cycle, ThreadState* thread);
+  bool AcceptInstruction(Instruction& ins, IssueUnit* issuer, ThreadState* thread);
+
+  // Send the refills the TMs asked for in cycle, once every TM has been
+  // clocked
+  void Service(long long int cycle);
+
+  void Reset();
+  // atominc_conflicts is the thread*cycles ATOMIC_INCs couldn't issue, for comparison
+  void PrintStats(long long int atominc_conflicts);
+
+  GlobalRegisterFile* globals;
+  int reg;
+  int chunk_size;
+  int refill_latency;
+  int refill_threshold;
+  int num_tms;
+
+  // ATOMIC_INCs served, and the global atomics (refills) it took to serve them
+  long long int items;
+  long long int refills;
+  // cycles refills waited for the global port (or register, with GLOBALS)
+  long long int port_wait_cycles;
+  // thread*cycles threads waited for their item's chunk to arrive
+  long long int refill_wait_cycles;
+  long long int max_refill_wait;
+
+  // A TM's chunk, filled in once its refill is served
+  struct Chunk {
+    unsigned int next;
+    unsigned int end;
+    long long int ready_cycle;
+    long long int requested;    // cycle the TM asked for it
+    bool filled;
+  };
+
+  // The refill for chunk was served at cycle, taking the items from start
+  void Filled(Chunk* chunk, unsigned int start, long long int cycle);
+
+private:
+  // Ask for the TM's next chunk from the global register
+  void Refill(int tm, long long int cycle);
+
+  // per TM: its chunks, oldest first, the items left in them, the last
+  // cycle it served an item, the first cycle a thread has been waiting for
+  // an item since (-1 if none), and the refills it asked for this cycle
+  std::vector<std::deque<Chunk> > queues;
+  std::vector<long long int> items_left;
+  std::vector<long long int> last_cycle;
+  std::vector<long long int> waiting_since;
+  std::vector<std::vector<Chunk*> > refill_requests;
+  // the first cycle the global port is free, shared by every TM
+  long long int port_free_cycle;
+};
+
+#endif // _SIMHWRT_WORK_DISTRIBUTOR_H_
@@ -13,10 +13,12 @@
 #include "FPMul.h"
 #include "FunctionalUnit.h"
 #include "GlobalRegisterFile.h"
+#include "HostProfile.h"
 #include "Instruction.h"
 #include "IntAddSub.h"
 #include "IntMul.h"
 #include "IssueUnit.h"
+#include "ImageWriter.h"
 #include "IWLoader.h"
 #include "L1Cache.h"
 #include "L2Cache.h"
@@ -30,12 +32,17 @@
 #include "ReadConfig.h"
 #include "ReadViewfile.h"
 #include "ReadLightfile.h"
+#include "SharedUnitPool.h"
 #include "SimpleRegisterFile.h"
+#include "StatsSampler.h"
+#include "StreamMemory.h"
+#include "Sweep.h"
 #include "Synchronize.h"
 #include "ThreadState.h"
 #include "ThreadProcessor.h"
 #include "TraxCore.h"
 #include "Triangle.h"
+#include "UnitLanes.h"
 #include "Vector3.h"
 #include "Assembler.h"
 #include "usimm.h"
@@ -83,6 +90,7 @@ int global_total_simulation_threads;
 int current_simulation_threads;
 bool disable_usimm;
 bool wait_usimm;
+bool disable_cycle_skip;
 
 // this branch delay is reset by code that finds the delay from the
 // config file
@@ -171,9 +179,128 @@ struct CoreThreadArgs {
   int thread_num;
   long long int stop_cycle;
   std::vector<TraxCore*>* cores;
+  StatsSampler* sampler;
+  // NULL unless the global registers are batched (GLOBALS line) or have a
+  // work distributor (WORKQUEUE line)
+  GlobalRegisterFile* globals;
+  // only used when built with HOST_PROFILE
+  HostProfile* host_profile;
+  HostProfileCounters* host_counters;
 };
 
+// Clock every module of one core, batched by type (see
+// TraxCore::GroupModules). With HOST_PROFILE each module is instead clocked
+// and timed on its own, and charged to the module's type.
+inline void ClockCore(TraxCore* core, CoreThreadArgs* core_args) {
+#if HOST_PROFILE
+  std::vector<HardwareModule*>& modules = core->modules;
+  const std::vector<int>& slots = core_args->host_profile->module_slots[core->core_id];
+  HostProfileCounters* counters = core_args->host_counters;
+  long long int start = HostProfile::Now();
+  for(size_t i = 0; i < modules.size(); i++) {
+    modules[i]->ClockRise();
+    long long int end = HostProfile::Now();
+    counters->rise_ns[slots[i]] += end - start;
+    start = end;
+  }
+  for(size_t i = 0; i < modules.size(); i++) {
+    modules[i]->ClockFall();
+    long long int end = HostProfile::Now();
+    counters->Add(slots[i], 0, end - start);
+    start = end;
+  }
+#else
+  core->ClockRise();
+  core->ClockFall();
+#endif
+}
+
+// Fast-forward over cycles in which every thread of every TM is stalled
+// waiting on data (see HardwareModule::NextEventCycle). Called by the last
+// thread to sync, after the L2s and DRAM have been clocked, so every module
+// is between cycles. Nothing issued in the cycle that just finished, so
+// crediting the skipped cycles before the threads track that cycle's
+// utilization gives the same totals.
+//
+// With usimm the DRAM keeps its own clock (refresh, command timing and
+// completion times are all in DRAM cycles), so it is still clocked every
+// cycle and only the TMs are skipped, one cycle at a time until a load's
+// data returns. With --disable-usimm every latency is known at issue and
+// the TMs jump straight to the next register write.
+void SkipStalledCycles(CoreThreadArgs* core_args) {
+  std::vector<TraxCore*>& cores = *core_args->cores;
+  long long int next_cycle = cores[0]->issuer->current_cycle;
+  // each thread still increments cycle_num once for the cycle just finished
+  long long int max_skip = NO_EVENT_CYCLE;
+  if(core_args->stop_cycle >= 0)
+    max_skip = core_args->stop_cycle - cores[0]->cycle_num - 1;
+
+  long long int skipped = 0;
+  while(skipped < max_skip) {
+    long long int wake_cycle = NO_EVENT_CYCLE;
+    bool all_halted = true;
+    for(size_t i = 0; i < cores.size(); i++) {
+      long long int core_next = cores[i]->NextEventCycle();
+      if(core_next <= next_cycle)
+        return;
+      if(core_next < wake_cycle)
+        wake_cycle = core_next;
+      if(!cores[i]->issuer->halted)
+        all_halted = false;
+    }
+    // the simulation loop handles the end of the run
+    if(all_halted)
+      return;
+
+    long long int num_cycles = 1;
+    if(disable_usimm) {
+      num_cycles = wake_cycle - next_cycle;
+      if(num_cycles > max_skip - skipped)
+        num_cycles = max_skip - skipped;
+    }
+
+    for(size_t i = 0; i < cores.size(); i++)
+      cores[i]->SkipCycles(num_cycles);
+    for(size_t i = 0; i < num_L2s; i++) {
+      if(disable_usimm)
+        L2s[i]->SkipCycles(num_cycles);
+      else {
+        L2s[i]->ClockRise();
+        L2s[i]->ClockFall();
+      }
+    }
+    if(!disable_usimm) {
+      for(int i=0; i < DRAM_CLOCK_MULTIPLIER; i++)
+        usimmClock();
+    }
+    if(core_args->sampler)
+      for(long long int i = 0; i < num_cycles; i++)
+        core_args->sampler->Tick();
+
+    next_cycle += num_cycles;
+    skipped += num_cycles;
+  }
+}
+
+// Serve the global register requests and work distributor refills every TM
+// sent in the cycle that just finished (see GlobalRegisterFile.h). Called
+// once every TM has been clocked.
+void ServiceGlobals(CoreThreadArgs* core_args) {
+  std::vector<TraxCore*>& cores = *core_args->cores;
+  long long int next_cycle = 0;
+  for(size_t i = 0; i < cores.size(); i++)
+    if(cores[i]->issuer->current_cycle > next_cycle)
+      next_cycle = cores[i]->issuer->current_cycle;
+  core_args->globals->Service(next_cycle - 1);
+}
+
 void SyncThread( CoreThreadArgs* core_args ) {
+#if HOST_PROFILE
+  HostProfile* host_profile = core_args->host_profile;
+  HostProfileCounters* counters = core_args->host_counters;
+  long long int sync_start = HostProfile::Now();
+  long long int work_ns = 0;
+#endif
   // synchronizes a thread
   pthread_mutex_lock(&sync_mutex);
   current_simulation_threads--;
@@ -181,24 +308,64 @@ void SyncThread( CoreThreadArgs* core_args ) {
     pthread_cond_wait(&sync_cond, &sync_mutex);
   }
   else {
+#if HOST_PROFILE
+    long long int start = HostProfile::Now();
+    for(size_t i = 0; i < num_L2s; i++)
+      L2s[i]->ClockRise();
+    long long int mid = HostProfile::Now();
+    for(size_t i = 0; i < num_L2s; i++)
+      L2s[i]->ClockFall();
+    long long int end = HostProfile::Now();
+    counters->Add(host_profile->L2_slot, mid - start, end - mid);
+    work_ns += end - start;
+    start = end;
+#else
     // Last thread sync caches
     for(size_t i = 0; i < num_L2s; i++) {
       L2s[i]->ClockRise();
       L2s[i]->ClockFall();
     }
+#endif
+
+    // Last thread serves the batched global register requests
+    if(core_args->globals)
+      ServiceGlobals(core_args);
 
     // Last thread updates the DRAM
     // Multiple DRAM cycles per trax cycle
     if(!disable_usimm) {
       for(int i=0; i < DRAM_CLOCK_MULTIPLIER; i++)
         usimmClock();
+#if HOST_PROFILE
+      end = HostProfile::Now();
+      counters->Add(host_profile->dram_slot, end - start, 0);
+      work_ns += end - start;
+      start = end;
+#endif
     }
 
+    // Last thread takes the periodic stats sample (--stats-sample)
+    if(core_args->sampler) {
+      core_args->sampler->Tick();
+#if HOST_PROFILE
+      end = HostProfile::Now();
+      counters->Add(host_profile->sampler_slot, end - start, 0);
+      work_ns += end - start;
+#endif
+    }
+
+    // Last thread fast-forwards if every TM is stalled
+    if(!disable_cycle_skip)
+      SkipStalledCycles(core_args);
+
     // Last thread signal the others to wake up
     current_simulation_threads = global_total_simulation_threads;
     pthread_cond_broadcast(&sync_cond);
   }
   pthread_mutex_unlock(&sync_mutex);
+#if HOST_PROFILE
+  counters->Add(host_profile->sync_slot, HostProfile::Now() - sync_start - work_ns, 0);
+#endif
 }
 
 void *CoreThread( void* args ) {
@@ -207,6 +374,9 @@ void *CoreThread( void* args ) {
   printf("Thread %d running cores\t%d to\t%d ...\n", (int) core_args->thread_num, (int) core_args->start_core, (int) core_args->end_core-1);
   // main loop for this core
   while (true) {
+#if HOST_PROFILE
+    long long int loop_start = HostProfile::Now();
+#endif
     // Choose the first core to issue from
 
     int start_core = 0;
@@ -221,20 +391,22 @@ void *CoreThread( void* args ) {
       }
     }
 
+#if HOST_PROFILE
+    core_args->host_counters->Add(core_args->host_profile->loop_slot, HostProfile::Now() - loop_start, 0);
+#endif
+
     const int num_cores = core_args->end_core - core_args->start_core;
     // start_core to num_cores
     tpIter = core_args->cores->begin() + (core_args->start_core + start_core);
     for(int i = 0; i < (num_cores - start_core); ++i, ++tpIter)
     {
-      SystemClockRise((*tpIter)->modules);
-      SystemClockFall((*tpIter)->modules);
+      ClockCore(*tpIter, core_args);
     }
     // 0 to start_core
     tpIter = core_args->cores->begin() + core_args->start_core;
     for(int i = 0; i < start_core; ++i, ++tpIter)
     {
-      SystemClockRise((*tpIter)->modules);
-      SystemClockFall((*tpIter)->modules);
+      ClockCore(*tpIter, core_args);
     }
 //    for(int i = 0; i < num_cores; ++i, ++tpIter) {
 //      int core_id = ((i + start_core) % num_cores) + core_args->start_core;
@@ -244,6 +416,9 @@ void *CoreThread( void* args ) {
 
     SyncThread(core_args);
 
+#if HOST_PROFILE
+    loop_start = HostProfile::Now();
+#endif
     bool all_done = true;
     tpIter = core_args->cores->begin() + core_args->start_core;
     for(int i = core_args->start_core; i < core_args->end_core; ++i, ++tpIter) {
@@ -257,6 +432,9 @@ void *CoreThread( void* args ) {
     
     if(wait_usimm && usimmIsBusy())
       all_done = false;
+#if HOST_PROFILE
+    core_args->host_counters->Add(core_args->host_profile->loop_slot, HostProfile::Now() - loop_start, 0);
+#endif
     
     if(core_args->cores->front()->cycle_num == stop_cycle || all_done) {
       break;
@@ -302,8 +480,7 @@ void SerialExecution(CoreThreadArgs* core_args, int num_cores) {
         continue;
 
       all_halted = false;
-      SystemClockRise(core->modules);
-      SystemClockFall(core->modules);
+      ClockCore(core, &core_args[0]);
       TrackUtilization(core->modules, core->utilizations);
       core->cycle_num++;
       if(core->cycle_num == stop_cycle)
@@ -311,6 +488,10 @@ void SerialExecution(CoreThreadArgs* core_args, int num_cores) {
     }
     if(all_halted)
       break;
+    if(core_args[0].globals)
+      ServiceGlobals(&core_args[0]);
+    if(core_args[0].sampler)
+      core_args[0].sampler->Tick();
   }
 }
 
@@ -325,15 +506,23 @@ void printUsage(char* program_name) {
   printf("    --issue-verbosity      <level of verbosity for issue unit -- default 0>\n");
   printf("    --load-mem-file        [read memory dump from file]\n");
   printf("    --mem-file             <memory dump file name -- default memory.mem>\n");
+  printf("    --no-cycle-skip        [clock every cycle even when every thread is stalled waiting on data]\n");
   printf("    --print-instructions   [print contents of instruction memory]\n");
   printf("    --print-symbols        [print symbol table generated by assembler]\n");
   printf("    --profile              [print per-instruction execution info to \"profile.out\"]\n");
   printf("    --serial-execution     [use a single pthread to run simulation]\n");
   printf("    --simulation-threads   <number of simulator pthreads. -- default 1>\n");
+  printf("    --stats-sample         <number of cycles between time-series stats samples -- default 0, 0 means off>\n");
+  printf("    --stats-sample-counters <comma separated list of issue,cache,dram,threads to sample -- default all>\n");
+  printf("    --stats-sample-file    <time-series stats output file name -- default stats_samples.txt>\n");
   printf("    --stop-cycle           <stop the simulation on reaching this cycle number>\n");
+  printf("    --sweep                <sweep file: run every point in it, sharing one loaded scene and program. See Sweep.h for the syntax>\n");
+  printf("    --sweep-jobs           <number of sweep points to simulate at once -- default number of host cores>\n");
+  printf("    --sweep-output         <combined sweep results table; point logs go to <file>.p<N>.log -- default sweep_results.txt>\n");
   printf("    --verbose              enables output verbosity\n");
   printf("    --write-dot            <depth> generates a dot file for the BVH (bvh.dot). Depth should not exceed 8\n");
   printf("    --write-mem-file       [write memory dump to file]\n");
+  printf("    --self-test            [check the simulator's instruction tables and quit]\n");
 
   printf("\n");
   printf("  + TRAX Specification:\n");
@@ -346,6 +535,14 @@ void printUsage(char* program_name) {
   printf("    --l2-off             [turn off the L2 data cache and set latency to 0]\n");
   printf("    --num-icache-banks   <number of banks per icache -- default 1>\n");
   printf("    --num-icaches        <number of icaches in a TM. Should be a power of 2 -- default 1>\n");
+  printf("    --simt-width         <issue in lock-step warps of this many thread processors, reconverging\n");
+  printf("                          after divergent branches -- default 1 (off)>\n");
+  printf("    --no-coalesce        [give every lane of a SIMD/SIMT warp its own L1 request]\n");
+  printf("    --watchdog           <stop a TM that issues nothing for this many cycles, printing why each\n");
+  printf("                          thread is stuck, 0 to never stop -- default 500000>\n");
+  printf("    --watchdog-checkpoint <file to write thread and memory state to when the watchdog stops a TM>\n");
+  printf("    --scheduling         <thread selection with --threads-per-proc > 1: simple, prestall, poststall,\n");
+  printf("                          gto (greedy-then-oldest), twolevel (active/pending pools) or lrr -- default simple>\n");
   printf("    --disable-usimm      [use naive DRAM simulation instead of usimm]\n");
   printf("    --wait-usimm         [wait for all DRAM commands to finish before halting machine]\n");
 
@@ -367,6 +564,7 @@ void printUsage(char* program_name) {
   printf("    --background      <r g b, background color -- default 0.561 0.729 0.988>\n");
   printf("    --epsilon         <small number pre-loaded to main memory, useful for various ray tracer offsets, default 1e-4>\n");
   printf("    --height          <framebuffer height in pixels -- default 128>\n");
+  printf("    --incremental-output <number of main memory stores between writing intermediate images <prefix>N.ppm (or .png)>\n");
   printf("    --no-png          [disable png output]\n");
   printf("    --no-scene        <specify there is no model, camera, or light. use for non-ray tracing programs>\n");
   printf("    --num-samples     <number of samples per pixel, pre-loaded to main memory -- default 1>\n");
@@ -401,6 +599,10 @@ int main(int argc, char* argv[]) {
   int num_thread_procs                  = 1;
   int threads_per_proc                  = 1;
   int simd_width                        = 1;
+  int simt_width                        = 1;
+  bool no_coalesce                      = false;
+  long long int watchdog_cycles         = 500000;
+  char* watchdog_checkpoint             = NULL;
   int num_frames                        = 1;
   int rebuild_frequency                 = 0;
   bool duplicate_bvh                    = false;
@@ -432,6 +634,12 @@ int main(int argc, char* argv[]) {
   int issue_verbosity                   = 0;
   bool ignore_dcache_area               = false;
   long long int atominc_report_period   = 0;
+  long long int stats_sample_period     = 0;
+  char* stats_sample_file               = (char*)"stats_samples.txt";
+  char* stats_sample_counters           = (char*)"all";
+  char* sweep_file                      = NULL;
+  char* sweep_output                    = (char*)"sweep_results.txt";
+  int sweep_jobs                        = SweepHostCores();
   int num_icaches                       = 1;
   int icache_banks                      = 1;
   char *assem_file                      = NULL;
@@ -453,6 +661,7 @@ int main(int argc, char* argv[]) {
   bool store_parent_pointers            = false;
   disable_usimm                         = false; // globally defined for use above
   wait_usimm                            = false;
+  disable_cycle_skip                    = false;
   BVH* bvh;
   //Animation *animation                  = NULL;
   ThreadProcessor::SchedulingScheme scheduling_scheme = ThreadProcessor::SIMPLE;
@@ -490,6 +699,10 @@ int main(int argc, char* argv[]) {
     printf("%s", argv[i]);
     if (strcmp(argv[i], "--with-per-cycle") == 0) {
       print_system_info = true;
+    } else if (strcmp(argv[i], "--self-test") == 0) {
+      // check the simulator's own tables and quit
+      printf("\n");
+      return Instruction::CheckSourceTable() ? 0 : 1;
     } else if (strcmp(argv[i], "--no-cpi") == 0) {
       print_cpi = false;
     } else if (strcmp(argv[i], "--no-png") == 0) {
@@ -512,6 +725,14 @@ int main(int argc, char* argv[]) {
       threads_per_proc = atoi(argv[++i]);
     } else if (strcmp(argv[i], "--simd-width") == 0) {
       simd_width = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--simt-width") == 0) {
+      simt_width = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--watchdog") == 0) {
+      watchdog_cycles = atoll(argv[++i]);
+    } else if (strcmp(argv[i], "--watchdog-checkpoint") == 0) {
+      watchdog_checkpoint = argv[++i];
+    } else if (strcmp(argv[i], "--no-coalesce") == 0) {
+      no_coalesce = true;
     } else if (strcmp(argv[i], "--num-cores") == 0 || 
                strcmp(argv[i], "--num-TMs") == 0) {
       num_cores = atoi(argv[++i]);
@@ -575,6 +796,18 @@ int main(int argc, char* argv[]) {
       ignore_dcache_area = true;
     } else if (strcmp(argv[i], "--atominc-report") == 0) {
       atominc_report_period = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--sweep") == 0) {
+      sweep_file = argv[++i];
+    } else if (strcmp(argv[i], "--sweep-jobs") == 0) {
+      sweep_jobs = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--sweep-output") == 0) {
+      sweep_output = argv[++i];
+    } else if (strcmp(argv[i], "--stats-sample") == 0) {
+      stats_sample_period = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--stats-sample-file") == 0) {
+      stats_sample_file = argv[++i];
+    } else if (strcmp(argv[i], "--stats-sample-counters") == 0) {
+      stats_sample_counters = argv[++i];
     } else if (strcmp(argv[i], "--num-icache-banks") == 0) {
       icache_banks = atoi(argv[++i]);
     } else if (strcmp(argv[i], "--num-icaches") == 0) {
@@ -618,12 +851,10 @@ int main(int argc, char* argv[]) {
       pack_stream_boundaries = true;
     } else if (strcmp(argv[i], "--scheduling") == 0) {
       i++;
-      if(strcmp(argv[i], "simple")==0)
-        scheduling_scheme = ThreadProcessor::SIMPLE;
-      if(strcmp(argv[i], "prestall")==0)
-        scheduling_scheme = ThreadProcessor::PRESTALL;
-      if(strcmp(argv[i], "poststall")==0)
-        scheduling_scheme = ThreadProcessor::POSTSTALL;
+      if(!ThreadProcessor::ParseScheduling(argv[i], scheduling_scheme)) {
+        printf("ERROR: unknown --scheduling %s\n", argv[i]);
+        exit(1);
+      }
     } else if (strcmp(argv[i], "--usimm-config") == 0) {
       usimm_config_file = argv[++i];
     } else if (strcmp(argv[i], "--vi-file") == 0) {
@@ -636,6 +867,8 @@ int main(int argc, char* argv[]) {
       disable_usimm = 1;
     } else if (strcmp(argv[i], "--wait-usimm") == 0) {
       wait_usimm = true;
+    } else if (strcmp(argv[i], "--no-cycle-skip") == 0) {
+      disable_cycle_skip = true;
     }
     else {
       printf(" Unrecognized option %s\n", argv[i]);
@@ -669,7 +902,6 @@ int main(int argc, char* argv[]) {
   std::vector<TraxCore*> cores;
   L2s = new L2Cache*[num_L2s];
   MainMemory* memory;
-  GlobalRegisterFile globals(num_globals, num_thread_procs * threads_per_proc * num_cores * num_L2s, atominc_report_period);
 
   if (config_file == NULL) {
     config_file = (char*)REL_PATH_BIN_TO_SAMPLES"samples/configs/default.config";
@@ -685,109 +917,10 @@ int main(int argc, char* argv[]) {
   // Set up memory from config (L2 and main memory)
   ReadConfig config_reader(config_file, dcache_params_file, L2s, num_L2s, memory, L2_size, disable_usimm, memory_trace, l1_off, l2_off, l1_read_copy);
 
-  // loop through the L2s
-  for(size_t l2_id = 0; l2_id < num_L2s; ++l2_id) {
-    L2Cache* L2 = L2s[l2_id];
-    // load the cores
-    for(size_t i = 0; i < num_cores; ++i) {
-      size_t core_id = i + num_cores * l2_id;
-      if(trax_verbosity)
-        printf("Loading core %d.\n", (int)core_id);
-
-      // only one computation is needed... we'll end up with the last one after the loop
-      core_size = 0;
-      TraxCore *current_core = new TraxCore(num_thread_procs, threads_per_proc, num_regs, 
-					    scheduling_scheme, &instructions, L2, core_id, 
-					    l2_id, run_profile, &profiler, &debugger);
-      config_reader.current_core = current_core;
-      config_reader.LoadConfig(L2, core_size);
-      current_core->modules.push_back(&globals);
-      current_core->functional_units.push_back(&globals);
-      if (proc_register_trace > -1 && i == 0) {
-        current_core->EnableRegisterDump(proc_register_trace);
-        //current_core->register_files[thread_register_trace]->EnableDump(thread_trace_file);
-      }
-
-      // Add Sync unit
-      Synchronize *sync_unit = new Synchronize(0,0,simd_width,num_thread_procs);
-      current_core->modules.push_back(sync_unit);
-      current_core->functional_units.push_back(sync_unit);
-
-      // Add any other custom units before the push_back
-      LocalStore *ls_unit = new LocalStore(1, num_thread_procs);
-      current_core->modules.push_back(ls_unit);
-      current_core->functional_units.push_back(ls_unit);
-      current_core->SetSymbols(&regs);
-
-      // Link the FPAdder to the FPMul for fmad ops
-      // Similarly for integers
-      FPMul* fpmul = NULL;
-      FPAddSub* fpadd = NULL;
-      IntMul* intmul = NULL;
-      IntAddSub* intadd = NULL;
-      for(size_t unit_id = 0; unit_id < current_core->functional_units.size(); unit_id++)
-	{
-	  if(fpmul == NULL)
-	    fpmul = dynamic_cast<FPMul*>(current_core->functional_units[unit_id]);
-	  if(fpadd == NULL)
-	    fpadd = dynamic_cast<FPAddSub*>(current_core->functional_units[unit_id]);
-	  if(intmul == NULL)
-	    intmul = dynamic_cast<IntMul*>(current_core->functional_units[unit_id]);
-	  if(intadd == NULL)
-	    intadd = dynamic_cast<IntAddSub*>(current_core->functional_units[unit_id]);
-	}
-      if(fpmul != NULL && fpadd != NULL)
-	fpmul->SetAdder(fpadd);
-      if(intmul != NULL && intadd != NULL)
-	intmul->SetAdder(intadd);
-
-      cores.push_back(current_core);
-    }
-  }
-
-  // set up L1 snooping if enabled
-  if(cache_snoop) {
-    for(size_t i = 0; i*4 < num_cores * num_L2s; ++i) {
-      L1Cache* L1_0=NULL, *L1_1=NULL, *L1_2=NULL, *L1_3=NULL;
-      L1_0 = cores[i*4]->L1;
-      if(num_cores > i*4+1) {
-        L1_1 = cores[i*4+1]->L1;
-        L1_1->L1_1 = L1_0;
-        L1_0->L1_1 = L1_1;
-      }
-      if(num_cores > i*4+2) {
-        L1_2 = cores[i*4+2]->L1;
-        L1_2->L1_1 = L1_0;
-        L1_2->L1_2 = L1_1;
-        L1_1->L1_2 = L1_2;
-        L1_0->L1_2 = L1_2;
-      }
-      if(num_cores > i*4+3) {
-        L1_3 = cores[i*4+3]->L1;
-        L1_3->L1_1 = L1_0;
-        L1_3->L1_2 = L1_1;
-        L1_3->L1_3 = L1_2;
-        L1_2->L1_3 = L1_3;
-        L1_1->L1_3 = L1_3;
-        L1_0->L1_3 = L1_3;
-      }
-    }
-  }
-
-  // find maximum branch delay
-  // only for backwards compatability with old trax compilers
-  std::vector<FunctionalUnit*> functional_units = cores[0]->functional_units;
-  for(size_t i = 0; i < functional_units.size(); i++) {
-    BranchUnit* brancher = dynamic_cast<BranchUnit*>(functional_units[i]);
-    if(brancher) {
-      int latency = brancher->GetLatency();
-      if(latency > BRANCH_DELAY)
-        BRANCH_DELAY = latency;
-    }
-  }
-
   int start_wq, start_framebuffer, start_scene, start_camera, start_bg_color, start_light, end_memory;
   int start_matls, start_permutation;
+  double bvh_build_seconds = 0;
+  boost::chrono::system_clock::time_point phase_start = boost::chrono::system_clock::now();
 
   if(load_mem_file && mem_file != NULL) {
     // load memory from file
@@ -871,6 +1004,7 @@ int main(int argc, char* argv[]) {
 
       // returned values
       bvh               = paramsForLoadMemory.bvh;
+      bvh_build_seconds = paramsForLoadMemory.bvh_build_seconds;
       start_wq          = paramsForLoadMemory.start_wq;
       start_framebuffer = paramsForLoadMemory.start_framebuffer;
       start_scene       = paramsForLoadMemory.start_scene;
@@ -882,17 +1016,11 @@ int main(int argc, char* argv[]) {
       end_memory        = paramsForLoadMemory.end_memory;
     }
   } // end else for memory dump file
+  PrintElapsedTime("Scene load time", phase_start);
+  if(bvh_build_seconds > 0)
+    printf("\t <== BVH build time: %.3f seconds ==>\n", bvh_build_seconds);
 
 
-  // Set up incremental output if option is specified
-  if(incremental_output) {
-    memory->image_width = image_width;
-    memory->image_height = image_height;
-    memory->incremental_output = incremental_output;
-    memory->start_framebuffer = start_framebuffer;
-    memory->stores_between_output = stores_between_output;
-  }
-
   int memory_size = memory->getSize();
 
   if(end_memory > memory_size) {
@@ -917,6 +1045,7 @@ int main(int argc, char* argv[]) {
   // Done preparing units, fill in instructions
   // declaration moved above
 
+  phase_start = boost::chrono::system_clock::now();
   int jtable_size = 0;
   if(assem_file != NULL) {
     jtable_size = Assembler::LoadAssem(assem_file, instructions, regs, num_regs, jump_table, ascii_literals, source_names, source_lines, print_symbols, needs_debug_symbols, &dwarfReader);
@@ -931,6 +1060,7 @@ int main(int argc, char* argv[]) {
     printf("Error: no assembly program specified\n");
     return -1;
   }
+  PrintElapsedTime("Assembly time", phase_start);
 
   if(run_profile)
     profiler.setDwarfReader(&dwarfReader);
@@ -951,11 +1081,248 @@ int main(int argc, char* argv[]) {
     }
   }
 
+  // Parameter sweep (--sweep). Everything above (scene, BVH, program) is
+  // shared by all points. Each point runs in a forked child which builds its
+  // own hardware from the base options plus the point's overrides.
+  std::vector<SweepPoint> sweep_points;
+  bool sweep_child = false;
+  if(sweep_file != NULL) {
+    if(!ReadSweepFile(sweep_file, sweep_points))
+      return -1;
+    int point = RunSweep(sweep_points, sweep_jobs, sweep_output);
+    if(point < 0)
+      return 0; // all points finished and the table is written
+    sweep_child = true;
+    print_cpi = true;
+
+    std::vector<std::string>& point_args = sweep_points[point].args;
+    for(size_t a = 0; a < point_args.size(); a++) {
+      const char* arg = point_args[a].c_str();
+      if (strcmp(arg, "--num-TMs") == 0 || strcmp(arg, "--num-cores") == 0) {
+        num_cores = atoi(point_args[++a].c_str());
+      } else if (strcmp(arg, "--num-l2s") == 0) {
+        num_L2s = atoi(point_args[++a].c_str());
+      } else if (strcmp(arg, "--num-thread-procs") == 0) {
+        num_thread_procs = atoi(point_args[++a].c_str());
+      } else if (strcmp(arg, "--threads-per-proc") == 0) {
+        threads_per_proc = atoi(point_args[++a].c_str());
+      } else if (strcmp(arg, "--simd-width") == 0) {
+        simd_width = atoi(point_args[++a].c_str());
+      } else if (strcmp(arg, "--simt-width") == 0) {
+        simt_width = atoi(point_args[++a].c_str());
+      } else if (strcmp(arg, "--watchdog") == 0) {
+        watchdog_cycles = atoll(point_args[++a].c_str());
+      } else if (strcmp(arg, "--no-coalesce") == 0) {
+        no_coalesce = true;
+      } else if (strcmp(arg, "--num-icaches") == 0) {
+        num_icaches = atoi(point_args[++a].c_str());
+      } else if (strcmp(arg, "--num-icache-banks") == 0) {
+        icache_banks = atoi(point_args[++a].c_str());
+      } else if (strcmp(arg, "--scheduling") == 0) {
+        a++;
+        if(!ThreadProcessor::ParseScheduling(point_args[a].c_str(), scheduling_scheme)) {
+          printf("ERROR: unknown --scheduling %s\n", point_args[a].c_str());
+          exit(1);
+        }
+      } else if (strcmp(arg, "--config-file") == 0) {
+        config_file = (char*)point_args[++a].c_str();
+      } else if (strcmp(arg, "--dcacheparams") == 0) {
+        dcache_params_file = (char*)point_args[++a].c_str();
+      } else if (strcmp(arg, "--icacheparams") == 0) {
+        icache_params_file = (char*)point_args[++a].c_str();
+      } else if (strcmp(arg, "--usimm-config") == 0) {
+        usimm_config_file = (char*)point_args[++a].c_str();
+      } else if (strcmp(arg, "--vi-file") == 0) {
+        usimm_vi_file = (char*)point_args[++a].c_str();
+      } else if (strcmp(arg, "--stop-cycle") == 0) {
+        stop_cycle = atoi(point_args[++a].c_str());
+      } else if (strcmp(arg, "--simulation-threads") == 0) {
+        total_simulation_threads = atoi(point_args[++a].c_str());
+      } else if (strcmp(arg, "--disable-usimm") == 0) {
+        disable_usimm = true;
+      } else if (strcmp(arg, "--wait-usimm") == 0) {
+        wait_usimm = true;
+      } else if (strcmp(arg, "--l1-off") == 0) {
+        l1_off = true;
+      } else if (strcmp(arg, "--l2-off") == 0) {
+        l2_off = true;
+      } else if (strcmp(arg, "--l1-read-copy") == 0) {
+        l1_read_copy = true;
+      }
+    }
+
+    // Keep images from different points apart
+    static char point_prefix[512];
+    sprintf(point_prefix, "%s_p%d", output_prefix, point);
+    output_prefix = point_prefix;
+
+    // New memory system for this point, holding a copy of the loaded scene
+    MainMemory* scene_memory = memory;
+    memory = NULL;
+    L2s = new L2Cache*[num_L2s];
+    config_reader = ReadConfig(config_file, dcache_params_file, L2s, num_L2s, memory, L2_size, disable_usimm, memory_trace, l1_off, l2_off, l1_read_copy);
+    if(end_memory > memory->getSize()) {
+      printf("ERROR: Scene requires %d blocks while memory_size is only %d\n", end_memory, memory->getSize());
+      exit(-1);
+    }
+    if(memory->getSize() == scene_memory->getSize()) {
+      // Same size: just share the loaded image (copy-on-write after the fork)
+      delete[] memory->data;
+      memory->data = scene_memory->getData();
+      for(size_t i = 0; i < num_L2s; i++)
+        L2s[i]->data = memory->data;
+    }
+    else {
+      int copy_size = scene_memory->getSize() < memory->getSize() ? scene_memory->getSize() : memory->getSize();
+      if(end_memory > 0 && end_memory < copy_size)
+        copy_size = end_memory;
+      memcpy(memory->getData(), scene_memory->getData(), copy_size * sizeof(FourByte));
+    }
+    if(!load_mem_file && !custom_mem_loader)
+      LoadMachineParams(memory->getData(), num_thread_procs * num_cores, num_cores);
+  }
+
+  // Set up incremental output if option is specified
+  if(incremental_output) {
+    memory->image_width = image_width;
+    memory->image_height = image_height;
+    memory->incremental_output = incremental_output;
+    memory->start_framebuffer = start_framebuffer;
+    memory->stores_between_output = stores_between_output;
+    memory->image_writer = new ImageWriter(output_prefix, use_png_ext_for_output, image_width, image_height);
+  }
+
+  GlobalRegisterFile globals(num_globals, num_thread_procs * threads_per_proc * num_cores * num_L2s, atominc_report_period);
+  if (config_reader.global_params.enabled)
+    globals.EnableBatching(config_reader.global_params, num_cores * num_L2s);
+  if (config_reader.work_queue.enabled)
+    globals.EnableWorkQueue(config_reader.work_queue, num_cores * num_L2s);
+  if (config_reader.sync_wake.enabled)
+    globals.EnableSyncQueues(config_reader.sync_wake);
+
+  // loop through the L2s
+  for(size_t l2_id = 0; l2_id < num_L2s; ++l2_id) {
+    L2Cache* L2 = L2s[l2_id];
+    // load the cores
+    for(size_t i = 0; i < num_cores; ++i) {
+      size_t core_id = i + num_cores * l2_id;
+      if(trax_verbosity)
+        printf("Loading core %d.\n", (int)core_id);
+
+      // only one computation is needed... we'll end up with the last one after the loop
+      core_size = 0;
+      TraxCore *current_core = new TraxCore(num_thread_procs, threads_per_proc, num_regs, 
+					    scheduling_scheme, &instructions, L2, core_id, 
+					    l2_id, run_profile, &profiler, &debugger);
+      config_reader.current_core = current_core;
+      config_reader.LoadConfig(L2, core_size);
+      current_core->modules.push_back(&globals);
+      current_core->functional_units.push_back(&globals);
+      if (proc_register_trace > -1 && i == 0) {
+        current_core->EnableRegisterDump(proc_register_trace);
+        //current_core->register_files[thread_register_trace]->EnableDump(thread_trace_file);
+      }
+
+      // Add Sync unit
+      Synchronize *sync_unit = new Synchronize(0,0,simd_width,num_thread_procs);
+      current_core->modules.push_back(sync_unit);
+      current_core->functional_units.push_back(sync_unit);
+
+      // Add any other custom units before the push_back
+      LocalStore *ls_unit = new LocalStore(1, num_thread_procs);
+      current_core->modules.push_back(ls_unit);
+      current_core->functional_units.push_back(ls_unit);
+      current_core->SetSymbols(&regs);
+
+      // Link the FPAdder to the FPMul for fmad ops
+      // Similarly for integers
+      FPMul* fpmul = NULL;
+      FPAddSub* fpadd = NULL;
+      IntMul* intmul = NULL;
+      IntAddSub* intadd = NULL;
+      for(size_t unit_id = 0; unit_id < current_core->functional_units.size(); unit_id++)
+	{
+	  if(fpmul == NULL)
+	    fpmul = dynamic_cast<FPMul*>(current_core->functional_units[unit_id]);
+	  if(fpadd == NULL)
+	    fpadd = dynamic_cast<FPAddSub*>(current_core->functional_units[unit_id]);
+	  if(intmul == NULL)
+	    intmul = dynamic_cast<IntMul*>(current_core->functional_units[unit_id]);
+	  if(intadd == NULL)
+	    intadd = dynamic_cast<IntAddSub*>(current_core->functional_units[unit_id]);
+	}
+      if(fpmul != NULL && fpadd != NULL)
+	fpmul->SetAdder(fpadd);
+      if(intmul != NULL && intadd != NULL)
+	intmul->SetAdder(intadd);
+
+      cores.push_back(current_core);
+    }
+  }
+
+  // set up L1 snooping if enabled
+  if(cache_snoop) {
+    for(size_t i = 0; i*4 < num_cores * num_L2s; ++i) {
+      L1Cache* L1_0=NULL, *L1_1=NULL, *L1_2=NULL, *L1_3=NULL;
+      L1_0 = cores[i*4]->L1;
+      if(num_cores > i*4+1) {
+        L1_1 = cores[i*4+1]->L1;
+        L1_1->L1_1 = L1_0;
+        L1_0->L1_1 = L1_1;
+      }
+      if(num_cores > i*4+2) {
+        L1_2 = cores[i*4+2]->L1;
+        L1_2->L1_1 = L1_0;
+        L1_2->L1_2 = L1_1;
+        L1_1->L1_2 = L1_2;
+        L1_0->L1_2 = L1_2;
+      }
+      if(num_cores > i*4+3) {
+        L1_3 = cores[i*4+3]->L1;
+        L1_3->L1_1 = L1_0;
+        L1_3->L1_2 = L1_1;
+        L1_3->L1_3 = L1_2;
+        L1_2->L1_3 = L1_3;
+        L1_1->L1_3 = L1_3;
+        L1_0->L1_3 = L1_3;
+      }
+    }
+  }
+
+  // find maximum branch delay
+  // only for backwards compatability with old trax compilers
+  std::vector<FunctionalUnit*> functional_units = cores[0]->functional_units;
+  for(size_t i = 0; i < functional_units.size(); i++) {
+    BranchUnit* brancher = dynamic_cast<BranchUnit*>(functional_units[i]);
+    if(brancher) {
+      int latency = brancher->GetLatency();
+      if(latency > BRANCH_DELAY)
+        BRANCH_DELAY = latency;
+    }
+  }
+
   // initialize the cores
   for (size_t i = 0; i < cores.size(); ++i) {
     cores[i]->initialize(icache_params_file, issue_verbosity, num_icaches, icache_banks, simd_width, jump_table, jtable_size, ascii_literals);
   }
 
+  // SIMT issue reconverges divergent warps at post-dominators of the program
+  ReconvergenceTable* reconvergence = NULL;
+  if (simt_width > 1) {
+    reconvergence = new ReconvergenceTable(instructions);
+    printf("SIMT issue in %d-lane warps, %d of %d branches reconverge before HALT\n",
+           simt_width, reconvergence->num_reconverging, reconvergence->num_branches);
+    for (size_t i = 0; i < cores.size(); ++i)
+      cores[i]->issuer->EnableSIMT(simt_width, reconvergence);
+  }
+  if (no_coalesce)
+    for (size_t i = 0; i < cores.size(); ++i)
+      cores[i]->L1->coalescing = false;
+  for (size_t i = 0; i < cores.size(); ++i) {
+    cores[i]->issuer->watchdog_cycles = watchdog_cycles;
+    cores[i]->issuer->watchdog_checkpoint = watchdog_checkpoint;
+  }
+
   // Check that there are units for each instruction in the program
   for (int i = 0; i < last_instruction; ++i) {
     // Exceptions for register file and misc
@@ -1035,6 +1402,12 @@ int main(int argc, char* argv[]) {
 
   global_total_simulation_threads = total_simulation_threads;
 
+  // Set up time-series stats sampling if requested
+  StatsSampler* sampler = NULL;
+  if(stats_sample_period > 0)
+    sampler = new StatsSampler(stats_sample_file, stats_sample_period, stats_sample_counters,
+			       &cores, L2s, num_L2s, disable_usimm);
+
   // set up simulator thread arguments 
   pthread_attr_t attr;
   pthread_t *threadids = new pthread_t[total_simulation_threads];
@@ -1065,10 +1438,23 @@ int main(int argc, char* argv[]) {
     args[i].thread_num = i;
     args[i].stop_cycle = stop_cycle;
     args[i].cores      = &cores;
+    args[i].sampler    = sampler;
+    args[i].globals    = config_reader.global_params.enabled || config_reader.work_queue.enabled ? &globals : NULL;
+    args[i].host_profile  = NULL;
+    args[i].host_counters = NULL;
   }
   // Have the last thread do the remainder
   args[total_simulation_threads - 1].end_core = num_cores * num_L2s;
 
+#if HOST_PROFILE
+  HostProfile host_profile;
+  host_profile.AddCores(cores);
+  for(int i = 0; i < total_simulation_threads; ++i) {
+    args[i].host_profile  = &host_profile;
+    args[i].host_counters = host_profile.NewCounters();
+  }
+#endif
+
   PrintElapsedTime("Setup time", time_start);
 
   // Now run the simulation
@@ -1103,8 +1489,36 @@ int main(int argc, char* argv[]) {
   }
   PrintElapsedTime("Frame time", prev_frame_time);
 
+  // Simulator throughput, for tracking the speed of the simulator itself
+  {
+    boost::chrono::duration<double> frame_seconds = boost::chrono::system_clock::now() - prev_frame_time;
+    long long int total_issued = 0;
+    long long int max_cycles = 0;
+    for(size_t i = 0; i < cores.size(); ++i) {
+      total_issued += cores[i]->issuer->instructions_issued;
+      if(cores[i]->cycle_num > max_cycles)
+        max_cycles = cores[i]->cycle_num;
+    }
+    printf("\t <== Simulation speed: %.1f KIPS, %.1f KCPS (simulated instructions, cycles per host second) ==>\n",
+           total_issued / frame_seconds.count() / 1000., max_cycles / frame_seconds.count() / 1000.);
+  }
+
   delete[] args;
 
+  if(sampler) {
+    sampler->Finish();
+    delete sampler;
+  }
+
+  // Let the incremental image writer catch up
+  if(memory->image_writer) {
+    memory->image_writer->Finish();
+    printf("Incremental output: %lld images written, %lld skipped while writer was busy\n",
+           memory->image_writer->frames_written, memory->image_writer->frames_dropped);
+    delete memory->image_writer;
+    memory->image_writer = NULL;
+  }
+
   // After reaching this point, the machine has halted.
   // Take a look and print relevant stats
   
@@ -1115,6 +1529,10 @@ int main(int argc, char* argv[]) {
       cycle_count = cores[i]->cycle_num;
   }
 
+#if HOST_PROFILE
+  host_profile.Report(cycle_count, stdout);
+#endif
+
   if(run_profile)
     {
       FILE* profile_output = fopen("profile.out", "w");      
@@ -1168,10 +1586,61 @@ int main(int argc, char* argv[]) {
     printf("System-wide L1 stats (sum of all TMs):\n");
     cores[0]->L1->PrintStats();
     printf("\n");
+
+    if (!cores[0]->intersection_units.empty()) {
+      printf("System-wide intersection pipeline stats (sum of all TMs):\n");
+      for (size_t i = 0; i < cores[0]->intersection_units.size(); i++)
+	cores[0]->intersection_units[i]->PrintStats(num_cores * num_L2s);
+      printf("\n");
+    }
+
+    if (cores[0]->traversal_unit) {
+      printf("System-wide traversal unit stats (sum of all TMs):\n");
+      cores[0]->traversal_unit->PrintStats(num_cores * num_L2s, cycle_count);
+      printf("\n");
+    }
+
+    StreamMemory* stream_memory = config_reader.stream_memory;
+    if (stream_memory) {
+      printf("Stream memory stats (shared by all TMs):\n");
+      stream_memory->PrintStats(cycle_count);
+      printf("\n");
+    }
+
+    if (globals.batched) {
+      printf("Global register stats (GLOBALS line):\n");
+      globals.PrintStats();
+      printf("\n");
+    }
+
+    if (globals.sync_queues) {
+      printf("Barrier and semaphore stats (SYNCWAKE line):\n");
+      globals.sync_queues->PrintStats();
+      printf("\n");
+    }
+
+    if (globals.work_distributor) {
+      printf("Work distributor stats (WORKQUEUE line):\n");
+      globals.work_distributor->PrintStats(cores[0]->issuer->unit_contention[Instruction::ATOMIC_INC]);
+      printf("\n");
+    }
+
+    if (!config_reader.unit_lanes.empty()) {
+      printf("Divide and inverse sqrt unit stats (INTERVAL lines):\n");
+      UnitLanes::PrintAll(config_reader.unit_lanes, cycle_count);
+      printf("\n");
+    }
+
+    if (!config_reader.unit_pools.empty()) {
+      printf("Shared unit pool stats (SHARE lines):\n");
+      SharedUnitPool::PrintAll(config_reader.unit_pools, cycle_count);
+      printf("\n");
+    }
     
     
     // Print L2 stats and gather agregate data
     long long int L2_accesses = 0;
+    long long int L2_hits = 0;
     long long int L2_misses = 0;
     double L2_area = 0;
     double L2_energy = 0;
@@ -1179,6 +1648,7 @@ int main(int argc, char* argv[]) {
       printf(" -= L2 #%d =-\n", (int)i);
       L2s[i]->PrintStats();
       L2_accesses += L2s[i]->accesses;
+      L2_hits += L2s[i]->hits;
       L2_misses += L2s[i]->misses;
       printf("\n");
       L2_area += L2s[i]->area;
@@ -1209,6 +1679,18 @@ int main(int argc, char* argv[]) {
       DRAM_BW = static_cast<float>(total_lines_transfered) * L2_line_size * word_size / cycle_count;
     }
     printf("   memory to L2 bandwidth: \t %f\n", DRAM_BW);
+
+    // compare with the same run without the TREELETS line
+    TreeletScheduler* treelets = cores[0]->issuer->treelets;
+    if (treelets) {
+      printf("\nTreelet scheduling stats (sum of all TMs):\n");
+      treelets->Print(cycle_count);
+      double DRAM_bytes = DRAM_BW * cycle_count;
+      printf("   L1 hit rate: %.2f%%, L2 hit rate: %.2f%%, DRAM bytes per ray: %.2f\n",
+	     cores[0]->L1->accesses > 0 ? 100. * cores[0]->L1->hits / cores[0]->L1->accesses : 0.,
+	     L2_accesses > 0 ? 100. * L2_hits / L2_accesses : 0.,
+	     treelets->rays > 0 ? DRAM_bytes / treelets->rays : 0.);
+    }
     
     
     if(trax_verbosity) {
@@ -1242,7 +1724,11 @@ int main(int argc, char* argv[]) {
       }
     
     
-    double total_area = L1_area + L2_area + compute_area + icache_area + localstore_area + register_area;
+    double stream_area = stream_memory ? stream_memory->GetArea() : 0;
+    if(ignore_dcache_area)
+      stream_area = 0;
+
+    double total_area = L1_area + L2_area + compute_area + icache_area + localstore_area + register_area + stream_area;
     
     printf("\n");
     
@@ -1253,6 +1739,8 @@ int main(int argc, char* argv[]) {
     printf("   Instruction caches: \t %f\n", icache_area);
     printf("   Localstore units: \t %f\n", localstore_area);
     printf("   Register files: \t %f\n", register_area);
+    if (stream_memory)
+      printf("   Stream memory: \t %f\n", stream_area);
     printf("   ------------------------------\n");
     printf("   Total: \t\t %f\n", total_area);
     
@@ -1289,6 +1777,17 @@ int main(int argc, char* argv[]) {
       }
     }
     
+    // the traversal unit counts its energy per node and triangle visited
+    if (cores[0]->traversal_unit)
+      compute_energy += cores[0]->traversal_unit->Energy();
+
+    // with RFBANKS the register file counts its own bank accesses
+    if (!cores[0]->issuer->register_banks.empty())
+      register_energy = cores[0]->issuer->RegisterBankEnergy();
+
+    // with the ICACHE model, each line fill is another activation
+    icache_energy += cores[0]->issuer->GetEnergy() * cores[0]->issuer->ICacheFills();
+
     // convert nanojoules to joules
     compute_energy /= 1000000000.f;
     icache_energy /= 1000000000.f;
@@ -1300,7 +1799,8 @@ int main(int argc, char* argv[]) {
     double FPS = Hz/static_cast<double>(cycle_count);
     
     DRAM_energy = DRAM_power / FPS;
-    double total_energy = compute_energy + L1_energy + L2_energy + icache_energy + localstore_energy + register_energy + DRAM_energy;
+    double stream_energy = stream_memory ? stream_memory->Energy() / 1000000000.f : 0;
+    double total_energy = compute_energy + L1_energy + L2_energy + icache_energy + localstore_energy + register_energy + DRAM_energy + stream_energy;
     
     
     printf("Energy consumption (Joules):\n");
@@ -1310,6 +1810,8 @@ int main(int argc, char* argv[]) {
     printf("   Instruction caches: \t %f\n", icache_energy);
     printf("   Localstore units: \t %f\n", localstore_energy);
     printf("   Register files: \t %f\n", register_energy);
+    if (stream_memory)
+      printf("   Stream memory: \t %f\n", stream_energy);
     printf("   DRAM: \t\t %f\n", DRAM_energy);
     printf("   ------------------------------\n");
     printf("   Total: \t\t %f\n", total_energy);
@@ -1318,6 +1820,18 @@ int main(int argc, char* argv[]) {
     printf("FPS Statistics:\n");
     printf("   Total clock cycles: \t\t %lld\n", cycle_count);
     printf("   FPS assuming %dMHz clock: \t %.4lf\n", (int)Hz / 1000000, FPS);
+
+    if(sweep_child) {
+      IssueUnit* issuer = cores[0]->issuer;
+      if(issuer->issue_stats.avg_issue < 0.0)
+        issuer->CalculateIssueStats();
+      double issue_rate = issuer->issue_stats.avg_issue / (num_thread_procs * num_cores * num_L2s);
+      boost::chrono::duration<double> wall_time = boost::chrono::system_clock::now() - prev_frame_time;
+      WriteSweepResult(cycle_count, FPS, issue_rate,
+                       static_cast<double>(cores[0]->L1->hits) / cores[0]->L1->accesses,
+                       static_cast<double>(L2_hits) / L2_accesses, DRAM_BW,
+                       total_area, total_energy, total_energy * FPS, wall_time.count());
+    }
     
     printf("\n\n");
     
@@ -1327,6 +1841,7 @@ int main(int argc, char* argv[]) {
   
   fflush(stdout);
   
+  phase_start = boost::chrono::system_clock::now();
   if(print_png) {
 
     const int imgNameLen = strlen(output_prefix);
@@ -1356,114 +1871,75 @@ int main(int argc, char* argv[]) {
       sprintf(outputName, "%s.%s", output_prefix, outputExt);
     }
 
-    // Write out using PNG extension?
-    if(use_png_ext_for_output) {
-
-      // save using lodePNG
-      unsigned char *imgRGBA = new unsigned char[4*image_width*image_height];
-      unsigned char *curImgPixel = imgRGBA;
-      for(int j = (int)(image_height - 1); j >= 0; j--) {
-        for(int i = 0; i < image_width; i++, curImgPixel+=4) {
-          const int index = start_framebuffer + 3 * (j * image_width + i);
-
-          float rgb[3];
-          rgb[0] = memory->getData()[index + 0].fvalue;
-          rgb[1] = memory->getData()[index + 1].fvalue;
-          rgb[2] = memory->getData()[index + 2].fvalue;
-
-          curImgPixel[0] = (char)(int)(rgb[0] * 255);
-          curImgPixel[1] = (char)(int)(rgb[1] * 255);
-          curImgPixel[2] = (char)(int)(rgb[2] * 255);
-          curImgPixel[3] = 255;
-        }
-      }
-
-      unsigned char* png;
-      size_t pngsize;
-
-      unsigned error = lodepng_encode32(&png, &pngsize, imgRGBA, image_width, image_height);
-      if(!error)
-        lodepng_save_file(png, pngsize, outputName);
-      else
-        printf("Error %u: %s\n", error, lodepng_error_text(error));
-
-      free(png);
-      delete[] imgRGBA;
+    // Convert the framebuffer to 8-bit RGB and write it in one go
+    unsigned char *imgRGB = new unsigned char[3*image_width*image_height];
+#if OBJECTID_MAP
+    srand( (unsigned)time( NULL ) );
+    const int num_ids = 100000;
+    float id_colors[num_ids][3];
+    for (int i = 0; i < num_ids; i++) {
+      id_colors[i][0] = drand48();
+      id_colors[i][1] = drand48();
+      id_colors[i][2] = drand48();
     }
 
-    // Write out using PPM extension
-    else {
-
-      FILE* output = fopen(outputName, "wb");
-      if(!output)
-        printf("Error: Failed to open image output file: %s\n", outputName);
-
-#if OBJECTID_MAP
-        srand( (unsigned)time( NULL ) );
-        const int num_ids = 100000;
-        float id_colors[num_ids][3];
-        for (int i = 0; i < num_ids; i++) {
-          id_colors[i][0] = drand48();
-          id_colors[i][1] = drand48();
-          id_colors[i][2] = drand48();
+    unsigned char *curImgPixel = imgRGB;
+    for(int j = image_height - 1; j >= 0; j--) {
+      for(int i = 0; i < image_width; i++, curImgPixel+=3) {
+        const int index = start_framebuffer + 3 * (j * image_width + i);
+
+        float rgb[3];
+        int object_id = memory->getData()[index].ivalue;
+
+        switch (object_id) {
+          case -1:
+            rgb[0] = .2;
+            rgb[1] = .1;
+            rgb[2] = .5;
+            break;
+          case 0:
+            rgb[0] = 1.;
+            rgb[1] = .4;
+            rgb[2] = 1.;
+            break;
+          case 1:
+            rgb[0] = .2;
+            rgb[1] = .3;
+            rgb[2] = 1.;
+            break;
+          case 2:
+            rgb[0] = 1.;
+            rgb[1] = .3;
+            rgb[2] = .2;
+            break;
+          default:
+            rgb[0] = id_colors[object_id % num_ids][0];
+            rgb[1] = id_colors[object_id % num_ids][1];
+            rgb[2] = id_colors[object_id % num_ids][2];
+            break;
+        };
+        curImgPixel[0] = (char)(int)(rgb[0] * 255);
+        curImgPixel[1] = (char)(int)(rgb[1] * 255);
+        curImgPixel[2] = (char)(int)(rgb[2] * 255);
       }
-#endif
-
-        fprintf(output, "P6\n%d %d\n%d\n", image_width, image_height, 255);
-        for(int j = image_height - 1; j >= 0; j--) {
-          for(int i = 0; i < image_width; i++) {
-            const int index = start_framebuffer + 3 * (j * image_width + i);
-
-            float rgb[3];
-#if OBJECTID_MAP
-            int object_id = memory->getData()[index].ivalue;
-
-            switch (object_id) {
-              case -1:
-                rgb[0] = .2;
-                rgb[1] = .1;
-                rgb[2] = .5;
-                break;
-              case 0:
-                rgb[0] = 1.;
-                rgb[1] = .4;
-                rgb[2] = 1.;
-                break;
-              case 1:
-                rgb[0] = .2;
-                rgb[1] = .3;
-                rgb[2] = 1.;
-                break;
-              case 2:
-                rgb[0] = 1.;
-                rgb[1] = .3;
-                rgb[2] = .2;
-                break;
-              default:
-                rgb[0] = id_colors[object_id % num_ids][0];
-                rgb[1] = id_colors[object_id % num_ids][1];
-                rgb[2] = id_colors[object_id % num_ids][2];
-                break;
-            };
+    } // end for j
 #else
-            // for gradient/colors we have the result
-            rgb[0] = memory->getData()[index + 0].fvalue;
-            rgb[1] = memory->getData()[index + 1].fvalue;
-            rgb[2] = memory->getData()[index + 2].fvalue;
+    ImageWriter::ConvertFramebuffer(memory->getData() + start_framebuffer, image_width, image_height, imgRGB);
 #endif
-            fprintf(output, "%c%c%c",
-                    (char)(int)(rgb[0] * 255),
-                    (char)(int)(rgb[1] * 255),
-                    (char)(int)(rgb[2] * 255));
-          }
-        } // end for j
-        fclose(output);
-      }
-    } // end if print_png
+    ImageWriter::WriteImage(outputName, imgRGB, image_width, image_height, use_png_ext_for_output);
+    delete[] imgRGB;
+  } // end if print_png
+  PrintElapsedTime("Output time", phase_start);
 
 
   // reset the cores for a fresh frame
   globals.Reset();
+  if (config_reader.stream_memory)
+    config_reader.stream_memory->Reset();
+  for (size_t i = 0; i < config_reader.unit_lanes.size(); i++)
+    config_reader.unit_lanes[i]->Reset();
+  for (size_t i = 0; i < config_reader.unit_pools.size(); i++)
+    config_reader.unit_pools[i]->Reset();
   for(size_t i = 0; i < num_cores * num_L2s; ++i) {
     cores[i]->Reset();
   }
@@ -1489,6 +1965,7 @@ int main(int argc, char* argv[]) {
   for(size_t i=0; i<cores.size(); i++){
     delete cores[i];
   }
+  delete reconvergence;
   delete[] L2s;
   PrintElapsedTime("Total time", time_start);
 